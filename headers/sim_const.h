@@ -34,4 +34,34 @@ static const int    SIM_DEFAULT_INITIAL_TARGETS         = 10;
 static const double SIM_DEFAULT_OBSTACLE_SPAWN_INTERVAL = 2.0;  
 static const double SIM_DEFAULT_TARGET_SPAWN_INTERVAL   = 2.0;  
 
+// Obstacle collisions (0 = off, 1 = stop, 2 = bounce)
+static const int    SIM_DEFAULT_COLLISION_RESPONSE = 1;
+static const double SIM_DEFAULT_RESTITUTION        = 0.5;
+
+// Adaptive sub-stepping: cap on integration steps per tick
+static const int    SIM_DEFAULT_MAX_SUBSTEPS       = 16;
+
+// Wall repulsion lookup table samples (0 = exact law every tick)
+static const int    SIM_DEFAULT_WALL_LUT_SIZE      = 0;
+
+// Obstacle field grid spacing in world units (0 = exact law every tick)
+static const double SIM_DEFAULT_OBSTACLE_FIELD_CELL = 0.0;
+
+// Real-time: lock memory (0 / 1), seconds between jitter reports (0 = off)
+static const int    SIM_DEFAULT_MLOCK_ALL              = 0;
+static const double SIM_DEFAULT_JITTER_REPORT_INTERVAL = 10.0;
+
+// Observers bb_server accepts on its snapshot socket at the same time
+static const int    SIM_DEFAULT_MAX_OBSERVERS = 4;
+
+// World snapshots kept in the shared-memory broadcast ring (0 = off)
+static const int    SIM_DEFAULT_SNAPSHOT_SLOTS = 64;
+
+// Seconds between rewrites of the metrics export file
+static const double SIM_DEFAULT_METRICS_INTERVAL = 1.0;
+
+// Top speed of spawned obstacles / targets (0 = static)
+static const double SIM_DEFAULT_OBSTACLE_SPEED = 0.0;
+static const double SIM_DEFAULT_TARGET_SPEED   = 0.0;
+
 #endif
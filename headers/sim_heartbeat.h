@@ -0,0 +1,52 @@
+/*
+    Liveness heartbeats between master (supervisor) and its children.
+
+    master creates one small shared block (memfd) with a counter per role
+    and exports its fd in SIM_HEARTBEAT_FD, like the parameter block.
+    Children bump their counter once per loop iteration with
+    sim_heartbeat_beat(); master samples the counters and treats a
+    counter that stops moving for longer than the timeout as a hung
+    process. Without the block (child started by hand) beats are no-ops.
+*/
+
+#ifndef SIM_HEARTBEAT_H
+#define SIM_HEARTBEAT_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "sim_role.h"   // SIM_ROLE_*: also the slot index in the block
+
+#define SIM_HEARTBEAT_FD_ENV   "SIM_HEARTBEAT_FD"
+
+// Longest a child may block without beating (sim_heartbeat_sleep_until)
+#define SIM_HEARTBEAT_PERIOD_S 0.25
+
+/*
+    Master side: create the block, export SIM_HEARTBEAT_FD (inherited
+    across exec). Returns the fd or -1.
+*/
+int sim_heartbeat_create(void);
+
+// Master side: current counter of a role (0 if no block)
+uint64_t sim_heartbeat_read(int role);
+
+// Child side: one beat for role (maps the block on first use)
+void sim_heartbeat_beat(int role);
+
+/*
+    Child side: sleep until the absolute CLOCK_MONOTONIC deadline,
+    beating every SIM_HEARTBEAT_PERIOD_S so long waits do not look like
+    a hang. Returns 0 when the deadline is reached, -1 if a signal
+    interrupted the sleep.
+*/
+int sim_heartbeat_sleep_until(int role, const struct timespec *deadline);
+
+/*
+    Same, but wake up early when fd is readable (or at EOF). Returns 1
+    if fd is ready, 0 at the deadline, -1 if a signal interrupted the
+    wait.
+*/
+int sim_heartbeat_wait_fd(int role, int fd, const struct timespec *deadline);
+
+#endif
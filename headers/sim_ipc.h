@@ -1,8 +1,9 @@
 /*
     IPC identifiers for the shared WorldState stuct defined in sim_types.h.
 
-    SHM/SEM identifiers are kept for compatibility with older phases but are
-    not used in the current pipe-based implementation.
+    SIM_SHM_WORLD names the world snapshot ring bb_server publishes for
+    local subscribers (sim_snapshot.h). SIM_SEM_WORLD is kept for
+    compatibility with older phases but is not used.
 */
 
 #ifndef SIM_IPC_H
@@ -12,13 +13,18 @@
 #define SIM_SEM_WORLD   "/sim_world_sem"
 
 #include <sys/types.h>
+#include <sys/select.h>
+#include <sys/uio.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /*
     Anonymous pipe FD positions in argv for each process.
 
     master will create all pipes with pipe(), then fork/exec the children
-    and pass the relevant FD numbers as command-line arguments:
+    and pass the relevant FD numbers as command-line arguments.
+    master keeps every end open for the whole run, so a restarted worker
+    (drone / obstacles / targets) is started with the same FD numbers:
 
       bb_server argv layout:
         ./bb_server <fd_drone_state_in>
@@ -26,10 +32,15 @@
                     <fd_input_cmd_in>
                     <fd_obstacles_in>
                     <fd_targets_in>
+                    <fd_target_hits_out>
 
       drone argv layout:
         ./drone <fd_cmd_in> <fd_state_out>
 
+      Every pipe carries sim_proto frames. bb_server -> drone carries both
+      the user commands and every obstacle set bb_server receives, so the
+      drone can run swept collision tests inside its own step.
+
       input argv layout:
         ./input <fd_cmd_out>
 
@@ -37,7 +48,11 @@
         ./obstacles <fd_obstacles_out>
 
       targets argv layout:
-        ./targets <fd_targets_out>
+        ./targets <fd_targets_out> <fd_target_hits_in>
+
+      targets.c owns the target set: bb_server reports hit target ids on
+      the return pipe, targets.c respawns them and sends only the slots
+      that changed.
 */
 
 #define SIM_ARG_BB_DRONE_STATE_IN   1
@@ -46,6 +61,7 @@
 
 #define SIM_ARG_BB_OBS_IN           4
 #define SIM_ARG_BB_TGT_IN           5
+#define SIM_ARG_BB_TGT_HITS_OUT     6
 
 #define SIM_ARG_DRONE_CMD_IN        1
 #define SIM_ARG_DRONE_STATE_OUT     2
@@ -55,9 +71,173 @@
 #define SIM_ARG_OBS_OUT             1
 
 #define SIM_ARG_TGT_OUT             1
+#define SIM_ARG_TGT_HITS_IN         2
 
-// Robust I/O helpers for pipe-based communication.
+// Robust I/O helpers for pipe-based communication (blocking fds only:
+// they wait for all n bytes, a tick loop should use SimIpcRx / SimIpcTx).
 ssize_t read_full(int fd, void *buf, size_t n);
 ssize_t write_full(int fd, const void *buf, size_t n);
 
+// O_NONBLOCK for a pipe / socket, or the same behaviour for one end of
+// a sim_ipc_channel(). Returns 0 or -1.
+int sim_ipc_set_nonblock(int fd);
+
+/*
+    Batch I/O: one syscall for several messages.
+
+    sim_ipc_writev_full() writes every iovec in order (retrying short
+    writes), returns the total or -1. sim_ipc_readv() is a single readv:
+    whatever is available up to the iovec sizes, 0 on EOF, -1 on error
+    (EAGAIN on a non-blocking fd with nothing to read).
+    On sim_ipc_channel() ends both go through the ring under one lock.
+
+    sim_ipc_recv_batch() takes up to n records from a SOCK_SEQPACKET
+    socket with one recvmmsg, fills lens[i] with each record's length
+    and returns the number received; wait = 0 returns -1 / EAGAIN when
+    nothing is queued.
+*/
+#define SIM_IPC_BATCH_MAX  32
+
+ssize_t sim_ipc_writev_full(int fd, const struct iovec *iov, int n);
+ssize_t sim_ipc_readv(int fd, const struct iovec *iov, int n);
+int     sim_ipc_recv_batch(int fd, const struct iovec *rec, size_t *lens, int n, int wait);
+
+/*
+    Receive buffer for stream fds (pipes, channels): sim_ipc_rx_fill()
+    appends what one read returns, however it splits messages, and the
+    consumer takes whole messages from the front with
+    sim_ipc_rx_consume(); a partial message stays for the next fill.
+    Returns the bytes added, 0 on EOF, -1 on error (EAGAIN included).
+*/
+#define SIM_IPC_RX_SIZE  8192
+
+typedef struct {
+    size_t  len;
+    uint8_t buf[SIM_IPC_RX_SIZE];
+} SimIpcRx;
+
+ssize_t sim_ipc_rx_fill(int fd, SimIpcRx *rx);
+void    sim_ipc_rx_consume(SimIpcRx *rx, size_t n);
+
+/*
+    Bounded outbound queue for a non-blocking fd.
+
+    Messages are pushed whole and leave in order; sim_ipc_tx_flush()
+    writes as much as the fd takes right now and keeps the rest (a
+    message may go out in several pieces, never interleaved with
+    another). When a message does not fit, the policy decides:
+
+      SIM_IPC_TX_DROP_NEWEST   the new message is dropped
+      SIM_IPC_TX_DROP_OLDEST   queued messages that have not started
+                               going out are dropped, oldest first
+      SIM_IPC_TX_OVERWRITE     a queued message with the same key that
+                               has not started going out is replaced
+                               (latest state wins), even if there is
+                               room; otherwise like DROP_OLDEST
+
+    So a slow peer costs queued data, never a blocked writer.
+*/
+#define SIM_IPC_TX_SIZE      16384
+#define SIM_IPC_TX_MAX_MSGS  128
+
+typedef enum {
+    SIM_IPC_TX_DROP_NEWEST,
+    SIM_IPC_TX_DROP_OLDEST,
+    SIM_IPC_TX_OVERWRITE
+} SimIpcTxPolicy;
+
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+    int      key;
+} SimIpcTxMsg;
+
+typedef struct {
+    size_t        len;       // bytes queued
+    size_t        sent;      // bytes of msg[0] already written
+    int           count;
+    SimIpcTxMsg   msg[SIM_IPC_TX_MAX_MSGS];
+    unsigned long dropped;       // messages lost to a full queue
+    unsigned long overwritten;   // messages replaced by a newer one
+    uint8_t       buf[SIM_IPC_TX_SIZE];
+} SimIpcTx;
+
+void    sim_ipc_tx_init(SimIpcTx *q);
+// 0 = queued, -1 = dropped (policy DROP_NEWEST or bigger than the queue)
+int     sim_ipc_tx_push(SimIpcTx *q, const void *buf, size_t n, int key,
+                        SimIpcTxPolicy policy);
+// Bytes written (0 if the fd is full), or -1 on an error other than EAGAIN
+ssize_t sim_ipc_tx_flush(int fd, SimIpcTx *q);
+// Bytes still queued (call sim_ipc_tx_flush() each pass while > 0)
+size_t  sim_ipc_tx_pending(const SimIpcTx *q);
+// Drop every queued message not yet started (counted in dropped)
+void    sim_ipc_tx_clear(SimIpcTx *q);
+
+/*
+    In-process channels for the single-process build (sim_threaded).
+
+    sim_ipc_channel() is a drop-in for pipe(): fds[0] is the read end,
+    fds[1] the write end. Data moves through a ring buffer in memory
+    guarded by a mutex, so read_full()/write_full() on these fds never
+    enter the kernel. Both fds refer to an eventfd that is readable while
+    the ring holds data or the writer has closed, so select()/poll() on
+    the read end behave like on a pipe.
+
+    Writes block while the ring is full; a write after the reader closed
+    fails with EPIPE (no SIGPIPE), a read after the writer closed and the
+    ring drained returns a short count (EOF).
+
+    sim_ipc_close() closes either kind of fd and must be used for
+    channel ends; for plain fds it is close().
+*/
+#define SIM_IPC_CHANNEL_SIZE   (64 * 1024)
+
+int sim_ipc_channel(int fds[2]);
+int sim_ipc_close(int fd);
+
+/*
+    UNIX domain sockets (SOCK_SEQPACKET) for processes that attach and
+    detach at runtime, next to the fixed pipes above: a second UI, a
+    recorder, a metrics exporter... Each send is one record, so a reader
+    gets whole batches of sim_proto frames or nothing, and the kernel
+    reports a peer that went away (EOF / EPIPE) without any extra fd.
+
+    sim_ipc_listen() removes a stale socket file at path first.
+    sim_ipc_send_packet() never blocks: -1 with EAGAIN means the peer
+    has not drained its queue.
+    Sockets are close-on-exec; use close() on them.
+*/
+#define SIM_IPC_MAX_OBSERVERS  8
+
+int     sim_ipc_listen(const char *path, int backlog);
+int     sim_ipc_accept(int listen_fd);
+int     sim_ipc_connect(const char *path);
+ssize_t sim_ipc_send_packet(int fd, const void *buf, size_t n);
+
+/*
+    Fan-out of one producer to the observers connected to its socket.
+
+    sim_ipc_fanout_fdset() adds the listening socket and every observer
+    to a select() set; sim_ipc_fanout_poll() then accepts new observers
+    and drops the ones that hung up. sim_ipc_fanout_send() hands the
+    same record to each observer; one that is not keeping up loses that
+    record (counted in dropped[]) instead of stalling the producer.
+*/
+typedef struct {
+    int           listen_fd;     // -1 = disabled
+    int           max;
+    int           fd[SIM_IPC_MAX_OBSERVERS];
+    unsigned long sent[SIM_IPC_MAX_OBSERVERS];
+    unsigned long dropped[SIM_IPC_MAX_OBSERVERS];
+    unsigned long attached;      // observers accepted over the run
+    char          path[108];     // sizeof(sockaddr_un.sun_path)
+} SimIpcFanout;
+
+int  sim_ipc_fanout_open(SimIpcFanout *f, const char *path, int max);
+void sim_ipc_fanout_fdset(const SimIpcFanout *f, fd_set *set, int *maxfd);
+void sim_ipc_fanout_poll(SimIpcFanout *f, const fd_set *set);
+int  sim_ipc_fanout_count(const SimIpcFanout *f);
+void sim_ipc_fanout_send(SimIpcFanout *f, const void *buf, size_t n);
+void sim_ipc_fanout_close(SimIpcFanout *f);
+
 #endif
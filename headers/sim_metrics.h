@@ -0,0 +1,144 @@
+/*
+    Hot-path performance counters shared between the processes.
+
+    master (or sim_threaded) creates one shared block (memfd) and exports
+    its fd in SIM_METRICS_FD, like the heartbeat block. Each role owns a
+    cache-line aligned row of counters that only it writes, so updating
+    one is a plain relaxed store: no lock, no shared cache line. Channel
+    counters are written by the receiving end only.
+
+    Readers (bb_server's metrics panel) take two samples and turn the
+    difference into rates with sim_metrics_rates(). Without the block
+    (process started by hand) every update is a no-op.
+
+    The exporter writes every counter, the per-role tick duration
+    histogram and the per-channel message / byte totals to a file in the
+    Prometheus text exposition format (node_exporter textfile style:
+    written aside and renamed, so a scraper never sees half a file).
+*/
+
+#ifndef SIM_METRICS_H
+#define SIM_METRICS_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "sim_role.h"
+
+#define SIM_METRICS_FD_ENV  "SIM_METRICS_FD"
+
+// Window over which TICK_MAX_NS is the longest tick
+#define SIM_METRICS_WINDOW_S  1.0
+
+// Tick duration histogram: 10 bounds (50 us .. 50 ms) + overflow
+#define SIM_METRICS_HIST_BUCKETS  11
+
+// Per-role counters (c) and gauges (g)
+enum {
+    SIM_METRIC_TICKS,         // c: loop passes (wake-up to end of work)
+    SIM_METRIC_TICK_NS,       // c: time spent in those passes
+    SIM_METRIC_TICK_MAX_NS,   // g: longest pass of the last window
+    SIM_METRIC_FRAMES,        // c: frames drawn (bb_server)
+    SIM_METRIC_DROPPED,       // g: messages lost to a full queue
+    SIM_METRIC_COALESCED,     // g: messages replaced by a newer one
+    SIM_METRIC_QUEUE_BYTES,   // g: outbound queue depth
+    SIM_METRIC_TARGET_HITS,   // c: targets hit (bb_server)
+    SIM_METRIC_REPULSION_ON,  // c: wall repulsion activations (bb_server)
+    SIM_METRIC_COLLISIONS,    // c: obstacle contacts (drone)
+    SIM_METRIC_RESTARTS,      // c: restarts of the role (written by master)
+    SIM_METRIC_COUNT
+};
+
+// Messages and bytes per channel, counted where they are received
+enum {
+    SIM_METRIC_CHAN_DRONE_STATE,   // drone     -> bb_server
+    SIM_METRIC_CHAN_DRONE_CMD,     // bb_server -> drone
+    SIM_METRIC_CHAN_INPUT_CMD,     // input     -> bb_server
+    SIM_METRIC_CHAN_OBSTACLES,     // obstacles -> bb_server
+    SIM_METRIC_CHAN_TARGETS,       // targets   -> bb_server
+    SIM_METRIC_CHAN_TARGET_HITS,   // bb_server -> targets
+    SIM_METRIC_CHAN_OBSERVERS,     // bb_server -> socket observers (records)
+    SIM_METRIC_CHAN_SNAPSHOTS,     // bb_server -> snapshot ring
+    SIM_METRIC_CHAN_COUNT
+};
+
+typedef struct {
+    uint64_t t_ns;
+    uint64_t role[SIM_ROLE_COUNT][SIM_METRIC_COUNT];
+    uint64_t chan[SIM_METRIC_CHAN_COUNT];
+} SimMetricsSample;
+
+typedef struct {
+    double   ticks_per_s[SIM_ROLE_COUNT];
+    double   tick_avg_ms[SIM_ROLE_COUNT];
+    double   tick_max_ms[SIM_ROLE_COUNT];
+    double   frames_per_s[SIM_ROLE_COUNT];
+    uint64_t dropped[SIM_ROLE_COUNT];
+    uint64_t coalesced[SIM_ROLE_COUNT];
+    uint64_t queue_bytes[SIM_ROLE_COUNT];
+    double   chan_per_s[SIM_METRIC_CHAN_COUNT];
+} SimMetricsRates;
+
+// Times one role's loop passes (TICKS, TICK_NS, TICK_MAX_NS)
+typedef struct {
+    int      role;
+    uint64_t start_ns;
+    uint64_t window_end_ns;
+    uint64_t window_max_ns;
+} SimMetricsTimer;
+
+// Background thread rewriting the export file every interval
+typedef struct {
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    int             started;
+    int             stop;
+    double          interval;
+    unsigned long   written;
+    char            path[256];   // SIM_PARAMS_PATH_MAX
+} SimMetricsExporter;
+
+/*
+    master / sim_threaded: create the block, export SIM_METRICS_FD
+    (inherited across exec). Returns the fd or -1.
+*/
+int sim_metrics_create(void);
+
+uint64_t sim_metrics_now_ns(void);
+
+// Owner side (maps the block on first use)
+void sim_metrics_add(int role, int metric, uint64_t n);
+void sim_metrics_set(int role, int metric, uint64_t v);
+void sim_metrics_chan_add(int chan, uint64_t n);
+void sim_metrics_chan_bytes(int chan, uint64_t n);
+
+void sim_metrics_timer_init(SimMetricsTimer *t, int role);
+void sim_metrics_tick_begin(SimMetricsTimer *t);
+void sim_metrics_tick_end(SimMetricsTimer *t);
+
+// Reader side: one counter (0 if there is no block)
+uint64_t sim_metrics_get(int role, int metric);
+// Reader side: 0, or -1 if there is no block
+int  sim_metrics_sample(SimMetricsSample *s);
+void sim_metrics_rates(const SimMetricsSample *prev, const SimMetricsSample *cur,
+                       SimMetricsRates *out);
+
+/*
+    Write the text exposition of every metric to `path` (via path.tmp
+    and rename). Returns 0, or -1 with errno set.
+*/
+int sim_metrics_export(const char *path);
+
+/*
+    Start a thread exporting to `path` every `interval` seconds (the
+    hot loops never touch the file). Returns 0, or -1 with errno set.
+    stop() writes a final export and joins the thread.
+*/
+int  sim_metrics_exporter_start(SimMetricsExporter *e, const char *path, double interval);
+void sim_metrics_exporter_stop(SimMetricsExporter *e);
+
+const char *sim_metrics_role_name(int role);
+const char *sim_metrics_chan_name(int chan);
+
+#endif
@@ -7,12 +7,33 @@
 #ifndef SIM_PARAMS_H
 #define SIM_PARAMS_H
 
+#include <stdint.h>
+
+#include "sim_role.h"
+
 /* 
     Default config file path used if sim_params_load(NULL) is called.
     The path is interpreted relative to the current working directory.
  */
 #define SIM_PARAMS_DEFAULT_PATH "../../bin/conf/drone_parameters.conf"
 
+/*
+    Environment variables:
+    - SIM_PARAMS_PATH: overrides SIM_PARAMS_DEFAULT_PATH for sim_params_load(NULL).
+    - SIM_PARAMS_FD:   inherited fd of the binary parameter block published by
+                       master (sim_params_publish). When set and valid,
+                       sim_params_load(NULL) maps it instead of parsing text.
+ */
+#define SIM_PARAMS_PATH_ENV "SIM_PARAMS_PATH"
+#define SIM_PARAMS_FD_ENV   "SIM_PARAMS_FD"
+
+// Longest path stored in SimParams (scenario_file)
+#define SIM_PARAMS_PATH_MAX 256
+
+// Binary block header: magic 'SIMP' + layout version
+#define SIM_PARAMS_MAGIC    0x504D4953u
+#define SIM_PARAMS_VERSION  7
+
 /* 
     Global simulation parameters.
     Units:
@@ -25,6 +46,35 @@
     - rho: meters (perception distance for repulsion)
     - eta: N·m (repulsion gain)
     - obstacle/target_spawn_interval: seconds between spawns
+    - collision_response: 0 = off, 1 = stop, 2 = bounce (see sim_physics.h)
+    - restitution: fraction of normal speed kept on bounce [0, 1]
+    - max_substeps: cap on adaptive integration steps per drone tick (>= 1)
+    - wall_lut_size: samples in the wall repulsion table (0 = disabled)
+    - obstacle_field_cell: node spacing of the cached obstacle field
+      (simulation coordinates, 0 = disabled)
+    - scenario_path: scenario file for obstacles/targets (see sim_scenario.h),
+      relative paths resolved against the config file, "" = random layout
+    - rng_seed: run seed for every random stream (see sim_rng.h), 0 = pick
+      one at startup (master logs it so the run can be replayed)
+    - cpu_mask[role]: CPUs the role may run on, bit i = CPU i
+      (0 = not pinned); config syntax "0-2,5" (see sim_rt.h)
+    - rt_priority[role]: 0 = normal scheduling, 1..99 = SCHED_FIFO priority
+    - mlock_all: 1 = lock every page of the process in RAM (mlockall)
+    - jitter_report_interval: seconds between tick jitter log lines
+      (0 = never)
+    - observer_socket: UNIX socket bb_server publishes world snapshots on
+      (see sim_ipc.h), relative paths resolved against the config file,
+      "" = no observers
+    - max_observers: observers attached at the same time (0 = none)
+    - snapshot_slots: world snapshots kept in the shared-memory ring for
+      local subscribers (see sim_snapshot.h), 0 = no ring
+    - metrics_file: Prometheus text file bb_server keeps up to date (see
+      sim_metrics.h), relative paths resolved against the config file,
+      "" = no export
+    - metrics_interval: seconds between rewrites of metrics_file
+    - obstacle_speed / target_speed: top speed per axis of a randomly
+      spawned obstacle / target, simulation coordinates per second
+      (0 = static); they move in straight lines and bounce off the walls
  */
 typedef struct {
     // World geometry (simulation coordinates)
@@ -53,19 +103,103 @@ typedef struct {
     int    initial_targets;         
     double obstacle_spawn_interval; 
     double target_spawn_interval;   
+
+    // Obstacle collisions
+    int    collision_response;
+    double restitution;
+
+    // Adaptive sub-stepping
+    int    max_substeps;
+
+    // Precomputed wall repulsion table
+    int    wall_lut_size;
+
+    // Cached obstacle repulsion field
+    double obstacle_field_cell;
+
+    // Deterministic layout / spawn schedule
+    char     scenario_path[SIM_PARAMS_PATH_MAX];
+    uint64_t rng_seed;
+
+    // CPU pinning / real-time scheduling, indexed by SIM_ROLE_*
+    uint64_t cpu_mask[SIM_ROLE_COUNT];
+    int      rt_priority[SIM_ROLE_COUNT];
+    int      mlock_all;
+    double   jitter_report_interval;
+
+    // Runtime observers (second UI, recorder, exporter)
+    char     observer_socket[SIM_PARAMS_PATH_MAX];
+    int      max_observers;
+    int      snapshot_slots;
+
+    // Counter export for dashboards
+    char     metrics_file[SIM_PARAMS_PATH_MAX];
+    double   metrics_interval;
+
+    // Moving obstacles / targets
+    double   obstacle_speed;
+    double   target_speed;
 } SimParams;
 
 /* 
     Load parameters from a text file.
     
-    If path is NULL, SIM_PARAMS_DEFAULT_PATH is used
-    On error, reasonable defaults (from sim_const.h) remain in effect
+    If path is NULL, the block published by master (SIM_PARAMS_FD) is
+    mapped if present and valid; otherwise SIM_PARAMS_PATH or
+    SIM_PARAMS_DEFAULT_PATH is parsed. Once a set has been loaded,
+    later NULL loads return it unchanged (role threads of the
+    single-process build share the set loaded by sim_threaded).
+
+    Format: "key value" per line, '#' / '//' comments, optional
+    "[section]" lines (a key under the wrong section is rejected) and
+    "include <path>" relative to the including file. Every value is
+    type- and range-checked; rejected lines are reported as file:line on
+    stderr and the key keeps its default (from sim_const.h).
     Returns:
     0 on success
-    -1 on failure (file unreadable / parse error)
+    -1 on failure (file unreadable / some lines rejected)
  */
 int sim_params_load(const char *path);
 
+/*
+    Publish the current parameter set as a versioned, checksummed binary
+    block in an anonymous shared file (memfd) and export its fd number in
+    SIM_PARAMS_FD, so children forked/exec'd afterwards inherit it and load
+    with zero parsing. Called by master after sim_params_load().
+    Returns the fd, or -1 on failure (children then parse the file).
+ */
+int sim_params_publish(void);
+
+/*
+    Live reload (master side).
+
+    Re-parse the config (path NULL = same resolution as sim_params_load)
+    starting from factory defaults and publish it as the next generation
+    of the shared block. Keys that size arrays, pipes or buffers (world
+    size, obstacle/target caps and initial counts, obstacle_field_cell)
+    keep their current value until restart, and so do scenario_file and
+    rng_seed.
+    Returns 1 if a new generation was published, 0 if nothing changed,
+    -1 if the file could not be read (current generation stays).
+ */
+int sim_params_reload(const char *path);
+
+/*
+    Live reload (children side), call at a tick boundary.
+
+    If master published a newer generation, copy it into the parameter set
+    returned by sim_params_get() and return 1 (caller rebuilds anything
+    derived from the parameters). Returns 0 otherwise; costs one atomic
+    load when nothing changed.
+ */
+int sim_params_refresh(void);
+
+// Generation of the parameter set in use (0 = as loaded at startup)
+unsigned long sim_params_generation(void);
+
+// Config path sim_params_load(path) would read
+const char *sim_params_resolve_path(const char *path);
+
 // Return a pointer to the current parameter set
 const SimParams *sim_params_get(void);
 // Convenience copy 
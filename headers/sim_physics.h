@@ -0,0 +1,482 @@
+/*
+    Drone physics shared by bb_server, drone and offline tools.
+
+    Everything in here is pure computation: no globals, no I/O and no
+    allocation. Batch functions work on caller-provided buffers so the same
+    code can step one drone inside a process or thousands of query points
+    in a benchmark / replay tool.
+
+    - Repulsion: Latombe / Khatib-style law used for walls and obstacles.
+    - Hit tests: segment vs circle, used for targets; a target index
+      (grid + id table) keeps them sublinear in the number of targets.
+    - Integrator: explicit Euler with viscous damping, deadzone and walls.
+    - Collisions: swept (continuous) drone-vs-obstacle test with a uniform
+      grid broad phase, so fast drones / large dt cannot tunnel through.
+    - Wall lookup table: the wall law tabulated once per (rho, eta) so the
+      per-tick cost is a couple of table reads.
+    - Obstacle field: obstacle repulsion rasterized on a grid, updated per
+      obstacle when one is added / replaced, sampled bilinearly per tick.
+    - Kinematics: moving obstacles / targets as closed-form trajectories
+      (straight line folded at the walls), advanced in one SoA batch.
+*/
+
+#include <stddef.h>
+
+#ifndef SIM_PHYSICS_H
+#define SIM_PHYSICS_H
+
+#include "sim_types.h"
+#include "sim_params.h"
+
+// Below this distance repulsion is ignored to avoid insane 1/d^3 spikes
+#define SIM_PHYS_MIN_DIST        0.1
+
+// Obstacles use a slightly BIGGER perception radius than walls: rho * 1.5
+#define SIM_PHYS_OBS_RHO_SCALE   1.5
+
+// Velocities below this are snapped to zero (visual jitter near rest)
+#define SIM_PHYS_VEL_DEADZONE    0.01
+
+// Target hit radius in world coordinates
+#define SIM_PHYS_HIT_RADIUS      1.0
+
+// Adaptive sub-stepping: explicit Euler keeps h * (K + K_rep) / M below
+// this, and a step inside a repulsion field moves at most this * rho
+#define SIM_PHYS_SUBSTEP_SAFETY  0.5
+#define SIM_PHYS_SUBSTEP_MOVE    0.1
+
+// Collision response modes (params->collision_response)
+#define SIM_COLLISION_OFF        0   // obstacles act only through repulsion
+#define SIM_COLLISION_STOP       1   // stop at contact, kill velocity into it
+#define SIM_COLLISION_BOUNCE     2   // reflect normal velocity * restitution
+
+// Broad phase capacity (cells in the grid, obstacle-cell pairs)
+#define SIM_PHYS_GRID_MAX_CELLS  1024
+#define SIM_PHYS_GRID_MAX_ITEMS  (SIM_MAX_OBSTACLES * 9)
+
+/*
+    Uniform grid over the world, each cell lists the obstacles whose
+    bounding box overlaps it (CSR layout: cell c owns
+    items[cell_start[c] .. cell_start[c + 1] - 1]).
+    If the items do not fit, overflow is set and queries fall back to
+    testing every obstacle.
+*/
+typedef struct {
+    double cell;
+    int    cols;
+    int    rows;
+    int    overflow;
+    int    cell_start[SIM_PHYS_GRID_MAX_CELLS + 1];
+    int    items[SIM_PHYS_GRID_MAX_ITEMS];
+} SimObstacleGrid;
+
+// Target index capacity (cells; id table slots, load factor <= 1/2)
+#define SIM_PHYS_TINDEX_MAX_CELLS  1024
+#define SIM_PHYS_TINDEX_ID_SLOTS   (2 * SIM_MAX_TARGETS)
+
+/*
+    Uniform grid over the world holding each active target slot in the
+    cell of its center (doubly linked per-cell lists), plus an id -> slot
+    table (open addressing). Moving, adding or removing one target is
+    O(1); a segment query only visits the cells around the segment.
+    cell_of[slot] == -1: slot not indexed.
+*/
+typedef struct {
+    double cell;
+    int    cols;
+    int    rows;
+    int    count;
+    int    head[SIM_PHYS_TINDEX_MAX_CELLS];
+    int    next[SIM_MAX_TARGETS];
+    int    prev[SIM_MAX_TARGETS];
+    int    cell_of[SIM_MAX_TARGETS];
+    int    id_of[SIM_MAX_TARGETS];
+    int    id_key[SIM_PHYS_TINDEX_ID_SLOTS];
+    int    id_slot[SIM_PHYS_TINDEX_ID_SLOTS];   // -1 = empty
+} SimTargetIndex;
+
+// Kinematics capacity: the bigger of the obstacle and target arrays
+#define SIM_PHYS_KIN_MAX  SIM_MAX_OBSTACLES
+
+/*
+    Trajectories of obstacles or targets, structure of arrays so
+    sim_physics_kin_advance() is one branch-free loop per component.
+    Slot i moves from (x0, y0) at time t0 with (vx, vy), reflected
+    between lo and lo + span on each axis: the fold of a straight line,
+    so any time maps to a position with no step-by-step state, and two
+    processes holding the same trajectory agree without messages.
+    A static slot has lo = its position: the fold leaves it alone.
+*/
+typedef struct {
+    double width;                    // world size
+    double height;
+    int    count;                    // slots 0 .. count - 1 are advanced
+    int    moving;                   // slots with a nonzero velocity
+    double t0[SIM_PHYS_KIN_MAX];
+    double u0x[SIM_PHYS_KIN_MAX];    // start offset from lo
+    double u0y[SIM_PHYS_KIN_MAX];
+    double vx[SIM_PHYS_KIN_MAX];
+    double vy[SIM_PHYS_KIN_MAX];
+    double lo_x[SIM_PHYS_KIN_MAX];
+    double lo_y[SIM_PHYS_KIN_MAX];
+    double span_x[SIM_PHYS_KIN_MAX];
+    double span_y[SIM_PHYS_KIN_MAX];
+
+    // Output of the last advance: position and current velocity
+    double x[SIM_PHYS_KIN_MAX];
+    double y[SIM_PHYS_KIN_MAX];
+    double cvx[SIM_PHYS_KIN_MAX];
+    double cvy[SIM_PHYS_KIN_MAX];
+} SimKinematics;
+
+// Upper bound on wall lookup table samples (params->wall_lut_size)
+#define SIM_PHYS_WALL_LUT_MAX    4096
+
+// Upper bound on obstacle field nodes (16 MB for gx + gy)
+#define SIM_PHYS_FIELD_MAX_NODES (1u << 20)
+
+/*
+    Wall repulsion gain eta * (1/d - 1/rho) / d^2 (force per unit speed)
+    sampled uniformly on [SIM_PHYS_MIN_DIST, rho]. size == 0 means the
+    table is disabled and the exact law is used.
+*/
+typedef struct {
+    int    size;
+    double rho;
+    double eta;
+    double d_min;
+    double inv_step;
+    double gain[SIM_PHYS_WALL_LUT_MAX];
+} SimWallLut;
+
+/*
+    Obstacle repulsion gain (force per unit speed, pointing away from the
+    obstacles) stored at the nodes of a regular grid covering the world:
+    node (i, j) sits at (i * cell, j * cell), index j * nx + i.
+    gx / gy are caller-provided buffers of capacity nodes each.
+    applied[] remembers what is currently rasterized so updates only touch
+    the obstacles that changed. cell == 0 means the field is disabled.
+*/
+typedef struct {
+    double    cell;
+    int       nx;
+    int       ny;
+    double    rho;
+    double    eta;
+    double   *gx;
+    double   *gy;
+    size_t    capacity;
+    int       num_applied;
+    Obstacle  applied[SIM_MAX_OBSTACLES];
+} SimObstacleField;
+
+/*
+    Everything the force model needs besides the drone itself. Pointers
+    may be NULL (no obstacles / no broad phase / exact wall law / exact
+    obstacle law).
+*/
+typedef struct {
+    const Obstacle         *obstacles;
+    int                     num_obstacles;
+    const SimObstacleGrid  *grid;
+    const SimWallLut       *wall_lut;
+    const SimObstacleField *field;
+} SimEnv;
+
+/*
+    Repulsive force magnitude:
+
+    F_rep(d) = eta * (1/d - 1/rho) * (1/d^2) * |v|
+    only if SIM_PHYS_MIN_DIST < d <= rho, 0 otherwise.
+    Direction (sign) is handled by the caller.
+*/
+double sim_physics_repulsive_force(double distance,
+                                   double eta,
+                                   double rho,
+                                   double vx,
+                                   double vy);
+
+/*
+    Wall repulsion for a drone inside [0, world_width] x [0, world_height].
+    LEFT/BOTTOM walls push +x/+y, RIGHT/TOP walls push -x/-y.
+*/
+void sim_physics_wall_repulsion(const SimParams  *params,
+                                const DroneState *drone,
+                                double           *out_fx,
+                                double           *out_fy);
+
+/*
+    Obstacle repulsion: same law, vector points AWAY from each active
+    obstacle, perception radius rho * SIM_PHYS_OBS_RHO_SCALE.
+*/
+void sim_physics_obstacle_repulsion(const SimParams  *params,
+                                    const DroneState *drone,
+                                    const Obstacle   *obstacles,
+                                    int               num_obstacles,
+                                    double           *out_fx,
+                                    double           *out_fy);
+
+/*
+    Wall lookup table.
+
+    sim_physics_wall_lut_build():
+        tabulate the wall law for params->rho / params->eta with
+        params->wall_lut_size samples (0 disables it). Call after
+        sim_params_load() and again whenever rho / eta change.
+
+    sim_physics_wall_repulsion_lut():
+        same result as sim_physics_wall_repulsion() (up to interpolation
+        error), one table read per wall in range.
+*/
+void sim_physics_wall_lut_build(SimWallLut *lut, const SimParams *params);
+
+void sim_physics_wall_repulsion_lut(const SimWallLut *lut,
+                                    const SimParams  *params,
+                                    const DroneState *drone,
+                                    double           *out_fx,
+                                    double           *out_fy);
+
+/*
+    Obstacle field.
+
+    sim_physics_field_nodes():
+        number of grid nodes (per component) needed for
+        params->obstacle_field_cell, 0 if the field is disabled or the
+        cell is so small the grid would exceed SIM_PHYS_FIELD_MAX_NODES.
+
+    sim_physics_field_init():
+        attach caller storage (capacity nodes in gx and gy) and clear the
+        field. Returns 0 on success, -1 if disabled or storage too small
+        (the field then stays disabled and sampling is never used).
+
+    sim_physics_field_update():
+        bring the field in line with obstacles[0..n-1]: every slot whose
+        obstacle differs from the applied one is removed and re-added.
+        Cost depends on the changed obstacles only.
+
+    sim_physics_field_sample():
+        bilinear lookup at the drone position scaled by |v|.
+*/
+size_t sim_physics_field_nodes(const SimParams *params);
+
+int sim_physics_field_init(SimObstacleField *field,
+                           const SimParams  *params,
+                           double           *gx,
+                           double           *gy,
+                           size_t            capacity);
+
+void sim_physics_field_update(SimObstacleField *field,
+                              const Obstacle   *obstacles,
+                              int               num_obstacles);
+
+void sim_physics_field_sample(const SimObstacleField *field,
+                              const DroneState       *drone,
+                              double                 *out_fx,
+                              double                 *out_fy);
+
+/*
+    Wall + obstacle repulsion for one drone, using the environment's
+    lookup structures when present. Walls and obstacles are reported
+    separately (bb_server logs wall contacts on their own).
+*/
+void sim_physics_env_repulsion(const SimParams  *params,
+                               const SimEnv     *env,
+                               const DroneState *drone,
+                               double           *out_fx_wall,
+                               double           *out_fy_wall,
+                               double           *out_fx_obs,
+                               double           *out_fy_obs);
+
+// Returns 1 if segment [x0,y0] -> [x1,y1] intersects circle (cx,cy,r)
+int sim_physics_segment_hits_circle(double x0, double y0,
+                                    double x1, double y1,
+                                    double cx, double cy,
+                                    double r);
+
+/*
+    One explicit Euler step of M * a = F - K * v over dt, followed by the
+    velocity deadzone and the world bounds (position clamp + velocity into
+    the wall killed).
+*/
+void sim_physics_step(DroneState      *drone,
+                      double           fx,
+                      double           fy,
+                      const SimParams *params,
+                      double           dt);
+
+/*
+    Batch API (caller-provided buffers, no allocation).
+
+    sim_physics_step_batch():
+        steps n drones, drone i is driven by (fx[i], fy[i]).
+
+    sim_physics_forces_batch():
+        total wall + obstacle repulsion at m query states, written to
+        out_fx[0..m-1] / out_fy[0..m-1].
+
+    sim_physics_targets_hit():
+        segment [x0,y0] -> [x1,y1] against every active target with
+        radius hit_radius. Writes up to max_hits indices into out_idx and
+        returns how many were written.
+*/
+void sim_physics_step_batch(DroneState      *drones,
+                            const double    *fx,
+                            const double    *fy,
+                            int              n,
+                            const SimParams *params,
+                            double           dt);
+
+void sim_physics_forces_batch(const SimParams  *params,
+                              const DroneState *queries,
+                              int               m,
+                              const Obstacle   *obstacles,
+                              int               num_obstacles,
+                              double           *out_fx,
+                              double           *out_fy);
+
+int sim_physics_targets_hit(double        x0,
+                            double        y0,
+                            double        x1,
+                            double        y1,
+                            const Target *targets,
+                            int           num_targets,
+                            double        hit_radius,
+                            int          *out_idx,
+                            int           max_hits);
+
+/*
+    Continuous collision detection.
+
+    sim_physics_grid_build():
+        (re)build the broad phase after the obstacle set changed.
+
+    sim_physics_sweep_obstacles():
+        earliest contact of the motion [x0,y0] -> [x1,y1] with any active
+        obstacle circle. Returns the obstacle index (or -1) and writes the
+        time of impact t in [0,1] and the outward contact normal.
+        Motions that start inside a circle are ignored so a drone that got
+        an obstacle spawned on top of it can still leave.
+
+    sim_physics_resolve_collision():
+        sweep from (x0,y0) to the drone's current position and, on contact,
+        move it back to the contact point and apply the response selected
+        by params->collision_response. Returns the obstacle index hit or -1.
+*/
+void sim_physics_grid_build(SimObstacleGrid *grid,
+                            const SimParams *params,
+                            const Obstacle  *obstacles,
+                            int              num_obstacles);
+
+int sim_physics_sweep_obstacles(const SimObstacleGrid *grid,
+                                const Obstacle        *obstacles,
+                                int                    num_obstacles,
+                                double x0, double y0,
+                                double x1, double y1,
+                                double *out_t,
+                                double *out_nx,
+                                double *out_ny);
+
+int sim_physics_resolve_collision(DroneState            *drone,
+                                  double                 x0,
+                                  double                 y0,
+                                  const SimObstacleGrid *grid,
+                                  const Obstacle        *obstacles,
+                                  int                    num_obstacles,
+                                  const SimParams       *params);
+
+/*
+    Target index.
+
+    sim_physics_tindex_init():
+        empty index over the world, cells sized for hit_radius.
+
+    sim_physics_tindex_set():
+        re-index targets[slot] after it changed (moved, respawned, new id,
+        deactivated). O(1).
+
+    sim_physics_tindex_find():
+        slot holding target id, or -1. O(1) on average.
+
+    sim_physics_tindex_hit():
+        same result as sim_physics_targets_hit() over the indexed slots
+        (indices in ascending order, so respawn draws stay reproducible),
+        testing only targets in the cells the segment can reach.
+*/
+void sim_physics_tindex_init(SimTargetIndex  *ix,
+                             const SimParams *params,
+                             double           hit_radius);
+
+void sim_physics_tindex_set(SimTargetIndex *ix, const Target *targets, int slot);
+
+int sim_physics_tindex_find(const SimTargetIndex *ix, int id);
+
+int sim_physics_tindex_hit(const SimTargetIndex *ix,
+                           const Target         *targets,
+                           double x0, double y0,
+                           double x1, double y1,
+                           double                hit_radius,
+                           int                  *out_idx,
+                           int                   max_hits);
+
+/*
+    Kinematics (times are CLOCK_MONOTONIC seconds).
+
+    sim_physics_kin_init():
+        count static, empty slots in a world of the params' size.
+
+    sim_physics_kin_set():
+        slot starts at (x, y) at time t0 with velocity (vx, vy), bouncing
+        inside the world shrunk by radius. O(1).
+
+    sim_physics_kin_advance():
+        position and current velocity of every slot at time t into
+        x / y / cvx / cvy. O(count), no branches in the loop.
+
+    sim_physics_kin_set_obstacles() / sim_physics_kin_set_target():
+        load obstacles[0 .. slots-1] / one target slot, as of time t0.
+
+    sim_physics_kin_get_obstacles() / sim_physics_kin_get_targets():
+        copy the last advance back into the active entries.
+*/
+void sim_physics_kin_init(SimKinematics *k, const SimParams *params, int count);
+
+void sim_physics_kin_set(SimKinematics *k, int slot,
+                         double x, double y, double vx, double vy,
+                         double radius, double t0);
+
+void sim_physics_kin_advance(SimKinematics *k, double t);
+
+void sim_physics_kin_set_obstacles(SimKinematics *k, const Obstacle *obstacles,
+                                   int slots, double t0);
+void sim_physics_kin_set_target(SimKinematics *k, const Target *targets,
+                                int slot, double t0);
+void sim_physics_kin_get_obstacles(const SimKinematics *k, Obstacle *obstacles, int slots);
+void sim_physics_kin_get_targets(const SimKinematics *k, Target *targets, int slots);
+
+/*
+    Adaptive step of one drone tick of length dt.
+
+    The force model is user force (fx, fy) + wall repulsion + obstacle
+    repulsion (sim_physics_env_repulsion), re-evaluated at the start of
+    every sub-step. The repulsion
+    law grows like |v| / d^3, so it acts as an extra velocity stiffness
+    K_rep = |F_rep| / |v| on top of the damping K. Sub-step length h is the
+    largest of dt that keeps
+      - h * (K + K_rep) / M <= SIM_PHYS_SUBSTEP_SAFETY  (Euler stability)
+      - |v| * h <= SIM_PHYS_SUBSTEP_MOVE * rho           (inside a field)
+    so free flight takes a single step and contacts get subdivided.
+    At most params->max_substeps steps are taken; the last one absorbs
+    whatever time is left. Every sub-step is swept against the obstacles.
+
+    Returns the number of sub-steps taken; *out_hit receives the first
+    obstacle index hit during the tick or -1.
+*/
+int sim_physics_step_adaptive(DroneState      *drone,
+                              double           fx,
+                              double           fy,
+                              const SimParams *params,
+                              const SimEnv    *env,
+                              double           dt,
+                              int             *out_hit);
+
+#endif
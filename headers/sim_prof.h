@@ -0,0 +1,72 @@
+/*
+    Scoped timing zones for the simulation loops (build with -DSIM_PROFILE=ON).
+
+    SIM_PROF_ZONE("name") at the top of a block records one complete
+    event (start, duration) when the block is left, into a buffer owned
+    by the calling thread: no lock and no shared cache line on the hot
+    path. A full buffer, and SIM_PROF_FLUSH() at the end of a role, append
+    the thread's events to one trace file in the Chrome trace-event JSON
+    format (array form, which allows the closing ']' to be missing, so
+    every process can append to it). Timestamps are CLOCK_MONOTONIC, so
+    all processes land on one timeline: open the file in about:tracing
+    or ui.perfetto.dev.
+
+    master / sim_threaded call SIM_PROF_OPEN() once: it truncates the
+    file and exports its path in SIM_PROF_FILE for the children.
+
+    Without SIM_PROFILE every macro expands to nothing and sim_prof.c is
+    not even built.
+*/
+
+#ifndef SIM_PROF_H
+#define SIM_PROF_H
+
+#ifdef SIM_PROFILE
+
+#include <stdint.h>
+
+#define SIM_PROF_FILE_ENV      "SIM_PROF_FILE"
+#define SIM_PROF_DEFAULT_FILE  "../../bin/log/sim_trace.json"
+
+// Events a thread buffers before appending them to the file
+#define SIM_PROF_RING  8192
+
+typedef struct {
+    const char *name;      // string literal: only the pointer is kept
+    uint64_t    start_ns;
+} SimProfZone;
+
+// master / sim_threaded: truncate the trace, export its path. 0 or -1.
+int sim_prof_open(void);
+
+// Name the calling thread in the trace (role name)
+void sim_prof_thread(const char *name);
+
+SimProfZone sim_prof_begin(const char *name);
+void        sim_prof_end(SimProfZone *zone);
+
+// Append the calling thread's buffered events to the trace
+void sim_prof_flush(void);
+
+#define SIM_PROF_CAT2(a, b) a##b
+#define SIM_PROF_CAT(a, b)  SIM_PROF_CAT2(a, b)
+
+// The zone ends with the enclosing block (cleanup attribute, GCC / Clang)
+#define SIM_PROF_ZONE(name)                                               \
+    SimProfZone SIM_PROF_CAT(sim_prof_zone_, __LINE__)                    \
+        __attribute__((cleanup(sim_prof_end))) = sim_prof_begin(name)
+
+#define SIM_PROF_OPEN()        sim_prof_open()
+#define SIM_PROF_THREAD(name)  sim_prof_thread(name)
+#define SIM_PROF_FLUSH()       sim_prof_flush()
+
+#else
+
+#define SIM_PROF_ZONE(name)    do { } while (0)
+#define SIM_PROF_OPEN()        0
+#define SIM_PROF_THREAD(name)  do { } while (0)
+#define SIM_PROF_FLUSH()       do { } while (0)
+
+#endif
+
+#endif
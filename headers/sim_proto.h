@@ -0,0 +1,177 @@
+/*
+    Wire protocol between the processes (pipes / sim_ipc channels).
+
+    Every message is a frame: a 12-byte header followed by a packed
+    payload. Everything is little-endian, floats are IEEE float32, and
+    there is no padding and no struct timespec on the wire.
+
+      header:  u8  magic      SIM_PROTO_MAGIC
+               u8  version    SIM_PROTO_VERSION
+               u8  type       SIM_MSG_*
+               u8  flags      0 (reserved)
+               u16 length     payload bytes
+               u16 seq        per-writer sequence number (wraps)
+               u32 time_us    sender CLOCK_MONOTONIC in us (wraps, use deltas)
+
+      SIM_MSG_COMMAND      f32 fx, f32 fy, u8 flags (brake | reset << 1 |
+                           quit << 2), i16 last_key               (11 bytes)
+      SIM_MSG_DRONE_STATE  f32 x, y, vx, vy                       (16 bytes)
+      SIM_MSG_OBSTACLES    u16 slots, u16 count, count x
+                           { u16 slot, f32 x, y, radius, vx, vy }
+                                                              (4 + 22 n)
+      SIM_MSG_TARGETS      u16 slots, u16 count, u32 epoch, count x
+                           { u16 slot, i32 id, f32 x, y, radius, vx, vy }
+                                                              (8 + 26 n)
+      SIM_MSG_TARGET_CHANGES
+                           u16 slots, u16 count, count x the
+                           SIM_MSG_TARGETS entry              (4 + 26 n)
+      SIM_MSG_TARGET_HITS  u16 count, u32 epoch, count x i32 id
+                                                              (6 + 4 n)
+
+    Obstacle / target messages carry the active slots only; the receiver
+    clears the other slots of the array. A target change list carries the
+    slots that changed only (id 0: the slot is now empty) and leaves the
+    others alone. Target hits go the other way, bb_server -> targets,
+    tagged with the epoch of the last full set bb_server applied: each
+    targets instance sends its own (master's restart count of the role),
+    so it can tell reports against a previous instance's ids from its own.
+
+    Obstacles and targets are sent as trajectories: position and velocity
+    at the frame's time_us. Receivers move them on their own
+    (sim_physics_kin_*), so a moving world costs no more messages than a
+    static one.
+
+    Frames are self-describing, so one channel can carry several types
+    (bb_server -> drone carries commands and obstacle sets) and a reader
+    that lost sync (bad magic / version / length) skips bytes until the
+    next valid header instead of misreading every later message.
+    Writers queue frames in a SimMsgWriter and send the whole batch with
+    one write.
+*/
+
+#ifndef SIM_PROTO_H
+#define SIM_PROTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim_ipc.h"     // SimIpcRx
+#include "sim_types.h"
+
+#define SIM_PROTO_MAGIC        0xA7
+#define SIM_PROTO_VERSION      3
+#define SIM_PROTO_HEADER_SIZE  12
+
+// Largest payload a reader accepts (SIM_MAX_OBSTACLES / TARGETS fit)
+#define SIM_PROTO_MAX_PAYLOAD  2048
+
+// Bytes a writer can queue before it has to flush
+#define SIM_PROTO_BATCH_MAX    4096
+
+enum {
+    SIM_MSG_COMMAND        = 1,
+    SIM_MSG_DRONE_STATE    = 2,
+    SIM_MSG_OBSTACLES      = 3,
+    SIM_MSG_TARGETS        = 4,
+    SIM_MSG_TARGET_CHANGES = 5,
+    SIM_MSG_TARGET_HITS    = 6
+};
+
+typedef struct {
+    uint8_t  type;
+    uint8_t  flags;
+    uint16_t length;
+    uint16_t seq;
+    uint32_t time_us;
+} SimMsgHeader;
+
+typedef struct {
+    SimMsgHeader h;
+    uint8_t      payload[SIM_PROTO_MAX_PAYLOAD];
+} SimMsg;
+
+// One per outgoing fd: sequence counter + batch buffer
+typedef struct {
+    uint16_t seq;
+    size_t   len;
+    uint8_t  buf[SIM_PROTO_BATCH_MAX];
+} SimMsgWriter;
+
+// One per incoming fd: sequence tracking + error counters
+typedef struct {
+    uint16_t      next_seq;
+    int           have_seq;
+    unsigned long frames;
+    unsigned long gaps;          // frames missing according to seq
+    unsigned long resync_bytes;  // bytes skipped looking for a header
+} SimMsgReader;
+
+void sim_proto_writer_init(SimMsgWriter *w);
+void sim_proto_reader_init(SimMsgReader *r);
+
+/*
+    Queue one frame. Returns 0, or -1 if the batch has no room left
+    (flush first).
+*/
+int sim_proto_put_command(SimMsgWriter *w, const CommandState *c);
+int sim_proto_put_drone_state(SimMsgWriter *w, const DroneState *d);
+int sim_proto_put_obstacles(SimMsgWriter *w, const Obstacle *o, int slots);
+int sim_proto_put_targets(SimMsgWriter *w, const Target *t, int slots,
+                          uint32_t epoch);
+int sim_proto_put_target_changes(SimMsgWriter *w, const Target *t,
+                                 const int *changed, int n, int slots);
+int sim_proto_put_target_hits(SimMsgWriter *w, uint32_t epoch,
+                              const int *ids, int n);
+
+// Send every queued frame with one write. Returns 0, or -1 on error.
+int sim_proto_flush(int fd, SimMsgWriter *w);
+
+/*
+    Non-blocking alternative to sim_proto_flush(): move the frames
+    queued in w into an outbound queue as one message, keyed by the
+    type of its first frame (so SIM_IPC_TX_OVERWRITE replaces an older
+    unsent message of the same type). Returns sim_ipc_tx_push()'s result.
+*/
+int sim_proto_queue(SimIpcTx *q, SimMsgWriter *w, SimIpcTxPolicy policy);
+
+/*
+    Decode the first frame of a buffer (one SOCK_SEQPACKET record holds
+    a whole batch). Returns the bytes consumed, with *m filled, or 0 if
+    no complete valid frame starts at buf.
+*/
+size_t sim_proto_decode(const void *buf, size_t len, SimMsgReader *r, SimMsg *m);
+
+/*
+    Take the next whole frame out of a receive buffer filled with
+    sim_ipc_rx_fill() (drain everything one read returned, frame by
+    frame). Returns 1 with *m filled, 0 when the rest is a partial frame
+    (or empty). Bytes that cannot start a frame are skipped (resync).
+*/
+int sim_proto_next(SimIpcRx *rx, SimMsgReader *r, SimMsg *m);
+
+/*
+    Decode a payload of the matching type. Return 0, or -1 if the
+    payload does not have the size its type requires (frame ignored).
+    get_obstacles / get_targets clear slots 0..slots-1 first and return
+    the number of active entries. get_target_changes writes the listed
+    slots only and returns how many (their indices in changed[], each
+    once, so changed[] needs room for `slots` entries);
+    get_target_hits returns the number of ids stored (at most max).
+    The epoch of a target set / hit report goes to *epoch (get_targets
+    accepts NULL).
+*/
+int sim_proto_get_command(const SimMsg *m, CommandState *c);
+int sim_proto_get_drone_state(const SimMsg *m, DroneState *d);
+int sim_proto_get_obstacles(const SimMsg *m, Obstacle *o, int slots);
+int sim_proto_get_targets(const SimMsg *m, Target *t, int slots, uint32_t *epoch);
+int sim_proto_get_target_changes(const SimMsg *m, Target *t, int slots, int *changed);
+int sim_proto_get_target_hits(const SimMsg *m, uint32_t *epoch, int *ids, int max);
+
+/*
+    Sender CLOCK_MONOTONIC time of a frame in seconds, rebuilt from its
+    32-bit time_us (frames younger than ~71 minutes): the epoch of the
+    trajectories it carries.
+*/
+double sim_proto_time_s(const SimMsg *m);
+
+#endif
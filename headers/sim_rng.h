@@ -0,0 +1,53 @@
+/*
+    Small, fast, per-process random number generator (xoshiro256**).
+
+    No global state: every user owns a SimRng. Generators are seeded from
+    a 64-bit seed plus a stream id through splitmix64, so processes that
+    share the run seed (rng_seed / scenario seed) still draw independent,
+    reproducible sequences. sim_rng_split() derives a further independent
+    generator (2^128 jump) when one stream needs sub-streams.
+*/
+
+#ifndef SIM_RNG_H
+#define SIM_RNG_H
+
+#include <stdint.h>
+
+// Stream ids: one per entity stream so they never overlap
+#define SIM_RNG_STREAM_OBSTACLES  1u
+#define SIM_RNG_STREAM_TARGETS    2u
+
+typedef struct {
+    uint64_t s[4];
+} SimRng;
+
+// Seed generator state from (seed, stream)
+void sim_rng_seed(SimRng *rng, uint64_t seed, uint64_t stream);
+
+// Non-reproducible seed (clock, pid, address) for runs without rng_seed
+uint64_t sim_rng_entropy(void);
+
+// Next raw 64-bit output
+uint64_t sim_rng_next(SimRng *rng);
+
+// Uniform double in [0, 1), 53 random bits
+double sim_rng_uniform(SimRng *rng);
+
+/*
+    Fill xs[0..n-1] / ys[0..n-1] with points uniform in
+    [x0, x0 + w) x [y0, y0 + h). Draw order is x0, y0, x1, y1, ... so a
+    batch of n equals n single draws.
+*/
+void sim_rng_uniform_points(SimRng *rng,
+                            double  x0,
+                            double  y0,
+                            double  w,
+                            double  h,
+                            double *xs,
+                            double *ys,
+                            int     n);
+
+// Copy rng into child, then advance rng by 2^128 steps
+void sim_rng_split(SimRng *rng, SimRng *child);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+    Role entry points.
+
+    Every role (bb_server, drone, input, obstacles, targets) is normally
+    its own executable started by master. With SIM_SINGLE_PROCESS defined
+    the same sources are compiled into one binary (sim_threaded) and each
+    role runs on its own thread:
+
+    - SIM_ROLE_MAIN(name) declares the role's entry point: main() in the
+      multi-process build, sim_<name>_main() in the single-process one.
+    - SIM_ROLE_SIGNAL(sig, handler) installs the role's SIGINT handler.
+      In one process there is a single disposition per signal, so
+      sim_threaded keeps a list and calls every registered handler.
+
+    Pipes are replaced by sim_ipc_channel() in that build; roles close
+    their fds with sim_ipc_close(), which handles both.
+
+    SIM_ROLE_* number the roles for the heartbeat block and the per-role
+    parameters (CPU set, real-time priority).
+*/
+
+#ifndef SIM_ROLE_H
+#define SIM_ROLE_H
+
+#include <signal.h>
+
+#define SIM_ROLE_BB_SERVER     0
+#define SIM_ROLE_INPUT         1
+#define SIM_ROLE_DRONE         2
+#define SIM_ROLE_OBSTACLES     3
+#define SIM_ROLE_TARGETS       4
+#define SIM_ROLE_COUNT         5
+
+#ifdef SIM_SINGLE_PROCESS
+
+#define SIM_ROLE_MAIN(name)            int sim_##name##_main(int argc, char *argv[])
+#define SIM_ROLE_SIGNAL(sig, handler)  sim_threaded_signal((sig), (handler))
+
+int sim_bb_server_main(int argc, char *argv[]);
+int sim_drone_main(int argc, char *argv[]);
+int sim_input_main(int argc, char *argv[]);
+int sim_obstacles_main(int argc, char *argv[]);
+int sim_targets_main(int argc, char *argv[]);
+
+// Add handler to the handlers run when sig reaches the process
+void sim_threaded_signal(int sig, void (*handler)(int));
+
+#else
+
+#define SIM_ROLE_MAIN(name)            int main(int argc, char *argv[])
+#define SIM_ROLE_SIGNAL(sig, handler)  signal((sig), (handler))
+
+#endif
+
+#endif
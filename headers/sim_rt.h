@@ -0,0 +1,99 @@
+/*
+    Real-time setup and tick timing for the periodic loops.
+
+    sim_rt_apply() puts the calling role on the CPUs and scheduling
+    policy configured in the [realtime] section:
+
+        drone_cpus        0-1      CPU list, "all" = not pinned
+        drone_priority    80       0 = normal, 1..99 = SCHED_FIFO
+        mlock_all         1        lock all pages (no page faults later)
+
+    (same keys for bb_server, input, obstacles and targets). It is called
+    by each role at startup, so it works for processes started by master
+    and for the role threads of sim_threaded alike (affinity and policy
+    are per thread on Linux, mlockall is per process). Failures, usually
+    missing CAP_SYS_NICE / RLIMIT_RTPRIO / RLIMIT_MEMLOCK, are logged and
+    the role carries on with what it got.
+
+    SimPeriodic keeps a loop on an absolute CLOCK_MONOTONIC deadline grid
+    (deadline k = start + k * period), so the time spent processing a
+    tick does not stretch the period and the loop runs at exactly
+    1 / period on average. A tick that runs so late that whole periods
+    went by skips them (no burst of catch-up ticks) and counts them as
+    overruns.
+
+    SimJitter measures how far a loop's achieved period is from the
+    intended one and logs a summary every jitter_report_interval seconds.
+*/
+
+#ifndef SIM_RT_H
+#define SIM_RT_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Interval above period * this counts as late (a missed tick)
+#define SIM_JITTER_LATE_FACTOR 1.5
+
+typedef struct {
+    const char *label;         // log prefix, e.g. "drone: tick"
+    double      period;        // intended period, seconds
+    double      report_every;  // seconds, 0 = never log
+    double      last;          // previous tick, 0 = none yet
+    double      window_start;
+    long        n;             // intervals in this window
+    double      sum;           // of (interval - period)
+    double      sum_sq;
+    double      min_dev;
+    double      max_dev;
+    long        late;
+} SimJitter;
+
+typedef struct {
+    int64_t       next_ns;     // next deadline, CLOCK_MONOTONIC ns
+    int64_t       period_ns;
+    unsigned long ticks;       // deadlines consumed
+    unsigned long overruns;    // periods skipped because a tick ran late
+} SimPeriodic;
+
+/*
+    Apply cpu_mask / rt_priority of role (SIM_ROLE_*) and mlock_all to
+    the calling thread / process; name is the log prefix.
+    Returns 0 if everything configured was applied, -1 otherwise.
+*/
+int sim_rt_apply(int role, const char *name);
+
+// Start (or restart, e.g. after dt changed) a measurement window
+void sim_jitter_init(SimJitter *j, const char *label, double period,
+                     double report_every);
+
+// Record one tick at the current CLOCK_MONOTONIC time; logs when due
+void sim_jitter_tick(SimJitter *j);
+
+/*
+    Periodic deadlines.
+
+    sim_periodic_init():
+        first deadline one period from now.
+
+    sim_periodic_set_period():
+        change the period (config reload); the pending deadline moves to
+        previous deadline + new period, the grid is not restarted.
+
+    sim_periodic_deadline() / sim_periodic_remaining():
+        the pending deadline as an absolute time (for clock_nanosleep
+        TIMER_ABSTIME / sim_heartbeat_sleep_until) or as seconds left
+        (for select / poll timeouts, 0 once it has passed).
+
+    sim_periodic_poll():
+        0 if the deadline has not been reached yet. Otherwise advance to
+        the next deadline on the grid and return how many periods went
+        by (1 = on time, n > 1 = n - 1 overruns).
+*/
+void            sim_periodic_init(SimPeriodic *t, double period);
+void            sim_periodic_set_period(SimPeriodic *t, double period);
+struct timespec sim_periodic_deadline(const SimPeriodic *t);
+double          sim_periodic_remaining(const SimPeriodic *t);
+int             sim_periodic_poll(SimPeriodic *t);
+
+#endif
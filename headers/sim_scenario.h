@@ -0,0 +1,81 @@
+/*
+    Scenario files: fixed obstacle / target layouts, spawn schedules and
+    the RNG seed, so two runs of the same scenario are identical.
+
+    Text form (one entry per line, '#' comments):
+
+        seed            <u64>               seed for anything still random
+        obstacle        <x> <y> <radius>    present from the start
+        target          <x> <y> <radius>
+        spawn_obstacle  <t> <x> <y> <radius> spawned t seconds after start
+        spawn_target    <t> <x> <y> <radius>
+
+    Binary form: a SimScenarioHeader followed by all obstacle entries and
+    then all target entries, each list sorted by t. It is mmap'ed as is,
+    so large maps load without parsing or per-entity allocation.
+    sim_scenario_write_binary() (or the scenario_compile tool) converts
+    text to binary; sim_scenario_load() accepts either.
+*/
+
+#ifndef SIM_SCENARIO_H
+#define SIM_SCENARIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary header: magic 'SIMS' + layout version
+#define SIM_SCENARIO_MAGIC    0x534D4953u
+#define SIM_SCENARIO_VERSION  1
+
+typedef struct {
+    double t;        // seconds after start, 0 = initial layout
+    double x;
+    double y;
+    double radius;
+} SimScenarioEntity;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t seed;
+    uint32_t flags;          // SIM_SCENARIO_HAS_SEED
+    uint32_t num_obstacles;
+    uint32_t num_targets;
+    uint32_t reserved;
+} SimScenarioHeader;
+
+#define SIM_SCENARIO_HAS_SEED 0x1u
+
+typedef struct {
+    int                      has_seed;
+    uint64_t                 seed;
+
+    // Sorted by t; entries with t <= 0 come first and form the initial set
+    const SimScenarioEntity *obstacles;
+    int                      num_obstacles;
+    const SimScenarioEntity *targets;
+    int                      num_targets;
+
+    // Backing storage: a file mapping (binary) or a heap block (text)
+    void                    *map;
+    size_t                   map_size;
+    SimScenarioEntity       *owned;
+} SimScenario;
+
+/*
+    Load a scenario in either form (detected by the magic).
+    Errors are reported on stderr (file:line for text).
+    Returns 0 on success, -1 on failure (sc is left empty).
+*/
+int sim_scenario_load(const char *path, SimScenario *sc);
+
+// Write sc in binary form. Returns 0 on success, -1 on failure.
+int sim_scenario_write_binary(const SimScenario *sc, const char *path);
+
+// Number of leading entries with t <= 0 (the initial layout)
+int sim_scenario_initial_count(const SimScenarioEntity *list, int n);
+
+// Release the mapping / heap block and clear sc
+void sim_scenario_free(SimScenario *sc);
+
+#endif
@@ -0,0 +1,76 @@
+/*
+    World snapshot broadcast through shared memory.
+
+    bb_server publishes a WorldState per drone tick into a ring of slots
+    in the POSIX shared memory object SIM_SHM_WORLD. Any number of local
+    processes (viewer, recorder, analytics) map it read-mostly and follow
+    the ring at their own pace; the publisher never waits for them.
+
+    Each slot is a seqlock: the writer marks it odd while copying and
+    even (2 * seq + 2) when done, readers copy and re-check the mark, so
+    a torn copy is detected and thrown away instead of being used.
+    A subscriber that falls more than a ring behind jumps to the newest
+    snapshot; everything it skipped or lost to a torn copy is counted in
+    its subscriber slot, which the publisher reports at exit.
+*/
+
+#ifndef SIM_SNAPSHOT_H
+#define SIM_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim_ipc.h"     // SIM_SHM_WORLD
+#include "sim_types.h"
+
+#define SIM_SNAPSHOT_SHM        SIM_SHM_WORLD
+#define SIM_SNAPSHOT_MAX_SUBS   16
+#define SIM_SNAPSHOT_MAX_SLOTS  4096
+
+typedef struct {
+    uint64_t   seq;     // publish counter, starts at 0
+    double     t;       // publisher CLOCK_MONOTONIC seconds
+    WorldState world;
+} SimSnapshot;
+
+typedef struct SimSnapshotRing SimSnapshotRing;
+
+typedef struct {
+    SimSnapshotRing *ring;    // NULL = not attached
+    size_t           size;
+    int              sub;     // subscriber slot, -1 on the publisher side
+    uint64_t         next;    // subscriber: next seq to read
+} SimSnapshotHandle;
+
+/*
+    Publisher: create (replacing a stale object) a ring of `slots`
+    snapshots. Returns 0, or -1 with errno set (h stays detached and
+    publishing is a no-op).
+*/
+int  sim_snapshot_create(SimSnapshotHandle *h, int slots);
+void sim_snapshot_publish(SimSnapshotHandle *h, const WorldState *w);
+
+// Publisher: one log line per subscriber (received / dropped)
+void sim_snapshot_log_subscribers(const SimSnapshotHandle *h, const char *who);
+
+/*
+    Subscriber: attach and claim a subscriber slot, starting at the
+    newest snapshot. Returns 0, or -1 (no publisher, or every slot is
+    taken: errno EBUSY).
+*/
+int sim_snapshot_subscribe(SimSnapshotHandle *h);
+
+/*
+    Subscriber: copy the next snapshot into *out. Returns 1 if one was
+    copied, 0 if there is nothing new yet (poll again later), -1 once
+    the publisher has closed the ring and everything was read.
+*/
+int sim_snapshot_next(SimSnapshotHandle *h, SimSnapshot *out);
+
+// Subscriber: snapshots skipped so far
+unsigned long sim_snapshot_dropped(const SimSnapshotHandle *h);
+
+// Either side: detach (publisher also marks the ring closed and unlinks it)
+void sim_snapshot_close(SimSnapshotHandle *h);
+
+#endif
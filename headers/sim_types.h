@@ -37,9 +37,13 @@ typedef struct {
 
 
 
+// Obstacles and targets: position now, velocity (0 = static; moving ones
+// bounce off the walls, see sim_physics_kin_*)
 typedef struct {
     double x;       
     double y;
+    double vx;
+    double vy;
     double radius; 
     int    active;  
 } Obstacle;
@@ -47,6 +51,8 @@ typedef struct {
 typedef struct {
     double x;       
     double y;
+    double vx;
+    double vy;
     double radius;  
     int    id;     
     int    active;  
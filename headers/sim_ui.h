@@ -8,6 +8,8 @@
     - ui_show_start_menu(): full-screen start menu, returns a UiMenuChoice.
     - ui_show_instructions(): modal help/instructions screen.
     - ui_draw(): render the current world snapshot (map + inspection panel).
+    - ui_draw_metrics(): overlay the live metrics panel on the map (call
+      after ui_draw(), which repaints what the panel covered).
 
     NB: The UI is read-only: it only gets a WorldState instant and never
     modifies shared memory directly.
@@ -16,6 +18,7 @@
 #ifndef SIM_UI_H
 #define SIM_UI_H
 
+#include "sim_metrics.h"
 #include "sim_types.h"
 
 typedef enum {
@@ -34,4 +37,6 @@ void ui_show_instructions(void);
 
 void ui_draw(const WorldState *world);
 
+void ui_draw_metrics(const SimMetricsRates *rates);
+
 #endif
@@ -3,25 +3,37 @@
 #include <unistd.h>
 #include <signal.h>
 #include <errno.h>
+#include <string.h>
 #include <sys/select.h>
 #include <fcntl.h>
 #include <curses.h>
-#include <math.h>   
 #include <time.h>   
 
 #include "sim_types.h"
 #include "sim_ipc.h"
 #include "sim_const.h"
 #include "sim_log.h"
+#include "sim_metrics.h"
+#include "sim_heartbeat.h"
 #include "sim_ui.h"
 #include "sim_params.h"
+#include "sim_physics.h"
+#include "sim_prof.h"
+#include "sim_role.h"
+#include "sim_rt.h"
+#include "sim_proto.h"
+#include "sim_snapshot.h"
 
 // Crucial integer type used for providing variables that can be 
 // read and written by both the main prog and sign handler
 // without introducing race conditions. 
 static volatile sig_atomic_t running = 1; 
 
-void play(const char *filename) {
+// Screen refresh period: messages are handled as they arrive, the map is
+// redrawn on a fixed 30 Hz grid
+#define BB_FRAME_PERIOD_S (1.0 / 30.0)
+
+static void play(const char *filename) {
     pid_t pid = fork();
     if (pid == 0) {
         int fd = open("/dev/null", O_RDWR);
@@ -44,247 +56,109 @@ static void handle_sigint(int sig)
     running = 0;
 }
 
-/*
- * Latombe / Khatib-style repulsive force magnitude.
- *
- * distance       = distance to wall/obstacle (>= 0)
- * function_scale = eta (params->eta)
- * area_of_effect = rho0 (params->rho)
- * vel_x, vel_y   = drone velocity components
- *
- * F_rep(d) = eta * (1/d - 1/rho0) * (1/d^2) * |v|
- * only if 0 < d <= area_of_effect.
- * Direction (sign) is handled by the caller.
- */
-static double repulsive_force(double distance,
-                              double function_scale,
-                              double area_of_effect,
-                              double vel_x,
-                              double vel_y)
+static double now_s(void)
 {
-    if (function_scale <= 0.0 || area_of_effect <= 0.0) {
-        return 0.0;
-    }
-
-    // Avoid insane spikes and ignore outside radius
-    const double min_dist = 0.1;
-    if (distance <= min_dist || distance > area_of_effect) {
-        return 0.0;
-    }
-
-    double vel_mag = sqrt(vel_x * vel_x + vel_y * vel_y);
-    if (vel_mag <= 0.0) {
-        return 0.0;  // if we're not moving, no repulsion
-    }
-
-    double inv_d   = 1.0 / distance;
-    double inv_rho = 1.0 / area_of_effect;
-
-    double base = (inv_d - inv_rho) * inv_d * inv_d;  // (1/d - 1/rho)/d^2
-    if (base <= 0.0) {
-        return 0.0;
-    }
-
-    return function_scale * base * vel_mag;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
 }
 
 /*
- * Wall repulsion:
- * - radius:   params->rho
- * - strength: params->eta
- *
- * Same sign logic as the old project:
- *  - LEFT wall:  +Fx
- *  - RIGHT wall: -Fx
- *  - BOTTOM:     +Fy
- *  - TOP:        -Fy
- * Magnitude from repulsive_force(), using full |v|.
+ * Target update from targets.c, which owns the set:
+ * - SIM_MSG_TARGETS (first message of every targets instance): the whole
+ *   set, replaces ours; its epoch goes to *epoch for the hit reports
+ * - SIM_MSG_TARGET_CHANGES: only the listed slots are replaced
+ * Replaced slots are re-indexed and start their trajectory at the frame's
+ * time. Returns 0, or -1 for a bad frame.
  */
-static void compute_wall_repulsion(const WorldState *world,
-                                   const SimParams   *params,
-                                   double            *out_fx,
-                                   double            *out_fy)
+static int apply_targets(WorldState     *world,
+                         const SimMsg   *msg,
+                         int             slots,
+                         SimTargetIndex *tindex,
+                         SimKinematics  *kin,
+                         uint32_t       *epoch)
 {
-    double fx = 0.0;
-    double fy = 0.0;
-
-    double rho = params->rho;  // radius of influence
-    double eta = params->eta;  // strength
-
-    if (rho <= 0.0 || eta <= 0.0) {
-        *out_fx = 0.0;
-        *out_fy = 0.0;
-        return;
-    }
-
-    double x  = world->drone.x;
-    double y  = world->drone.y;
-    double vx = world->drone.vx;
-    double vy = world->drone.vy;
-
-    double w = (double)params->world_width;
-    double h = (double)params->world_height;
+    double t0 = sim_proto_time_s(msg);
 
-    // LEFT wall (x = 0): distance = x, push +x
-    if (x < rho) {
-        double d = x;
-        double f = repulsive_force(d, eta, rho, vx, vy);
-        fx += f;
+    if (msg->h.type == SIM_MSG_TARGETS) {
+        int count = sim_proto_get_targets(msg, world->targets, slots, epoch);
+        if (count < 0) {
+            return -1;
+        }
+        for (int i = 0; i < slots; ++i) {
+            sim_physics_tindex_set(tindex, world->targets, i);
+            sim_physics_kin_set_target(kin, world->targets, i, t0);
+        }
+        world->num_targets = count;
+        return 0;
     }
 
-    // RIGHT wall (x = w): distance = w - x, push -x
-    if (x > w - rho) {
-        double d = w - x;
-        double f = repulsive_force(d, eta, rho, vx, vy);
-        fx -= f;
-    }
+    static Target incoming[SIM_MAX_TARGETS];
+    int           changed[SIM_MAX_TARGETS];
 
-    // BOTTOM wall (y = 0): distance = y, push +y
-    if (y < rho) {
-        double d = y;
-        double f = repulsive_force(d, eta, rho, vx, vy);
-        fy += f;
+    int n = sim_proto_get_target_changes(msg, incoming, slots, changed);
+    if (n < 0) {
+        return -1;
     }
+    for (int k = 0; k < n; ++k) {
+        int     i   = changed[k];
+        Target *tgt = &world->targets[i];
 
-    // TOP wall (y = h): distance = h - y, push -y
-    if (y > h - rho) {
-        double d = h - y;
-        double f = repulsive_force(d, eta, rho, vx, vy);
-        fy -= f;
+        world->num_targets += incoming[i].active - tgt->active;
+        *tgt = incoming[i];
+        sim_physics_tindex_set(tindex, world->targets, i);
+        sim_physics_kin_set_target(kin, world->targets, i, t0);
     }
-
-    *out_fx = fx;
-    *out_fy = fy;
+    return 0;
 }
 
 /*
- * Obstacle repulsion:
- * - same Latombe law, but vector points away from obstacle.
- * - uses a slightly BIGGER radius than walls: rho_obs = 1.5 * rho
+ * Moving obstacles / targets to time t: only their trajectories come over
+ * the pipes, positions are extrapolated here (one batch per kind; they
+ * keep moving after their generator is gone), and the targets that moved
+ * are re-indexed
  */
-static void compute_obstacle_repulsion(const WorldState *world,
-                                       const SimParams   *params,
-                                       double            *out_fx,
-                                       double            *out_fy)
+static void advance_world(WorldState     *world,
+                          SimKinematics  *obs_kin,
+                          SimKinematics  *tgt_kin,
+                          SimTargetIndex *tindex,
+                          double          t)
 {
-    double fx = 0.0;
-    double fy = 0.0;
-
-    double rho     = params->rho;
-    double eta     = params->eta;
-    double rho_obs = rho * 1.5;   // obstacle radius (bigger than walls)
-
-    if (rho_obs <= 0.0 || eta <= 0.0) {
-        *out_fx = 0.0;
-        *out_fy = 0.0;
-        return;
+    if (obs_kin->moving > 0) {
+        sim_physics_kin_advance(obs_kin, t);
+        sim_physics_kin_get_obstacles(obs_kin, world->obstacles, obs_kin->count);
     }
-
-    double x  = world->drone.x;
-    double y  = world->drone.y;
-    double vx = world->drone.vx;
-    double vy = world->drone.vy;
-
-    for (int i = 0; i < world->num_obstacles; ++i) {
-        const Obstacle *obs = &world->obstacles[i];
-        if (!obs->active) {
-            continue;
-        }
-
-        double dx = obs->x - x;
-        double dy = obs->y - y;
-        double dist = sqrt(dx * dx + dy * dy);
-        if (dist <= 0.0 || dist > rho_obs) {
-            continue; // too far or invalid
-        }
-
-        double f_mag = repulsive_force(dist, eta, rho_obs, vx, vy);
-        if (f_mag <= 0.0) {
-            continue;
-        }
-
-        // Direction: AWAY from obstacle (from obstacle to drone).
-        double nx = x - obs->x;
-        double ny = y - obs->y;
-        double nlen = sqrt(nx * nx + ny * ny);
-        if (nlen <= 0.0) {
-            continue;
+    if (tgt_kin->moving > 0) {
+        sim_physics_kin_advance(tgt_kin, t);
+        sim_physics_kin_get_targets(tgt_kin, world->targets, tgt_kin->count);
+        for (int i = 0; i < tgt_kin->count; ++i) {
+            if (tgt_kin->vx[i] != 0.0 || tgt_kin->vy[i] != 0.0) {
+                sim_physics_tindex_set(tindex, world->targets, i);
+            }
         }
-
-        nx /= nlen;
-        ny /= nlen;
-
-        fx += f_mag * nx;
-        fy += f_mag * ny;
-    }
-
-    *out_fx = fx;
-    *out_fy = fy;
-}
-
-/*
- * Helper: does the segment [x0,y0] -> [x1,y1] intersect
- * the circle centered at (cx,cy) with radius r ?
- *
- * Returns 1 if yes, 0 otherwise.
- */
-static int segment_hits_circle(double x0, double y0,
-                               double x1, double y1,
-                               double cx, double cy,
-                               double r)
-{
-    double r2 = r * r;
-
-    // Endpoint inside circle?
-    double dx0 = x0 - cx;
-    double dy0 = y0 - cy;
-    double dx1 = x1 - cx;
-    double dy1 = y1 - cy;
-
-    double dist0_sq = dx0 * dx0 + dy0 * dy0;
-    double dist1_sq = dx1 * dx1 + dy1 * dy1;
-
-    if (dist0_sq <= r2 || dist1_sq <= r2) {
-        return 1;
-    }
-
-    // Degenerate segment
-    double sx = x1 - x0;
-    double sy = y1 - y0;
-    double len2 = sx * sx + sy * sy;
-    if (len2 <= 1e-9) {
-        return 0;
     }
-
-    // Projection of circle center onto segment
-    double t = ((cx - x0) * sx + (cy - y0) * sy) / len2;
-    if (t < 0.0) t = 0.0;
-    else if (t > 1.0) t = 1.0;
-
-    double closest_x = x0 + t * sx;
-    double closest_y = y0 + t * sy;
-
-    double dcx = closest_x - cx;
-    double dcy = closest_y - cy;
-    double dist_closest_sq = dcx * dcx + dcy * dcy;
-
-    return dist_closest_sq <= r2;
 }
 
 /*
  * Target handling:
- * - use segment [prev_pos -> current_pos] vs circle intersection
- * - when hit: increase world->score, respawn target at random position
+ * - use segment [prev_pos -> current_pos] vs circle intersection, only
+ *   against targets near the segment (target index)
+ * - when hit: increase world->score, take the target out and report its
+ *   id to targets.c (hits[]), which sends the replacement
  * - ignore frames where the drone basically didn't move (to avoid weird
  *   initial hits / score jumps).
+ * Returns the number of ids added to hits[].
  */
-static void handle_targets(WorldState *world,
-                           const SimParams *params,
-                           double prev_x,
-                           double prev_y)
+static int handle_targets(WorldState *world,
+                          SimTargetIndex *tindex,
+                          double prev_x,
+                          double prev_y,
+                          int *hits_out)
 {
+    SIM_PROF_ZONE("handle_targets");
+
     if (world->num_targets <= 0) {
-        return;
+        return 0;
     }
 
     double x1 = world->drone.x;
@@ -295,48 +169,39 @@ static void handle_targets(WorldState *world,
     double move_dy = y1 - prev_y;
     double move_sq = move_dx * move_dx + move_dy * move_dy;
     if (move_sq < 1e-6) {
-        return;
+        return 0;
     }
 
-    // Hit radius in world coordinates (tweakable).
-    const double HIT_RADIUS = 1.0;
+    int hit_idx[SIM_MAX_TARGETS];
+    int hits = sim_physics_tindex_hit(tindex, world->targets,
+                                      prev_x, prev_y, x1, y1,
+                                      SIM_PHYS_HIT_RADIUS,
+                                      hit_idx, SIM_MAX_TARGETS);
 
-    for (int i = 0; i < world->num_targets; ++i) {
+    for (int k = 0; k < hits; ++k) {
+        int     i   = hit_idx[k];
         Target *tgt = &world->targets[i];
-        if (!tgt->active) {
-            continue;
-        }
 
-        double cx = tgt->x;
-        double cy = tgt->y;
+        play("../../bin/conf/target.mp3");
+        world->score += 1.0;
+        sim_metrics_add(SIM_ROLE_BB_SERVER, SIM_METRIC_TARGET_HITS, 1);
 
-        int hit = segment_hits_circle(prev_x, prev_y, x1, y1, cx, cy, HIT_RADIUS);
+        sim_log_info("bb_server: TARGET HIT idx=%d id=%d pos=(%.2f,%.2f) score=%.1f",
+                     i, tgt->id, tgt->x, tgt->y, world->score);
 
-        if (hit) {
-            play("../../bin/conf/target.mp3");
-            world->score += 1.0;
-
-            sim_log_info("bb_server: TARGET HIT idx=%d pos=(%.2f,%.2f) score=%.1f",
-                         i, tgt->x, tgt->y, world->score);
-
-            // Respawn this target at a random location in the world
-            double w = (double)params->world_width;
-            double h = (double)params->world_height;
-
-            tgt->x = ((double)rand() / (double)RAND_MAX) * w;
-            tgt->y = ((double)rand() / (double)RAND_MAX) * h;
-            tgt->active = 1;
-
-            sim_log_info("bb_server: TARGET RESPAWN idx=%d new_pos=(%.2f,%.2f)",
-                         i, tgt->x, tgt->y);
-        }
+        // Gone until targets.c sends the slot's replacement
+        hits_out[k]  = tgt->id;
+        tgt->active  = 0;
+        world->num_targets--;
+        sim_physics_tindex_set(tindex, world->targets, i);
     }
+    return hits;
 }
 
-int main(int argc, char *argv[])
+SIM_ROLE_MAIN(bb_server)
 {
     sim_log_init("bb_server");
-    signal(SIGINT, handle_sigint);
+    SIM_ROLE_SIGNAL(SIGINT, handle_sigint);
 
     // we add the music
     pid_t music = fork();
@@ -378,6 +243,15 @@ int main(int argc, char *argv[])
                  params->damping,
                  params->dt);
 
+    // CPU set / SCHED_FIFO / mlockall from [realtime]
+    sim_rt_apply(SIM_ROLE_BB_SERVER, "bb_server");
+    SIM_PROF_THREAD("bb_server");
+
+    // Drone states should arrive once per drone dt
+    SimJitter state_jitter;
+    sim_jitter_init(&state_jitter, "bb_server: drone state", params->dt,
+                    params->jitter_report_interval);
+
     // Log repulsion parameters as well
     sim_log_info("bb_server: repulsion params rho=%.2f eta=%.2f",
                  params->rho, params->eta);
@@ -386,16 +260,40 @@ int main(int argc, char *argv[])
     sim_log_info("bb_server: repulsion %s (Latombe-style |v|)",
                  env_enabled ? "ENABLED" : "DISABLED");
 
-    // Seed RNG for target respawn
-    srand((unsigned)time(NULL));
+    // Wall law tabulated once for this run's rho / eta (wall_lut_size 0 = exact)
+    static SimWallLut wall_lut;
+    sim_physics_wall_lut_build(&wall_lut, params);
+    sim_log_info("bb_server: wall lookup table %d samples", wall_lut.size);
+
+    // Obstacle field cached on a grid, updated only when an obstacle is
+    // added / replaced (obstacle_field_cell 0 = exact law every frame;
+    // moving obstacles would change it every frame: exact law too)
+    static SimObstacleField obs_field;
+    size_t  field_nodes = (params->obstacle_speed > 0.0) ? 0 : sim_physics_field_nodes(params);
+    double *field_buf   = NULL;
+    if (field_nodes > 0) {
+        field_buf = malloc(2 * field_nodes * sizeof(double));
+    }
+    if (field_buf == NULL ||
+        sim_physics_field_init(&obs_field, params, field_buf,
+                               field_buf + field_nodes, field_nodes) != 0) {
+        obs_field.cell = 0.0;
+    }
+    sim_log_info("bb_server: obstacle field %s (%zu nodes)",
+                 obs_field.cell > 0.0 ? "cached" : "exact", field_nodes);
+
+    // Targets by cell and by id (world size is restart-only)
+    static SimTargetIndex tindex;
+    sim_physics_tindex_init(&tindex, params, SIM_PHYS_HIT_RADIUS);
 
     // FDs for anonymous pipes are now passed via argv by master:
     //   ./bb_server <fd_drone_state_in> <fd_drone_cmd_out> <fd_input_cmd_in>
-    //               <fd_obstacles_in> <fd_targets_in>
-    if (argc < 6) {
+    //               <fd_obstacles_in> <fd_targets_in> <fd_target_hits_out>
+    if (argc < 7) {
         fprintf(stderr,
                 "bb_server: usage: %s <fd_drone_state_in> <fd_drone_cmd_out> "
-                "<fd_input_cmd_in> <fd_obstacles_in> <fd_targets_in>\n",
+                "<fd_input_cmd_in> <fd_obstacles_in> <fd_targets_in> "
+                "<fd_target_hits_out>\n",
                 argv[0]);
         return EXIT_FAILURE;
     }
@@ -405,10 +303,12 @@ int main(int argc, char *argv[])
     int fd_input_in  = atoi(argv[SIM_ARG_BB_INPUT_CMD_IN]);
     int fd_obs_in    = atoi(argv[SIM_ARG_BB_OBS_IN]);
     int fd_tgt_in    = atoi(argv[SIM_ARG_BB_TGT_IN]);
+    int fd_hits_out  = atoi(argv[SIM_ARG_BB_TGT_HITS_OUT]);
 
     sim_log_info("bb_server: pipe FDs: drone_in=%d drone_out=%d "
-                 "input_in=%d obs_in=%d tgt_in=%d",
-                 fd_drone_in, fd_drone_out, fd_input_in, fd_obs_in, fd_tgt_in);
+                 "input_in=%d obs_in=%d tgt_in=%d hits_out=%d",
+                 fd_drone_in, fd_drone_out, fd_input_in, fd_obs_in, fd_tgt_in,
+                 fd_hits_out);
 
     WorldState   world;
     CommandState user_cmd;   // pure user command (raw input)
@@ -432,6 +332,8 @@ int main(int argc, char *argv[])
     for (int i = 0; i < SIM_MAX_OBSTACLES; ++i) {
         world.obstacles[i].x      = 0.0;
         world.obstacles[i].y      = 0.0;
+        world.obstacles[i].vx     = 0.0;
+        world.obstacles[i].vy     = 0.0;
         world.obstacles[i].radius = 0.0;
         world.obstacles[i].active = 0;
     }
@@ -440,6 +342,8 @@ int main(int argc, char *argv[])
     for (int i = 0; i < SIM_MAX_TARGETS; ++i) {
         world.targets[i].x      = 0.0;
         world.targets[i].y      = 0.0;
+        world.targets[i].vx     = 0.0;
+        world.targets[i].vy     = 0.0;
         world.targets[i].radius = 0.0;
         world.targets[i].id     = 0;
         world.targets[i].active = 0;
@@ -453,17 +357,23 @@ int main(int argc, char *argv[])
     double prev_x           = 0.0;
     double prev_y           = 0.0;
     int    have_prev_pos    = 0;
-    int    have_drone_state = 0;
     int    have_targets     = 0;
+    uint32_t tgt_epoch      = 0;   // epoch of the last full target set
+    int    drone_seq        = -1;  // seq of the last drone state
+    int    hits_open        = 1;
 
-    // For repulsion logic
-    int input_received   = 0;
+    // For repulsion logging
     int wall_active_prev = 0;
 
     // Init UI and show menu
     ui_init();
 
     int start_sim = 0;
+#ifdef SIM_SINGLE_PROCESS
+    // The input thread owns the keyboard in this build; a menu here would
+    // race it for stdin, so start the simulation right away
+    start_sim = 1;
+#endif
     while (!start_sim && running) { // Handling choices of menu
         int choice = ui_show_start_menu();
         sim_log_info("bb_server: menu choice=%d (0=Start,1=Instr,2=Quit)", choice);
@@ -482,11 +392,13 @@ int main(int argc, char *argv[])
 
     if (!running || !start_sim) {
         ui_shutdown();
-        close(fd_drone_in);
-        close(fd_drone_out);
-        close(fd_input_in);
-        close(fd_obs_in);
-        close(fd_tgt_in);
+        sim_ipc_close(fd_drone_in);
+        sim_ipc_close(fd_drone_out);
+        sim_ipc_close(fd_input_in);
+        sim_ipc_close(fd_obs_in);
+        sim_ipc_close(fd_tgt_in);
+        sim_ipc_close(fd_hits_out);
+        free(field_buf);
         sim_log_info("bb_server: exiting from menu");
         return 0;
     }
@@ -512,24 +424,134 @@ int main(int argc, char *argv[])
         tgt_to_read = 0;
     }
 
+    // Obstacle / target trajectories, advanced at the start of every pass
+    static SimKinematics obs_kin, tgt_kin;
+    sim_physics_kin_init(&obs_kin, params, obs_to_read);
+    sim_physics_kin_init(&tgt_kin, params, tgt_to_read);
+
+    SimPeriodic frame;
+    sim_periodic_init(&frame, BB_FRAME_PERIOD_S);
+
+    // Framed protocol state per pipe (sim_proto.h)
+    static SimMsg       msg;
+    static SimMsgWriter to_drone, to_targets;
+    static SimIpcRx     rx_drone, rx_input, rx_obs, rx_tgt;
+    static SimIpcTx     tx_drone, tx_targets;
+    SimMsgReader        rd_drone, rd_input, rd_obs, rd_tgt;
+    unsigned long       bad_frames = 0;
+    sim_proto_writer_init(&to_drone);
+    sim_proto_writer_init(&to_targets);
+    sim_ipc_tx_init(&tx_drone);
+    sim_ipc_tx_init(&tx_targets);
+
+    // No read or write may block the frame: a producer that sent half a
+    // frame leaves it in its rx buffer, a drone that stopped reading
+    // fills tx_drone (bounded, see the policies below)
+    sim_ipc_set_nonblock(fd_drone_in);
+    sim_ipc_set_nonblock(fd_input_in);
+    sim_ipc_set_nonblock(fd_obs_in);
+    sim_ipc_set_nonblock(fd_tgt_in);
+    sim_ipc_set_nonblock(fd_drone_out);
+    sim_ipc_set_nonblock(fd_hits_out);
+    sim_proto_reader_init(&rd_drone);
+    sim_proto_reader_init(&rd_input);
+    sim_proto_reader_init(&rd_obs);
+    sim_proto_reader_init(&rd_tgt);
+
+    // Observers attached at runtime get one snapshot record per frame
+    // (drone state + obstacle set + target set), see sim_ipc.h
+    const int           obs_slots = obs_to_read;
+    const int           tgt_slots = tgt_to_read;
+    static SimMsgWriter snapshot;
+    SimIpcFanout        observers;
+    sim_proto_writer_init(&snapshot);
+    if (sim_ipc_fanout_open(&observers, params->observer_socket,
+                            params->max_observers) != 0) {
+        sim_log_info("bb_server: observer socket '%s': %s (observers disabled)",
+                     params->observer_socket, strerror(errno));
+    } else if (observers.listen_fd >= 0) {
+        sim_log_info("bb_server: observers can attach to %s (max %d)",
+                     observers.path, observers.max);
+    }
+
+    // Local subscribers read every tick's WorldState from shared memory
+    SimSnapshotHandle snapshots;
+    if (params->snapshot_slots <= 0) {
+        snapshots.ring = NULL;
+    } else if (sim_snapshot_create(&snapshots, params->snapshot_slots) != 0) {
+        sim_log_info("bb_server: snapshot ring %s: %s (disabled)",
+                     SIM_SNAPSHOT_SHM, strerror(errno));
+    } else {
+        sim_log_info("bb_server: publishing snapshots in %s (%d slots)",
+                     SIM_SNAPSHOT_SHM, params->snapshot_slots);
+    }
+
+    // Live counters (sim_metrics.h); 'm' in the input window toggles the
+    // panel, which shows rates over the last second
+    SimMetricsTimer  tick_timer;
+    SimMetricsSample metrics_prev, metrics_cur;
+    SimMetricsRates  metrics_rates;
+    int              show_metrics  = 0;
+    int              have_rates    = 0;
+    unsigned long    obs_coalesced = 0;
+    sim_metrics_timer_init(&tick_timer, SIM_ROLE_BB_SERVER);
+    if (sim_metrics_sample(&metrics_prev) != 0) {
+        sim_log_info("bb_server: no metrics block, the metrics panel stays empty");
+    }
+
+    // Dashboards scrape the counters from a file, rewritten off the loop
+    SimMetricsExporter exporter;
+    if (params->metrics_file[0] == '\0') {
+        exporter.started = 0;
+    } else if (sim_metrics_exporter_start(&exporter, params->metrics_file,
+                                          params->metrics_interval) != 0) {
+        sim_log_info("bb_server: metrics export to '%s': %s (disabled)",
+                     params->metrics_file, strerror(errno));
+    } else {
+        sim_log_info("bb_server: exporting metrics to %s every %.1f s",
+                     exporter.path, exporter.interval);
+    }
+
     // Main display + IPC loop (pipe-based, no shared memory)
     while (running) {
+        // Tell master (supervisor) we are alive
+        sim_heartbeat_beat(SIM_ROLE_BB_SERVER);
+
+        // Pick up a config edit published by master (frame boundary)
+        if (sim_params_refresh()) {
+            env_enabled = (params->rho > 0.0 && params->eta > 0.0);
+            sim_physics_wall_lut_build(&wall_lut, params);
+            if (obs_field.cell > 0.0) {
+                sim_physics_field_init(&obs_field, params, obs_field.gx,
+                                       obs_field.gy, obs_field.capacity);
+                sim_physics_field_update(&obs_field, world.obstacles, obs_to_read);
+            }
+            sim_jitter_init(&state_jitter, "bb_server: drone state", params->dt,
+                            params->jitter_report_interval);
+            sim_log_info("bb_server: params generation %lu, repulsion %s",
+                         sim_params_generation(), env_enabled ? "ENABLED" : "DISABLED");
+        }
+
         fd_set readfds;
         FD_ZERO(&readfds);
 
         FD_SET(fd_drone_in, &readfds);
         FD_SET(fd_input_in, &readfds);
-        FD_SET(fd_obs_in,   &readfds);
-        FD_SET(fd_tgt_in,   &readfds);
+        // A producer that hit EOF stays readable forever: leave it out
+        if (obs_to_read > 0) FD_SET(fd_obs_in, &readfds);
+        if (tgt_to_read > 0) FD_SET(fd_tgt_in, &readfds);
 
         int maxfd = fd_drone_in;
         if (fd_input_in > maxfd)  maxfd = fd_input_in;
         if (fd_obs_in   > maxfd)  maxfd = fd_obs_in;
         if (fd_tgt_in   > maxfd)  maxfd = fd_tgt_in;
+        sim_ipc_fanout_fdset(&observers, &readfds, &maxfd);
 
+        // Wait for messages until the next frame is due
+        double left = sim_periodic_remaining(&frame);
         struct timeval tv;
         tv.tv_sec  = 0;
-        tv.tv_usec = 33333; // Approx 30 Hz
+        tv.tv_usec = (suseconds_t)(left * 1e6);
 
         int ready = select(maxfd + 1, &readfds, NULL, NULL, &tv);
         if (ready < 0) {
@@ -541,15 +563,50 @@ int main(int argc, char *argv[])
             break;
         }
 
-        input_received = 0;
+        sim_metrics_tick_begin(&tick_timer);
+        SIM_PROF_ZONE("bb_server_pass");
+
+        if (obs_kin.moving > 0 || tgt_kin.moving > 0) {
+            SIM_PROF_ZONE("kinematics");
+            advance_world(&world, &obs_kin, &tgt_kin, &tindex, now_s());
+        }
 
         if (ready > 0) {
-            // Data from drone (updated DroneState)
+            SIM_PROF_ZONE("bb_server_rx");
+
+            // New observers / observers that left
+            sim_ipc_fanout_poll(&observers, &readfds);
+
+            // Each readable pipe: one read, then every whole frame it
+            // brought in; a partial frame waits in its rx buffer.
+
+            // Data from drone (updated drone states)
             if (FD_ISSET(fd_drone_in, &readfds)) {
+                ssize_t    r = sim_ipc_rx_fill(fd_drone_in, &rx_drone);
                 DroneState ds;
-                ssize_t r = read_full(fd_drone_in, &ds, sizeof(ds));
 
-                if (r == (ssize_t)sizeof(ds)) {
+                if (r > 0) {
+                    sim_metrics_chan_bytes(SIM_METRIC_CHAN_DRONE_STATE, (uint64_t)r);
+                }
+                while (r > 0 && sim_proto_next(&rx_drone, &rd_drone, &msg)) {
+                    if (sim_proto_get_drone_state(&msg, &ds) != 0) {
+                        bad_frames++;
+                        continue;
+                    }
+                    sim_jitter_tick(&state_jitter);
+                    if (msg.h.seq == 0 && drone_seq >= 0 &&
+                        drone_seq != UINT16_MAX) {
+                        // Sequence restarted (not wrapped): master
+                        // restarted the drone. It starts over at the
+                        // centre, so no segment from the old position,
+                        // and it needs the obstacle set now, not at the
+                        // next change
+                        sim_log_info("bb_server: new drone instance");
+                        have_prev_pos = 0;
+                        sim_proto_put_obstacles(&to_drone, world.obstacles, obs_slots);
+                        sim_proto_queue(&tx_drone, &to_drone, SIM_IPC_TX_OVERWRITE);
+                    }
+                    drone_seq = msg.h.seq;
                     if (!have_prev_pos) {
                         // First real state: no motion yet
                         prev_x = ds.x;
@@ -561,159 +618,275 @@ int main(int argc, char *argv[])
                         prev_y = world.drone.y;
                     }
 
-                    world.drone      = ds;
-                    have_drone_state = 1;
-                } else if (r == 0) {
+                    world.drone = ds;
+                    sim_metrics_chan_add(SIM_METRIC_CHAN_DRONE_STATE, 1);
+
+                    // Every tick: hit tests on its own segment (collision
+                    // detection, scoring, hit report), then one snapshot
+                    if (have_targets) {
+                        int hit_ids[SIM_MAX_TARGETS];
+                        int hits = handle_targets(&world, &tindex, prev_x, prev_y,
+                                                  hit_ids);
+                        if (hits > 0) {
+                            sim_proto_put_target_hits(&to_targets, tgt_epoch,
+                                                      hit_ids, hits);
+                            sim_proto_queue(&tx_targets, &to_targets,
+                                            SIM_IPC_TX_DROP_NEWEST);
+                        }
+                    }
+                    if (snapshots.ring != NULL) {
+                        sim_snapshot_publish(&snapshots, &world);
+                        sim_metrics_chan_add(SIM_METRIC_CHAN_SNAPSHOTS, 1);
+                        sim_metrics_chan_bytes(SIM_METRIC_CHAN_SNAPSHOTS, sizeof(SimSnapshot));
+                    }
+                }
+                if (r == 0) {
                     // EOF: drone closed its pipe
                     sim_log_info("bb_server: drone pipe EOF");
                     running = 0;
-                } else if (r < 0) {
+                } else if (r < 0 && errno != EAGAIN) {
                     endwin();
-                    perror("bb_server: read_full(drone)");
+                    perror("bb_server: sim_ipc_rx_fill(drone)");
                     running = 0;
                 }
             }
 
-            // Data from input (updated CommandState)
+            // Data from input (updated commands)
             if (FD_ISSET(fd_input_in, &readfds)) {
+                ssize_t      r = sim_ipc_rx_fill(fd_input_in, &rx_input);
                 CommandState cs;
-                ssize_t r = read_full(fd_input_in, &cs, sizeof(cs));
-
-                if (r == (ssize_t)sizeof(cs)) {
-                    user_cmd       = cs;
-                    input_received = 1;
-
-                    if (!env_enabled) {
-                        // Legacy mode: just forward user command
-                        world.cmd = cs;
-
-                        // Forward latest command to drone so it can update physics
-                        ssize_t w = write_full(fd_drone_out, &cs, sizeof(cs));
-                        if (w != (ssize_t)sizeof(cs)) {
-                            endwin();
-                            perror("bb_server: write_full(drone)");
-                            running = 0;
-                        }
+
+                if (r > 0) {
+                    sim_metrics_chan_bytes(SIM_METRIC_CHAN_INPUT_CMD, (uint64_t)r);
+                }
+                while (r > 0 && sim_proto_next(&rx_input, &rd_input, &msg)) {
+                    if (sim_proto_get_command(&msg, &cs) != 0) {
+                        bad_frames++;
+                        continue;
                     }
-                } else if (r == 0) {
+                    user_cmd  = cs;
+                    world.cmd = cs;
+                    sim_metrics_chan_add(SIM_METRIC_CHAN_INPUT_CMD, 1);
+
+                    if (cs.last_key == 'm') {
+                        show_metrics = !show_metrics;
+                    }
+
+                    // Forward every raw user command (reset is an edge the
+                    // drone must see); the drone adds wall + obstacle
+                    // repulsion itself at every sub-step. If the drone
+                    // stops reading, the oldest commands go first.
+                    sim_proto_put_command(&to_drone, &cs);
+                    sim_proto_queue(&tx_drone, &to_drone, SIM_IPC_TX_DROP_OLDEST);
+                }
+                if (r == 0) {
                     sim_log_info("bb_server: input pipe EOF");
                     running = 0;
-                } else if (r < 0) {
+                } else if (r < 0 && errno != EAGAIN) {
                     endwin();
-                    perror("bb_server: read_full(input)");
+                    perror("bb_server: sim_ipc_rx_fill(input)");
                     running = 0;
                 }
             }
 
-            // Data from obstacles (Obstacle array)
-            if (FD_ISSET(fd_obs_in, &readfds) && obs_to_read > 0) {
-                ssize_t expected = (ssize_t)(obs_to_read * (int)sizeof(Obstacle));
-                ssize_t r = read_full(fd_obs_in, world.obstacles,
-                                      (size_t)(obs_to_read * (int)sizeof(Obstacle)));
-
-                if (r == expected) {
-                    int count = 0;
-                    for (int i = 0; i < obs_to_read; ++i) {
-                        if (world.obstacles[i].active) {
-                            ++count;
-                        }
+            // Data from obstacles (active slots of the obstacle array);
+            // several sets in one read: only the newest matters
+            if (obs_to_read > 0 && FD_ISSET(fd_obs_in, &readfds)) {
+                ssize_t r       = sim_ipc_rx_fill(fd_obs_in, &rx_obs);
+                int     changed = 0;
+                int     sets    = 0;
+                double  obs_t0  = 0.0;
+
+                if (r > 0) {
+                    sim_metrics_chan_bytes(SIM_METRIC_CHAN_OBSTACLES, (uint64_t)r);
+                }
+                while (r > 0 && sim_proto_next(&rx_obs, &rd_obs, &msg)) {
+                    int count = sim_proto_get_obstacles(&msg, world.obstacles, obs_to_read);
+                    if (count < 0) {
+                        bad_frames++;
+                        continue;
                     }
                     world.num_obstacles = count;
-                } else if (r == 0) {
+                    obs_t0  = sim_proto_time_s(&msg);
+                    changed = 1;
+                    sets++;
+                }
+                sim_metrics_chan_add(SIM_METRIC_CHAN_OBSTACLES, (uint64_t)sets);
+
+                if (changed) {
+                    obs_coalesced += (unsigned long)(sets - 1);
+
+                    // New trajectories; the drone gets them as of now
+                    sim_physics_kin_set_obstacles(&obs_kin, world.obstacles,
+                                                  obs_to_read, obs_t0);
+                    if (obs_kin.moving > 0) {
+                        sim_physics_kin_advance(&obs_kin, now_s());
+                        sim_physics_kin_get_obstacles(&obs_kin, world.obstacles,
+                                                      obs_to_read);
+                    }
+
+                    // Only the replaced / added slots are re-rasterized
+                    sim_physics_field_update(&obs_field, world.obstacles, obs_to_read);
+
+                    // Forward the same snapshot so the drone can sweep
+                    // its motion against the obstacles (no tunneling);
+                    // an older set still waiting in the queue is replaced
+                    sim_proto_put_obstacles(&to_drone, world.obstacles, obs_to_read);
+                    sim_proto_queue(&tx_drone, &to_drone, SIM_IPC_TX_OVERWRITE);
+                }
+                if (r == 0) {
                     sim_log_info("bb_server: obstacles pipe EOF");
                     // Keep last known obstacles, just don't expect more updates
                     obs_to_read = 0;
-                } else if (r < 0) {
+                } else if (r < 0 && errno != EAGAIN) {
                     endwin();
-                    perror("bb_server: read_full(obstacles)");
+                    perror("bb_server: sim_ipc_rx_fill(obstacles)");
                     running = 0;
                 }
             }
 
-            // Data from targets (Target array)
-            if (FD_ISSET(fd_tgt_in, &readfds) && tgt_to_read > 0) {
-                ssize_t expected = (ssize_t)(tgt_to_read * (int)sizeof(Target));
-                ssize_t r = read_full(fd_tgt_in, world.targets,
-                                      (size_t)(tgt_to_read * (int)sizeof(Target)));
-
-                if (r == expected) {
-                    int count = 0;
-                    for (int i = 0; i < tgt_to_read; ++i) {
-                        if (world.targets[i].active) {
-                            ++count;
-                        }
+            // Data from targets (active slots of the target array)
+            if (tgt_to_read > 0 && FD_ISSET(fd_tgt_in, &readfds)) {
+                ssize_t r = sim_ipc_rx_fill(fd_tgt_in, &rx_tgt);
+
+                if (r > 0) {
+                    sim_metrics_chan_bytes(SIM_METRIC_CHAN_TARGETS, (uint64_t)r);
+                }
+                while (r > 0 && sim_proto_next(&rx_tgt, &rd_tgt, &msg)) {
+                    if (apply_targets(&world, &msg, tgt_to_read, &tindex, &tgt_kin,
+                                      &tgt_epoch) != 0) {
+                        bad_frames++;
+                        continue;
+                    }
+                    if (msg.h.type == SIM_MSG_TARGETS) {
+                        // A full set comes from a new targets instance:
+                        // hits still queued carry the old epoch
+                        sim_ipc_tx_clear(&tx_targets);
                     }
-                    world.num_targets = count;
-                    have_targets      = 1;
-                } else if (r == 0) {
+                    have_targets = 1;
+                    sim_metrics_chan_add(SIM_METRIC_CHAN_TARGETS, 1);
+                }
+                if (r == 0) {
                     sim_log_info("bb_server: targets pipe EOF");
                     tgt_to_read = 0;
-                } else if (r < 0) {
+                } else if (r < 0 && errno != EAGAIN) {
                     endwin();
-                    perror("bb_server: read_full(targets)");
+                    perror("bb_server: sim_ipc_rx_fill(targets)");
                     running = 0;
                 }
             }
+
+        }
+
+        // Whatever the drone pipe takes now; the rest waits for a later
+        // pass (at most a frame away), bb_server never blocks on it
+        if (running && sim_ipc_tx_pending(&tx_drone) > 0 &&
+            sim_ipc_tx_flush(fd_drone_out, &tx_drone) < 0) {
+            endwin();
+            perror("bb_server: sim_ipc_tx_flush(drone)");
+            running = 0;
         }
 
-        // Handle targets: collision detection, scoring, respawn
-        if (have_prev_pos && have_drone_state && have_targets) {
-            handle_targets(&world, params, prev_x, prev_y);
+        // Hit reports: a full pipe (targets restarting) holds them in
+        // tx_targets, a closed one only ends the reports
+        if (running && hits_open && sim_ipc_tx_pending(&tx_targets) > 0 &&
+            sim_ipc_tx_flush(fd_hits_out, &tx_targets) < 0) {
+            if (errno == EPIPE) {
+                sim_log_info("bb_server: target hits pipe closed");
+                hits_open = 0;
+            } else {
+                endwin();
+                perror("bb_server: sim_ipc_tx_flush(targets)");
+                running = 0;
+            }
         }
 
-        // Apply wall + obstacle repulsion if environment enabled
+        // Evaluate wall + obstacle repulsion at the last reported drone state.
+        // The drone applies it itself (adaptive sub-steps); here it only
+        // feeds the HUD (total force) and the WALL ON/OFF log.
         if (running && env_enabled) {
+            SIM_PROF_ZONE("env_repulsion");
             double fx_wall = 0.0, fy_wall = 0.0;
             double fx_obs  = 0.0, fy_obs  = 0.0;
 
-            compute_wall_repulsion(&world, params, &fx_wall, &fy_wall);
-            compute_obstacle_repulsion(&world, params, &fx_obs, &fy_obs);
+            SimEnv env;
+            env.obstacles     = world.obstacles;
+            env.num_obstacles = world.num_obstacles;
+            env.grid          = NULL;
+            env.wall_lut      = &wall_lut;
+            env.field         = &obs_field;
+
+            sim_physics_env_repulsion(params, &env, &world.drone,
+                                      &fx_wall, &fy_wall, &fx_obs, &fy_obs);
+
+            // Superposition: user force + wall + obstacle repulsion
+            world.cmd.fx = user_cmd.fx + fx_wall + fx_obs;
+            world.cmd.fy = user_cmd.fy + fy_wall + fy_obs;
+
+            // Wall logging: only ON/OFF transitions (based on walls only)
+            int wall_active = (fx_wall != 0.0 || fy_wall != 0.0);
+            if (wall_active && !wall_active_prev) {
+                sim_metrics_add(SIM_ROLE_BB_SERVER, SIM_METRIC_REPULSION_ON, 1);
+                sim_log_info("bb_server: WALL ON  pos=(%.1f,%.1f) "
+                             "user=(%.2f,%.2f) wall=(%.2f,%.2f) "
+                             "obs=(%.2f,%.2f) total=(%.2f,%.2f)",
+                             world.drone.x, world.drone.y,
+                             user_cmd.fx, user_cmd.fy,
+                             fx_wall, fy_wall,
+                             fx_obs, fy_obs,
+                             world.cmd.fx, world.cmd.fy);
+            } else if (!wall_active && wall_active_prev) {
+                sim_log_info("bb_server: WALL OFF pos=(%.1f,%.1f)",
+                             world.drone.x, world.drone.y);
+            }
+            wall_active_prev = wall_active;
+        }
 
-            double fx_rep = fx_wall + fx_obs;
-            double fy_rep = fy_wall + fy_obs;
+        if (sim_periodic_poll(&frame) > 0) {
+            SIM_PROF_ZONE("frame");
 
-            // Only send command if:
-            // 1. We received new user input, OR
-            // 2. Repulsive forces are active (near walls or obstacles)
-            if (input_received || fx_rep != 0.0 || fy_rep != 0.0) {
-                CommandState out_cmd = user_cmd;
-                int          rep_active = (fx_rep != 0.0 || fy_rep != 0.0);
+            // Once a second: turn the counters into rates for the panel
+            if (sim_metrics_sample(&metrics_cur) == 0 &&
+                metrics_cur.t_ns - metrics_prev.t_ns >= (uint64_t)(SIM_METRICS_WINDOW_S * 1e9)) {
+                sim_metrics_rates(&metrics_prev, &metrics_cur, &metrics_rates);
+                metrics_prev = metrics_cur;
+                have_rates   = 1;
+            }
 
-                if (rep_active) {
-                    // Superposition: user force + wall + obstacle repulsion
-                    out_cmd.fx = user_cmd.fx + fx_rep;
-                    out_cmd.fy = user_cmd.fy + fy_rep;
-                }
+            {
+                SIM_PROF_ZONE("ui_draw");
+                ui_draw(&world);
+            }
+            if (show_metrics && have_rates) {
+                ui_draw_metrics(&metrics_rates);
+            }
 
-                ssize_t w = write_full(fd_drone_out, &out_cmd, sizeof(out_cmd));
-                if (w != (ssize_t)sizeof(out_cmd)) {
-                    endwin();
-                    perror("bb_server: write_full(drone with repulsion)");
-                    running = 0;
-                }
+            int attached = sim_ipc_fanout_count(&observers);
+            if (attached > 0) {
+                sim_proto_put_drone_state(&snapshot, &world.drone);
+                sim_proto_put_obstacles(&snapshot, world.obstacles, obs_slots);
+                sim_proto_put_targets(&snapshot, world.targets, tgt_slots, tgt_epoch);
+                sim_ipc_fanout_send(&observers, snapshot.buf, snapshot.len);
+                sim_metrics_chan_add(SIM_METRIC_CHAN_OBSERVERS, (uint64_t)attached);
+                sim_metrics_chan_bytes(SIM_METRIC_CHAN_OBSERVERS,
+                                       (uint64_t)attached * snapshot.len);
+                snapshot.len = 0;
+            }
 
-                world.cmd = out_cmd;
-
-                // Wall logging: only ON/OFF transitions (based on walls only)
-                int wall_active = (fx_wall != 0.0 || fy_wall != 0.0);
-                if (wall_active && !wall_active_prev) {
-                    sim_log_info("bb_server: WALL ON  pos=(%.1f,%.1f) "
-                                 "user=(%.2f,%.2f) wall=(%.2f,%.2f) "
-                                 "obs=(%.2f,%.2f) total=(%.2f,%.2f)",
-                                 world.drone.x, world.drone.y,
-                                 user_cmd.fx, user_cmd.fy,
-                                 fx_wall, fy_wall,
-                                 fx_obs, fy_obs,
-                                 out_cmd.fx, out_cmd.fy);
-                } else if (!wall_active && wall_active_prev) {
-                    sim_log_info("bb_server: WALL OFF pos=(%.1f,%.1f)",
-                                 world.drone.x, world.drone.y);
-                }
-                wall_active_prev = wall_active;
+            unsigned long observer_drops = 0;
+            for (int i = 0; i < observers.max; ++i) {
+                observer_drops += observers.dropped[i];
             }
+            sim_metrics_add(SIM_ROLE_BB_SERVER, SIM_METRIC_FRAMES, 1);
+            sim_metrics_set(SIM_ROLE_BB_SERVER, SIM_METRIC_DROPPED,
+                            tx_drone.dropped + observer_drops);
+            sim_metrics_set(SIM_ROLE_BB_SERVER, SIM_METRIC_COALESCED,
+                            tx_drone.overwritten + obs_coalesced);
+            sim_metrics_set(SIM_ROLE_BB_SERVER, SIM_METRIC_QUEUE_BYTES,
+                            sim_ipc_tx_pending(&tx_drone));
         }
 
-        ui_draw(&world);
+        sim_metrics_tick_end(&tick_timer);
 
         if (world.cmd.quit) {
             sim_log_info("bb_server: quit flag set, exiting");
@@ -723,13 +896,34 @@ int main(int argc, char *argv[])
 
     ui_shutdown();
 
-    close(fd_drone_in);
-    close(fd_drone_out);
-    close(fd_input_in);
-    close(fd_obs_in);
-    close(fd_tgt_in);
-
-    sim_log_info("bb_server: exited");
+    sim_ipc_close(fd_drone_in);
+    sim_ipc_close(fd_drone_out);
+    sim_ipc_close(fd_input_in);
+    sim_ipc_close(fd_obs_in);
+    sim_ipc_close(fd_tgt_in);
+    sim_ipc_close(fd_hits_out);
+    sim_ipc_fanout_close(&observers);
+    sim_snapshot_log_subscribers(&snapshots, "bb_server");
+    sim_snapshot_close(&snapshots);
+    sim_metrics_exporter_stop(&exporter);
+    SIM_PROF_FLUSH();
+    free(field_buf);
+
+    sim_log_info("bb_server: observers attached over the run: %lu", observers.attached);
+    if (params->metrics_file[0] != '\0') {
+        sim_log_info("bb_server: metrics exports written: %lu", exporter.written);
+    }
+    sim_log_info("bb_server: drone queue: dropped=%lu overwritten=%lu pending=%zu bytes",
+                 tx_drone.dropped, tx_drone.overwritten, sim_ipc_tx_pending(&tx_drone));
+    sim_log_info("bb_server: frames in: drone=%lu input=%lu obstacles=%lu targets=%lu, "
+                 "seq gaps=%lu, resync bytes=%lu, bad=%lu",
+                 rd_drone.frames, rd_input.frames, rd_obs.frames, rd_tgt.frames,
+                 rd_drone.gaps + rd_input.gaps + rd_obs.gaps + rd_tgt.gaps,
+                 rd_drone.resync_bytes + rd_input.resync_bytes +
+                 rd_obs.resync_bytes + rd_tgt.resync_bytes,
+                 bad_frames);
+    sim_log_info("bb_server: exited (frames=%lu, overruns=%lu)",
+                 frame.ticks, frame.overruns);
     sim_log_close();
     return EXIT_SUCCESS;
 }
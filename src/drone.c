@@ -6,13 +6,20 @@
 #include <sys/select.h>
 #include <errno.h>
 #include <fcntl.h>
-#include <math.h>        // fabs for motion deadzone
+#include <time.h>
 
 #include "sim_types.h"
 #include "sim_ipc.h"
 #include "sim_const.h"
 #include "sim_log.h"
+#include "sim_metrics.h"
+#include "sim_heartbeat.h"
 #include "sim_params.h"   // runtime parameters (mass, damping, dt, world size)
+#include "sim_physics.h"  // shared integrator
+#include "sim_prof.h"
+#include "sim_role.h"
+#include "sim_rt.h"
+#include "sim_proto.h"
 
 // Flag set by the SIGINT handler to request a clean shutdown
 static volatile sig_atomic_t running = 1;
@@ -24,42 +31,17 @@ static void handle_sigint(int sig)
     running = 0;
 }
 
-// Keep drone inside [0, world_width] × [0, world_height].
-// Also zero velocity components that point into the wall so we don't keep
-// bouncing or sliding along the boundary forever.
-static void apply_world_bounds(DroneState *d, double world_width, double world_height)
+static double now_s(void)
 {
-    if (d->x < 0.0) {
-        d->x = 0.0;
-        if (d->vx < 0.0) d->vx = 0.0;      // kill velocity into left wall
-    } else if (d->x > world_width) {
-        d->x = world_width;
-        if (d->vx > 0.0) d->vx = 0.0;      // kill velocity into right wall
-    }
-
-    if (d->y < 0.0) {
-        d->y = 0.0;
-        if (d->vy < 0.0) d->vy = 0.0;      // kill velocity into bottom wall
-    } else if (d->y > world_height) {
-        d->y = world_height;
-        if (d->vy > 0.0) d->vy = 0.0;      // kill velocity into top wall
-    }
-}
-
-// Zero out very small velocities so we don't get visual jitter from tiny
-// residual motion near equilibrium (especially near walls).
-static void apply_motion_deadzone(DroneState *d)
-{
-    const double V_EPS = 0.01;  // tweakable: "small enough" velocity
-
-    if (fabs(d->vx) < V_EPS) d->vx = 0.0;
-    if (fabs(d->vy) < V_EPS) d->vy = 0.0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
 }
 
-int main(int argc, char *argv[])
+SIM_ROLE_MAIN(drone)
 {
     sim_log_init("drone");
-    signal(SIGINT, handle_sigint);
+    SIM_ROLE_SIGNAL(SIGINT, handle_sigint);
 
     // Load runtime parameters in this process
     if (sim_params_load(NULL) != 0) {
@@ -71,25 +53,30 @@ int main(int argc, char *argv[])
 
     // FDs for anonymous pipes are passed via argv by master:
     //   ./drone <fd_cmd_in> <fd_state_out>
+    // fd_cmd_in carries both commands and obstacle sets from bb_server.
     if (argc < 3) {
-        fprintf(stderr, "drone: usage: %s <fd_cmd_in> <fd_state_out>\n", argv[0]);
+        fprintf(stderr, "drone: usage: %s <fd_cmd_in> <fd_state_out>\n",
+                argv[0]);
         return EXIT_FAILURE;
     }
 
     int fd_cmd_in    = atoi(argv[SIM_ARG_DRONE_CMD_IN]);
     int fd_state_out = atoi(argv[SIM_ARG_DRONE_STATE_OUT]);
 
-    // Use dt, mass, damping and world size from parameter file (or defaults)
-    const double dt           = params->dt;
+    // Use dt, mass, damping and world size from parameter file (or defaults).
+    // dt may change on a live reload, world size only on restart.
+    double       dt           = params->dt;
     const double mass         = params->mass;
     const double damping      = params->damping;
     const double world_width  = (double)params->world_width;
     const double world_height = (double)params->world_height;
 
-    unsigned int sleep_us = (unsigned int)(dt * 1e6);
+    sim_log_info("drone: started (dt=%.3f, M=%.3f, K=%.3f, max_substeps=%d)",
+                 dt, mass, damping, params->max_substeps);
 
-    sim_log_info("drone: started (dt=%.3f, M=%.3f, K=%.3f)\n",
-                 dt, mass, damping);
+    // CPU set / SCHED_FIFO / mlockall from [realtime]
+    sim_rt_apply(SIM_ROLE_DRONE, "drone");
+    SIM_PROF_THREAD("drone");
 
     DroneState   d;
     CommandState c;
@@ -107,15 +94,111 @@ int main(int argc, char *argv[])
     c.quit     = 0;
     c.last_key = 0;
 
+    // Obstacle snapshot forwarded by bb_server, used for swept collisions.
+    // Same size as the array obstacles.c sends (num_obstacles cap).
+    static Obstacle        obstacles[SIM_MAX_OBSTACLES];
+    static SimObstacleGrid obs_grid;
+    int  num_obstacles = 0;
+
+    // Wall law tabulated once for this run's rho / eta
+    static SimWallLut wall_lut;
+    sim_physics_wall_lut_build(&wall_lut, params);
+
+    // Obstacle field cached on a grid: every sub-step costs one bilinear
+    // lookup instead of a loop over all obstacles. Moving obstacles would
+    // re-rasterize it every tick: exact law (through the grid) instead.
+    static SimObstacleField obs_field;
+    size_t  field_nodes = (params->obstacle_speed > 0.0) ? 0 : sim_physics_field_nodes(params);
+    double *field_buf   = NULL;
+    if (field_nodes > 0) {
+        field_buf = malloc(2 * field_nodes * sizeof(double));
+    }
+    if (field_buf == NULL ||
+        sim_physics_field_init(&obs_field, params, field_buf,
+                               field_buf + field_nodes, field_nodes) != 0) {
+        obs_field.cell = 0.0;
+    }
+
+    SimEnv env;
+    env.obstacles     = obstacles;
+    env.num_obstacles = 0;
+    env.grid          = &obs_grid;
+    env.wall_lut      = &wall_lut;
+    env.field         = &obs_field;
+    long collisions    = 0;
+    int  last_contact  = -1;
+
+    // Sub-step accounting (average work per tick in the exit log)
+    long total_ticks    = 0;
+    long total_substeps = 0;
+
+    int obs_to_read = params->num_obstacles;
+    if (obs_to_read > SIM_MAX_OBSTACLES) {
+        obs_to_read = SIM_MAX_OBSTACLES;
+    } else if (obs_to_read < 0) {
+        obs_to_read = 0;
+    }
+
+    // Obstacle trajectories: moving ones are advanced here every tick,
+    // bb_server only sends a set when one is added / replaced
+    static SimKinematics obs_kin;
+    double               obs_t0 = 0.0;
+    sim_physics_kin_init(&obs_kin, params, obs_to_read);
+
+    // Ticks on an absolute dt grid: commands arriving mid-period are
+    // picked up at once but never shorten or stretch the tick
+    SimPeriodic tick;
+    sim_periodic_init(&tick, dt);
+
+    // Achieved tick period vs dt
+    SimJitter jitter;
+    sim_jitter_init(&jitter, "drone: tick", dt, params->jitter_report_interval);
+
+    // Framed messages in (sim_proto.h), state frames out
+    static SimMsg       msg;
+    static SimMsgWriter out;
+    static SimIpcRx     rx;
+    static SimIpcTx     tx;
+    SimMsgReader        in;
+    sim_proto_reader_init(&in);
+    sim_proto_writer_init(&out);
+    sim_ipc_tx_init(&tx);
+    sim_ipc_set_nonblock(fd_state_out);
+
+    // Physics ticks are timed from the deadline to the flushed state
+    SimMetricsTimer tick_timer;
+    unsigned long   obs_coalesced = 0;
+    sim_metrics_timer_init(&tick_timer, SIM_ROLE_DRONE);
+
     while (running) {
-        // Wait up to dt for a new CommandState from bb_server
+        // Tell master (supervisor) we are alive
+        sim_heartbeat_beat(SIM_ROLE_DRONE);
+
+        // Pick up a config edit published by master (tick boundary)
+        if (sim_params_refresh()) {
+            dt       = params->dt;
+            sim_periodic_set_period(&tick, dt);
+            sim_jitter_init(&jitter, "drone: tick", dt, params->jitter_report_interval);
+            sim_physics_wall_lut_build(&wall_lut, params);
+            if (obs_field.cell > 0.0) {
+                // Same node count (cell is restart-only), new rho / eta
+                sim_physics_field_init(&obs_field, params, obs_field.gx,
+                                       obs_field.gy, obs_field.capacity);
+                sim_physics_field_update(&obs_field, obstacles, num_obstacles);
+            }
+            sim_log_info("drone: params generation %lu (dt=%.3f, M=%.3f, K=%.3f)",
+                         sim_params_generation(), dt, params->mass, params->damping);
+        }
+
+        // Wait until the next tick for a new CommandState / obstacle set
         fd_set readfds;
         FD_ZERO(&readfds);
         FD_SET(fd_cmd_in, &readfds);
 
+        double left = sim_periodic_remaining(&tick);
         struct timeval tv;
-        tv.tv_sec  = 0;
-        tv.tv_usec = sleep_us;
+        tv.tv_sec  = (time_t)left;
+        tv.tv_usec = (suseconds_t)((left - (double)tv.tv_sec) * 1e6);
 
         int ready = select(fd_cmd_in + 1, &readfds, NULL, NULL, &tv);
         if (ready < 0) {
@@ -126,59 +209,124 @@ int main(int argc, char *argv[])
             break;
         }
 
-        if (ready > 0 && FD_ISSET(fd_cmd_in, &readfds)) {
-            CommandState new_c;
-            ssize_t r = read_full(fd_cmd_in, &new_c, sizeof(new_c));
-            if (r == (ssize_t)sizeof(new_c)) {
-                int reset_edge = (new_c.reset == 1 && c.reset == 0);
-                c = new_c;
+        // Everything one read brought in: commands in order (reset is an
+        // edge), obstacle sets collapse into one grid / field rebuild
+        if (ready > 0) {
+            ssize_t r       = sim_ipc_rx_fill(fd_cmd_in, &rx);
+            int     new_obs = 0;
+            int     quit    = 0;
 
-                if (c.quit) {
-                    sim_log_info("drone: quit flag set, exiting\n");
-                    break;
-                }
+            if (r > 0) {
+                sim_metrics_chan_bytes(SIM_METRIC_CHAN_DRONE_CMD, (uint64_t)r);
+            }
+            while (r > 0 && !quit && sim_proto_next(&rx, &in, &msg)) {
+                CommandState new_c;
+                sim_metrics_chan_add(SIM_METRIC_CHAN_DRONE_CMD, 1);
+                if (sim_proto_get_command(&msg, &new_c) == 0) {
+                    int reset_edge = (new_c.reset == 1 && c.reset == 0);
+                    c = new_c;
 
-                if (reset_edge) {
-                    // Reset back to center of the world
-                    d.x  = world_width  / 2.0;
-                    d.y  = world_height / 2.0;
-                    d.vx = 0.0;
-                    d.vy = 0.0;
+                    if (c.quit) {
+                        quit = 1;
+                    } else if (reset_edge) {
+                        // Reset back to center of the world
+                        d.x  = world_width  / 2.0;
+                        d.y  = world_height / 2.0;
+                        d.vx = 0.0;
+                        d.vy = 0.0;
+                    }
+                } else if (sim_proto_get_obstacles(&msg, obstacles, obs_to_read) >= 0) {
+                    obs_t0 = sim_proto_time_s(&msg);
+                    new_obs++;
+                } else {
+                    sim_log_info("drone: ignoring frame type %d (%u bytes)",
+                                 msg.h.type, (unsigned)msg.h.length);
                 }
-            } else if (r == 0) {
-                sim_log_info("drone: cmd pipe EOF, exiting\n");
+            }
+
+            if (quit) {
+                sim_log_info("drone: quit flag set, exiting");
+                break;
+            }
+            if (r == 0) {
+                sim_log_info("drone: cmd pipe EOF, exiting");
                 break;
             } else if (r < 0) {
-                perror("drone: read_full(fd_cmd_in)");
+                perror("drone: sim_ipc_rx_fill(fd_cmd_in)");
                 break;
             }
-        }
-
-        double fx = c.fx;
-        double fy = c.fy;
 
-        double ax = (fx - damping * d.vx) / mass;
-        double ay = (fy - damping * d.vy) / mass;
+            if (new_obs) {
+                obs_coalesced    += (unsigned long)(new_obs - 1);
+                num_obstacles     = obs_to_read;
+                env.num_obstacles = num_obstacles;
+                sim_physics_kin_set_obstacles(&obs_kin, obstacles, num_obstacles, obs_t0);
+                sim_physics_grid_build(&obs_grid, params, obstacles, num_obstacles);
+                sim_physics_field_update(&obs_field, obstacles, num_obstacles);
+            }
+        }
 
-        d.vx += ax * dt;
-        d.vy += ay * dt;
+        // Not at the deadline yet (woken by a message): keep waiting
+        if (sim_periodic_poll(&tick) == 0) {
+            continue;
+        }
+        sim_jitter_tick(&jitter);
+        sim_metrics_tick_begin(&tick_timer);
+        SIM_PROF_ZONE("drone_tick");
 
-        // Kill tiny velocities to avoid jitter when we're almost at rest
-        apply_motion_deadzone(&d);
+        // Moving obstacles to the tick's start, then the broad phase again
+        if (obs_kin.moving > 0) {
+            sim_physics_kin_advance(&obs_kin, now_s());
+            sim_physics_kin_get_obstacles(&obs_kin, obstacles, num_obstacles);
+            sim_physics_grid_build(&obs_grid, params, obstacles, num_obstacles);
+        }
 
-        d.x  += d.vx * dt;
-        d.y  += d.vy * dt;
+        // User force + wall/obstacle repulsion, integrated in adaptive
+        // sub-steps (one step in free flight, more near contacts), each
+        // swept against the obstacles (see sim_physics.h)
+        int hit;
+        int substeps;
+        {
+            SIM_PROF_ZONE("drone_step");
+            substeps = sim_physics_step_adaptive(&d, c.fx, c.fy, params,
+                                                 &env, dt, &hit);
+        }
+        total_ticks++;
+        total_substeps += substeps;
 
-        apply_world_bounds(&d, world_width, world_height);
+        if (hit >= 0 && hit != last_contact) {
+            collisions++;
+            sim_metrics_add(SIM_ROLE_DRONE, SIM_METRIC_COLLISIONS, 1);
+            sim_log_info("drone: COLLISION #%ld obstacle=%d pos=(%.2f,%.2f) v=(%.2f,%.2f)",
+                         collisions, hit, d.x, d.y, d.vx, d.vy);
+        }
+        last_contact = hit;
 
-        if (write_full(fd_state_out, &d, sizeof(d)) != (ssize_t)sizeof(d)) {
-            perror("drone: write_full(fd_state_out)");
+        // Queued, never blocking the tick on a busy bb_server. bb_server
+        // hit-tests every segment, so a full queue (SIM_IPC_TX_MAX_MSGS
+        // states, 6.4 s at dt 0.05) sheds the oldest rather than merging.
+        sim_proto_put_drone_state(&out, &d);
+        sim_proto_queue(&tx, &out, SIM_IPC_TX_DROP_OLDEST);
+        if (sim_ipc_tx_flush(fd_state_out, &tx) < 0) {
+            perror("drone: sim_ipc_tx_flush(fd_state_out)");
             break;
         }
+
+        sim_metrics_set(SIM_ROLE_DRONE, SIM_METRIC_DROPPED, tx.dropped);
+        sim_metrics_set(SIM_ROLE_DRONE, SIM_METRIC_COALESCED, obs_coalesced);
+        sim_metrics_set(SIM_ROLE_DRONE, SIM_METRIC_QUEUE_BYTES, sim_ipc_tx_pending(&tx));
+        sim_metrics_tick_end(&tick_timer);
     }
 
-    sim_log_info("drone: exiting\n");
-    close(fd_cmd_in);
-    close(fd_state_out);
+    sim_log_info("drone: exiting (collisions=%ld, ticks=%ld, substeps/tick=%.2f, overruns=%lu)",
+                 collisions, total_ticks,
+                 total_ticks > 0 ? (double)total_substeps / (double)total_ticks : 0.0,
+                 tick.overruns);
+    sim_log_info("drone: state queue: dropped=%lu pending=%zu bytes",
+                 tx.dropped, sim_ipc_tx_pending(&tx));
+    SIM_PROF_FLUSH();
+    sim_ipc_close(fd_cmd_in);
+    sim_ipc_close(fd_state_out);
+    free(field_buf);
     return EXIT_SUCCESS;
 }
@@ -6,18 +6,23 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 
 #include "sim_types.h"
 #include "sim_ipc.h"
 #include "sim_const.h"
 #include "sim_log.h"
+#include "sim_heartbeat.h"
 #include "sim_params.h"   // runtime parameters (force_step, max_force)
+#include "sim_role.h"
+#include "sim_rt.h"
+#include "sim_proto.h"
 
 // Flag set by the SIGINT handler to request a clean shutdown
 static volatile sig_atomic_t running = 1;
 
 // to play the music
-void play_sfx(const char *filename) {
+static void play_sfx(const char *filename) {
     pid_t pid = fork();
     if (pid == 0) {
         int fd = open("/dev/null", O_RDWR);
@@ -48,6 +53,7 @@ static double clamp(double v, double max)
     return v;
 }
 
+#ifndef SIM_SINGLE_PROCESS
 // Render the input UI (direction pad + flags + current command state)
 static void draw_ui(const CommandState *cmd)
 {
@@ -99,8 +105,9 @@ static void draw_ui(const CommandState *cmd)
     mvprintw(special_y + 1, 2, "s or SPACE = brake (zero force)");
     mvprintw(special_y + 2, 2, "r          = reset drone");
     mvprintw(special_y + 3, 2, "Q          = quit simulation & exit input");
+    mvprintw(special_y + 4, 2, "m          = metrics panel (map window)");
 
-    int cmd_y = special_y + 5;
+    int cmd_y = special_y + 6;
     mvprintw(cmd_y + 0, 0, "Current command:");
     mvprintw(cmd_y + 1, 2, "fx = %6.2f  fy = %6.2f", cmd->fx, cmd->fy);
     mvprintw(cmd_y + 2, 2, "brake = %d  reset = %d  quit = %d",
@@ -113,10 +120,55 @@ static void draw_ui(const CommandState *cmd)
     refresh();
 }
 
-int main(int argc, char *argv[])
+static void input_ui_begin(void)
+{
+    initscr();
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    curs_set(0);
+    timeout(100);
+}
+
+static void input_ui_end(void)          { endwin(); }
+static void input_ui_draw(const CommandState *cmd) { draw_ui(cmd); }
+static int  input_ui_getkey(void)       { return getch(); }
+
+#else
+/*
+    Single-process build: bb_server's thread owns the terminal and ncurses
+    is not thread-safe, so there is no input window. Keys are read as raw
+    bytes from stdin, which bb_server's ui_init() has put in cbreak /
+    noecho mode. Arrow keys and other escape sequences are not decoded
+    (none of them are bound).
+*/
+static void input_ui_begin(void)        {}
+static void input_ui_end(void)          {}
+static void input_ui_draw(const CommandState *cmd) { (void)cmd; }
+
+static int input_ui_getkey(void)
+{
+    struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+    if (poll(&pfd, 1, 100) <= 0) {
+        return ERR;
+    }
+
+    unsigned char c;
+    ssize_t n = read(STDIN_FILENO, &c, 1);
+    if (n == 1) {
+        return c;
+    }
+    if (n == 0) {
+        poll(NULL, 0, 100);  // stdin closed: keep the 100 ms pace
+    }
+    return ERR;
+}
+#endif
+
+SIM_ROLE_MAIN(input)
 {
     sim_log_init("input");
-    signal(SIGINT, handle_sigint);
+    SIM_ROLE_SIGNAL(SIGINT, handle_sigint);
 
     // Optional: don't die on broken pipe; log instead
     signal(SIGPIPE, SIG_IGN);
@@ -152,20 +204,25 @@ int main(int argc, char *argv[])
     cmd.quit     = 0;
     cmd.last_key = 0;
 
-    initscr();
-    cbreak();
-    noecho();
-    keypad(stdscr, TRUE);
-    curs_set(0);
-    timeout(100);
+    // Commands go out as sim_proto frames
+    static SimMsgWriter out;
+    sim_proto_writer_init(&out);
+
+    input_ui_begin();
 
     sim_log_info("input: started (ncurses)\n");
     fprintf(stderr, "input: started (ncurses)\n");
 
+    // CPU set / SCHED_FIFO / mlockall from [realtime]
+    sim_rt_apply(SIM_ROLE_INPUT, "input");
+
     while (running) {
-        draw_ui(&cmd);
+        // Tell master (supervisor) we are alive
+        sim_heartbeat_beat(SIM_ROLE_INPUT);
+
+        input_ui_draw(&cmd);
 
-        int ch = getch();
+        int ch = input_ui_getkey();
         if (ch == ERR) {
             continue;
         }
@@ -230,12 +287,10 @@ int main(int argc, char *argv[])
         cmd.fx = fx;
         cmd.fy = fy;
 
-        ssize_t w = write_full(fd_to_srv, &cmd, sizeof(cmd));
-        if (w != (ssize_t)sizeof(cmd)) {
-            endwin();
-            perror("input: write_full(fd_to_srv)");
-            fprintf(stderr, "input: write_full returned %zd (expected %zu)\n",
-                    w, sizeof(cmd));
+        sim_proto_put_command(&out, &cmd);
+        if (sim_proto_flush(fd_to_srv, &out) != 0) {
+            input_ui_end();
+            perror("input: sim_proto_flush(fd_to_srv)");
             break;
         }
 
@@ -253,7 +308,7 @@ int main(int argc, char *argv[])
     sim_log_info("input: exiting\n");
     fprintf(stderr, "input: exiting\n");
 
-    endwin();
-    close(fd_to_srv);
+    input_ui_end();
+    sim_ipc_close(fd_to_srv);
     return EXIT_SUCCESS;
 }
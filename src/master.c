@@ -1,241 +1,622 @@
+#define _GNU_SOURCE   // syscall() for pidfd_open
+
 #include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "sim_heartbeat.h"
 #include "sim_ipc.h"
+#include "sim_log.h"
+#include "sim_metrics.h"
 #include "sim_params.h"
-
-int main(void)
+#include "sim_prof.h"
+
+/*
+    Watch the directory holding the config rather than the file itself:
+    editors usually save by writing a temp file and renaming it over the
+    original, which would silently drop a watch on the old inode.
+    *out_base points into path at the file name to match events against.
+    Returns the inotify fd or -1.
+*/
+static int master_watch_config(const char *path, const char **out_base)
 {
-    // Load runtime parameters from config file (or fall back to defaults)
-    if (sim_params_load(NULL) != 0) {
-        fprintf(stderr,
-                "master: warning: could not load '%s', using built-in defaults\n",
-                SIM_PARAMS_DEFAULT_PATH);
+    char dir[PATH_MAX];
+    const char *slash = strrchr(path, '/');
+
+    if (slash == NULL) {
+        snprintf(dir, sizeof(dir), ".");
+        *out_base = path;
+    } else {
+        size_t len = (size_t)(slash - path);
+        if (len == 0) {
+            len = 1;  // "/file"
+        }
+        if (len >= sizeof(dir)) {
+            return -1;
+        }
+        memcpy(dir, path, len);
+        dir[len] = '\0';
+        *out_base = slash + 1;
     }
 
-    int pipe_drone_cmd[2];    // bb_server -> drone (CommandState)
-    int pipe_drone_state[2];  // drone -> bb_server (DroneState)
-    int pipe_input_cmd[2];    // input -> bb_server (CommandState)
-    int pipe_obstacles[2];    // obstacles -> bb_server (Obstacle[])
-    int pipe_targets[2];      // targets   -> bb_server (Target[])
-
-    if (pipe(pipe_drone_cmd) == -1) {
-        perror("master: pipe_drone_cmd");
-        return EXIT_FAILURE;
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        return -1;
     }
-    if (pipe(pipe_drone_state) == -1) {
-        perror("master: pipe_drone_state");
-        return EXIT_FAILURE;
-    }
-    if (pipe(pipe_input_cmd) == -1) {
-        perror("master: pipe_input_cmd");
-        return EXIT_FAILURE;
+    if (inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        close(fd);
+        return -1;
     }
-    if (pipe(pipe_obstacles) == -1) {
-        perror("master: pipe_obstacles");
-        return EXIT_FAILURE;
-    }
-    if (pipe(pipe_targets) == -1) {
-        perror("master: pipe_targets");
-        return EXIT_FAILURE;
+    return fd;
+}
+
+// Drain pending events; 1 if any of them touched the config file
+static int master_config_changed(int watch_fd, const char *base)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+
+    for (;;) {
+        ssize_t n = read(watch_fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->len > 0 && strcmp(ev->name, base) == 0) {
+                changed = 1;
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
     }
+    return changed;
+}
 
-    // bb_server
-    pid_t bb_pid = fork();
-    if (bb_pid < 0) {
-        perror("master: fork bb_server");
-        return EXIT_FAILURE;
+/*
+    Supervisor.
+
+    master owns every pipe for the whole run, so a worker that dies does
+    not turn into EOF on the other side: the channel just goes quiet until
+    the replacement process re-attaches to the same fds.
+
+    - drone, obstacles, targets are workers: on crash (pidfd / SIGCHLD) or
+      hang (heartbeat silent for MASTER_HANG_TIMEOUT_S) they are restarted
+      with exponential backoff. Restart latency = time from detection to
+      the first heartbeat of the new process.
+    - bb_server and input own the UI: when either exits the whole
+      simulation shuts down, as before.
+*/
+#define MASTER_HANG_TIMEOUT_S   2.0     // > SIM_HEARTBEAT_PERIOD_S, > largest dt
+#define MASTER_BACKOFF_MIN_S    0.05
+#define MASTER_BACKOFF_MAX_S    5.0
+#define MASTER_STABLE_S         10.0    // up this long: backoff back to minimum
+#define MASTER_SHUTDOWN_GRACE_S 2.0     // SIGINT -> SIGKILL
+
+enum {
+    PIPE_DRONE_CMD,      // bb_server -> drone (commands + obstacle sets)
+    PIPE_DRONE_STATE,    // drone -> bb_server (drone state)
+    PIPE_INPUT_CMD,      // input -> bb_server (commands)
+    PIPE_OBSTACLES,      // obstacles -> bb_server (obstacle sets)
+    PIPE_TARGETS,        // targets   -> bb_server (target changes)
+    PIPE_TARGET_HITS,    // bb_server -> targets (hit target ids)
+    MASTER_NUM_PIPES
+};
+
+static const char *const g_pipe_names[MASTER_NUM_PIPES] = {
+    "pipe_drone_cmd", "pipe_drone_state", "pipe_input_cmd",
+    "pipe_obstacles", "pipe_targets", "pipe_target_hits"
+};
+
+typedef struct {
+    const char *name;
+    int         restartable;
+    pid_t       pid;            // 0 = not running
+    int         pidfd;          // -1 if pidfd_open is unavailable
+    uint64_t    last_beat;
+    double      last_beat_at;   // monotonic seconds
+    double      started_at;
+    double      down_at;        // crash / hang detected (restart latency)
+    int         hung;           // killed by us for missing heartbeats
+    int         awaiting_beat;  // restarted, first heartbeat not seen yet
+    double      backoff;
+    double      restart_at;     // > 0: restart pending at this time
+    long        restarts;
+    double      latency_sum_ms;
+} MasterChild;
+
+static double master_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int master_pidfd_open(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+// In a freshly forked child: close every pipe end except the listed ones
+static void master_close_pipes_except(int pipes[][2], const int *keep, int num_keep)
+{
+    for (int i = 0; i < MASTER_NUM_PIPES; ++i) {
+        for (int e = 0; e < 2; ++e) {
+            int kept = 0;
+            for (int k = 0; k < num_keep; ++k) {
+                if (pipes[i][e] == keep[k]) {
+                    kept = 1;
+                }
+            }
+            if (!kept) {
+                close(pipes[i][e]);
+            }
+        }
     }
+}
 
-    if (bb_pid == 0) {
-        // Child: bb_server in its own Konsole window
-        // Keep:
-        //   pipe_drone_state[0]
-        //   pipe_drone_cmd[1]
-        //   pipe_input_cmd[0]
-        //   pipe_obstacles[0]
-        //   pipe_targets[0]
-
-        // Close unused ends in this child
-        close(pipe_drone_state[1]);
-        close(pipe_drone_cmd[0]);
-        close(pipe_input_cmd[1]);
-        close(pipe_obstacles[1]);
-        close(pipe_targets[1]);
-
-        char fd_drone_state_in[16];
-        char fd_drone_cmd_out[16];
-        char fd_input_cmd_in[16];
-        char fd_obs_in[16];
-        char fd_tgt_in[16];
-
-        snprintf(fd_drone_state_in, sizeof(fd_drone_state_in), "%d", pipe_drone_state[0]);
-        snprintf(fd_drone_cmd_out,   sizeof(fd_drone_cmd_out),   "%d", pipe_drone_cmd[1]);
-        snprintf(fd_input_cmd_in,    sizeof(fd_input_cmd_in),    "%d", pipe_input_cmd[0]);
-        snprintf(fd_obs_in,          sizeof(fd_obs_in),          "%d", pipe_obstacles[0]);
-        snprintf(fd_tgt_in,          sizeof(fd_tgt_in),          "%d", pipe_targets[0]);
+// Child side of master_spawn(): wire fds, exec the role's binary
+static void master_exec_role(int role, int pipes[][2])
+{
+    char a[7][16];
+
+    switch (role) {
+    case SIM_ROLE_BB_SERVER: {
+        const int keep[] = {
+            pipes[PIPE_DRONE_STATE][0], pipes[PIPE_DRONE_CMD][1],
+            pipes[PIPE_INPUT_CMD][0],   pipes[PIPE_OBSTACLES][0],
+            pipes[PIPE_TARGETS][0],     pipes[PIPE_TARGET_HITS][1]
+        };
+        master_close_pipes_except(pipes, keep, 6);
+        for (int i = 0; i < 6; ++i) {
+            snprintf(a[i], sizeof(a[i]), "%d", keep[i]);
+        }
 
         // Konsole -T "BB_SERVER" -e ./bb_server <fds...>
-        execlp("konsole", "konsole",
-               "-T", "BB_SERVER",
-               "-e", "./bb_server",
-               fd_drone_state_in,
-               fd_drone_cmd_out,
-               fd_input_cmd_in,
-               fd_obs_in,
-               fd_tgt_in,
-               (char *)NULL);
+        execlp("konsole", "konsole", "-T", "BB_SERVER", "-e", "./bb_server",
+               a[0], a[1], a[2], a[3], a[4], a[5], (char *)NULL);
 
         // Fallback: run directly if Konsole is unavailable
         execl("./bb_server", "./bb_server",
-              fd_drone_state_in,
-              fd_drone_cmd_out,
-              fd_input_cmd_in,
-              fd_obs_in,
-              fd_tgt_in,
-              (char *)NULL);
-
+              a[0], a[1], a[2], a[3], a[4], a[5], (char *)NULL);
         perror("master: exec bb_server");
-        _exit(EXIT_FAILURE);
+        break;
     }
+    case SIM_ROLE_INPUT: {
+        const int keep[] = { pipes[PIPE_INPUT_CMD][1] };
+        master_close_pipes_except(pipes, keep, 1);
+        snprintf(a[0], sizeof(a[0]), "%d", keep[0]);
 
-    // Input
-    pid_t input_pid = fork();
-    if (input_pid < 0) {
-        perror("master: fork input");
-        return EXIT_FAILURE;
+        // Konsole -T "INPUT" -e ./input <fd_cmd_out>
+        execlp("konsole", "konsole", "-T", "INPUT", "-e", "./input", a[0], (char *)NULL);
+
+        // Fallback: run directly
+        execl("./input", "./input", a[0], (char *)NULL);
+        perror("master: exec input");
+        break;
+    }
+    case SIM_ROLE_DRONE: {
+        const int keep[] = {
+            pipes[PIPE_DRONE_CMD][0], pipes[PIPE_DRONE_STATE][1]
+        };
+        master_close_pipes_except(pipes, keep, 2);
+        for (int i = 0; i < 2; ++i) {
+            snprintf(a[i], sizeof(a[i]), "%d", keep[i]);
+        }
+        execl("./drone", "./drone", a[0], a[1], (char *)NULL);
+        perror("master: exec drone");
+        break;
+    }
+    case SIM_ROLE_OBSTACLES: {
+        const int keep[] = { pipes[PIPE_OBSTACLES][1] };
+        master_close_pipes_except(pipes, keep, 1);
+        snprintf(a[0], sizeof(a[0]), "%d", keep[0]);
+        execl("./obstacles", "./obstacles", a[0], (char *)NULL);
+        perror("master: exec obstacles");
+        break;
+    }
+    case SIM_ROLE_TARGETS: {
+        const int keep[] = {
+            pipes[PIPE_TARGETS][1], pipes[PIPE_TARGET_HITS][0]
+        };
+        master_close_pipes_except(pipes, keep, 2);
+        for (int i = 0; i < 2; ++i) {
+            snprintf(a[i], sizeof(a[i]), "%d", keep[i]);
+        }
+        execl("./targets", "./targets", a[0], a[1], (char *)NULL);
+        perror("master: exec targets");
+        break;
+    }
+    default:
+        break;
     }
+    _exit(EXIT_FAILURE);
+}
 
-    if (input_pid == 0) {
-        // Keep: pipe_input_cmd[1]
-        // Close unused ends
-        close(pipe_input_cmd[0]);
-        close(pipe_drone_cmd[0]);
-        close(pipe_drone_cmd[1]);
-        close(pipe_drone_state[0]);
-        close(pipe_drone_state[1]);
-        close(pipe_obstacles[0]);
-        close(pipe_obstacles[1]);
-        close(pipe_targets[0]);
-        close(pipe_targets[1]);
+static int master_spawn(MasterChild *c, int role, int pipes[][2],
+                        const sigset_t *child_mask)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("master: fork");
+        return -1;
+    }
 
-        char fd_cmd_out[16];
-        snprintf(fd_cmd_out, sizeof(fd_cmd_out), "%d", pipe_input_cmd[1]);
+    if (pid == 0) {
+        // Children get the signal mask master had before the signalfd
+        sigprocmask(SIG_SETMASK, child_mask, NULL);
+        master_exec_role(role, pipes);
+    }
 
-        // Konsole -T "INPUT" -e ./input <fd_cmd_out>
-        execlp("konsole", "konsole",
-               "-T", "INPUT",
-               "-e", "./input",
-               fd_cmd_out,
-               (char *)NULL);
+    double now = master_now();
+    c->pid           = pid;
+    c->pidfd         = master_pidfd_open(pid);
+    c->last_beat     = sim_heartbeat_read(role);
+    c->last_beat_at  = now;
+    c->started_at    = now;
+    c->hung          = 0;
+    c->restart_at    = 0.0;
+    return 0;
+}
 
-        // Fallback: run directly
-        execl("./input", "./input", fd_cmd_out, (char *)NULL);
+static void master_signal_all(MasterChild *children, int sig)
+{
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        if (children[r].pid > 0) {
+            kill(children[r].pid, sig);
+        }
+    }
+}
 
-        perror("master: exec input");
-        _exit(EXIT_FAILURE);
+/*
+    Collect every child that has exited. Workers get a restart scheduled,
+    a UI process exiting requests shutdown (returns 1).
+*/
+static int master_reap(MasterChild *children, int shutting_down)
+{
+    int stop = 0;
+
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        MasterChild *c = &children[r];
+        int status;
+
+        if (c->pid <= 0 || waitpid(c->pid, &status, WNOHANG) != c->pid) {
+            continue;
+        }
+
+        double now = master_now();
+        if (c->pidfd >= 0) {
+            close(c->pidfd);
+            c->pidfd = -1;
+        }
+        c->pid = 0;
+
+        if (WIFSIGNALED(status)) {
+            sim_log_info("master: %s killed by signal %d%s", c->name,
+                         WTERMSIG(status), c->hung ? " (hung)" : "");
+        } else {
+            sim_log_info("master: %s exited with status %d", c->name,
+                         WEXITSTATUS(status));
+        }
+
+        if (shutting_down) {
+            continue;
+        }
+        if (!c->restartable) {
+            stop = 1;
+            continue;
+        }
+
+        // A hang was detected when we killed it; a crash is detected now
+        if (!c->hung) {
+            c->down_at = now;
+        }
+        if (now - c->started_at >= MASTER_STABLE_S) {
+            c->backoff = MASTER_BACKOFF_MIN_S;
+        }
+        c->restart_at = now + c->backoff;
+        sim_log_info("master: restarting %s in %.0f ms", c->name, c->backoff * 1e3);
+
+        c->backoff *= 2.0;
+        if (c->backoff > MASTER_BACKOFF_MAX_S) {
+            c->backoff = MASTER_BACKOFF_MAX_S;
+        }
     }
+    return stop;
+}
 
-    // Drone
-    pid_t drone_pid = fork();
-    if (drone_pid < 0) {
-        perror("master: fork drone");
-        return EXIT_FAILURE;
+// Heartbeat bookkeeping for running workers: latency report, hang kill
+static void master_check_heartbeats(MasterChild *children)
+{
+    double now = master_now();
+
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        MasterChild *c = &children[r];
+        if (c->pid <= 0 || !c->restartable || c->hung) {
+            continue;
+        }
+
+        uint64_t beat = sim_heartbeat_read(r);
+        if (beat != c->last_beat) {
+            c->last_beat    = beat;
+            c->last_beat_at = now;
+
+            if (c->awaiting_beat) {
+                double ms = (now - c->down_at) * 1e3;
+                c->awaiting_beat   = 0;
+                c->latency_sum_ms += ms;
+                sim_log_info("master: %s back (pid %d), restart latency %.1f ms",
+                             c->name, (int)c->pid, ms);
+            }
+            continue;
+        }
+
+        if (now - c->last_beat_at > MASTER_HANG_TIMEOUT_S) {
+            sim_log_info("master: %s (pid %d) silent for %.1f s, killing it",
+                         c->name, (int)c->pid, now - c->last_beat_at);
+            c->hung    = 1;
+            c->down_at = now;
+            kill(c->pid, SIGKILL);
+        }
     }
+}
 
-    if (drone_pid == 0) {
-        // Keep:
-        //   cmd_in:    pipe_drone_cmd[0] (read)
-        //   state_out: pipe_drone_state[1] (write)
+int main(void)
+{
+    sim_log_init("master");
 
-        // Close unused ends
-        close(pipe_drone_cmd[1]);
-        close(pipe_drone_state[0]);
-        close(pipe_input_cmd[0]);
-        close(pipe_input_cmd[1]);
-        close(pipe_obstacles[0]);
-        close(pipe_obstacles[1]);
-        close(pipe_targets[0]);
-        close(pipe_targets[1]);
+    // Load runtime parameters from config file (or fall back to defaults)
+    if (sim_params_load(NULL) != 0) {
+        fprintf(stderr,
+                "master: warning: could not fully load '%s', built-in defaults fill the gaps\n",
+                sim_params_resolve_path(NULL));
+    }
 
-        char fd_cmd_in[16];
-        char fd_state_out[16];
+    // Parse once here; children inherit the binary block and just map it.
+    // Both shared blocks stay open: restarted children need them too.
+    int params_fd = sim_params_publish();
+    if (params_fd < 0) {
+        perror("master: sim_params_publish");
+        fprintf(stderr, "master: warning: children will parse the config themselves\n");
+    }
 
-        snprintf(fd_cmd_in,    sizeof(fd_cmd_in),    "%d", pipe_drone_cmd[0]);
-        snprintf(fd_state_out, sizeof(fd_state_out), "%d", pipe_drone_state[1]);
+    int heartbeat_fd = sim_heartbeat_create();
+    if (heartbeat_fd < 0) {
+        perror("master: sim_heartbeat_create");
+        fprintf(stderr, "master: warning: hung workers will not be detected\n");
+    }
 
-        execl("./drone", "./drone", fd_cmd_in, fd_state_out, (char *)NULL);
+    int metrics_fd = sim_metrics_create();
+    if (metrics_fd < 0) {
+        perror("master: sim_metrics_create");
+        fprintf(stderr, "master: warning: the metrics panel will stay empty\n");
+    }
 
-        perror("master: exec drone");
-        _exit(EXIT_FAILURE);
+    // Profiling builds only: every child appends its zones to one trace
+    if (SIM_PROF_OPEN() != 0) {
+        perror("master: sim_prof_open");
     }
 
-    // Obstacles
-    pid_t obstacles_pid = fork();
-    if (obstacles_pid < 0) {
-        perror("master: fork obstacles");
+    int pipes[MASTER_NUM_PIPES][2];
+    for (int i = 0; i < MASTER_NUM_PIPES; ++i) {
+        if (pipe(pipes[i]) == -1) {
+            fprintf(stderr, "master: %s: %s\n", g_pipe_names[i], strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Signals arrive through a signalfd; children get the original mask
+    sigset_t mask;
+    sigset_t orig_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGHUP);
+    if (sigprocmask(SIG_BLOCK, &mask, &orig_mask) != 0) {
+        perror("master: sigprocmask");
+        return EXIT_FAILURE;
+    }
+    int sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sig_fd < 0) {
+        perror("master: signalfd");
         return EXIT_FAILURE;
     }
 
-    if (obstacles_pid == 0) {
-        // Keep: pipe_obstacles[1] (write to bb_server)
-        // Close all other ends
-        close(pipe_obstacles[0]);
-        close(pipe_drone_cmd[0]);   close(pipe_drone_cmd[1]);
-        close(pipe_drone_state[0]); close(pipe_drone_state[1]);
-        close(pipe_input_cmd[0]);   close(pipe_input_cmd[1]);
-        close(pipe_targets[0]);     close(pipe_targets[1]);
+    static const char *const names[SIM_ROLE_COUNT] = {
+        "bb_server", "input", "drone", "obstacles", "targets"
+    };
+    MasterChild children[SIM_ROLE_COUNT];
+    memset(children, 0, sizeof(children));
+
+    // Same start order as before: UI first, then the workers
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        MasterChild *c = &children[r];
+        c->name        = names[r];
+        c->restartable = (r == SIM_ROLE_DRONE || r == SIM_ROLE_OBSTACLES ||
+                          r == SIM_ROLE_TARGETS);
+        c->pidfd       = -1;
+        c->backoff     = MASTER_BACKOFF_MIN_S;
+
+        if (master_spawn(c, r, pipes, &orig_mask) != 0) {
+            master_signal_all(children, SIGKILL);
+            return EXIT_FAILURE;
+        }
+    }
 
-        char fd_obs_out[16];
-        snprintf(fd_obs_out, sizeof(fd_obs_out), "%d", pipe_obstacles[1]);
+    // Watch the config and push edits to the running children
+    const char *config_path = sim_params_resolve_path(NULL);
+    const char *config_base = NULL;
+    int watch_fd = -1;
 
-        execl("./obstacles", "./obstacles", fd_obs_out, (char *)NULL);
-        perror("master: exec obstacles");
-        _exit(EXIT_FAILURE);
+    if (params_fd >= 0) {
+        watch_fd = master_watch_config(config_path, &config_base);
+        if (watch_fd < 0) {
+            perror("master: inotify");
+        }
     }
 
-    // Targets
-    pid_t targets_pid = fork();
-    if (targets_pid < 0) {
-        perror("master: fork targets");
-        return EXIT_FAILURE;
+    sim_log_info("master: children started (rng_seed=%llu), watching '%s' for changes: %s",
+                 (unsigned long long)sim_params_get()->rng_seed,
+                 config_path, watch_fd >= 0 ? "yes" : "no");
+
+    // Event loop: signals, child exits (pidfd), config edits, heartbeats
+    int    shutting_down = 0;
+    double shutdown_at   = 0.0;
+
+    for (;;) {
+        struct pollfd pfd[2 + SIM_ROLE_COUNT];
+        int nfds = 0;
+
+        pfd[nfds].fd = sig_fd;
+        pfd[nfds].events = POLLIN;
+        pfd[nfds].revents = 0;
+        nfds++;
+
+        int watch_idx = -1;
+        if (watch_fd >= 0 && !shutting_down) {
+            watch_idx = nfds;
+            pfd[nfds].fd = watch_fd;
+            pfd[nfds].events = POLLIN;
+            pfd[nfds].revents = 0;
+            nfds++;
+        }
+        for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+            if (children[r].pid > 0 && children[r].pidfd >= 0) {
+                pfd[nfds].fd = children[r].pidfd;
+                pfd[nfds].events = POLLIN;
+                pfd[nfds].revents = 0;
+                nfds++;
+            }
+        }
+
+        // Wake for heartbeat checks, or earlier for a due restart
+        int timeout_ms = 100;
+        for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+            if (children[r].pid == 0 && children[r].restart_at > 0.0) {
+                int due = (int)((children[r].restart_at - master_now()) * 1e3) + 1;
+                if (due < timeout_ms) {
+                    timeout_ms = (due > 0) ? due : 0;
+                }
+            }
+        }
+
+        int ready = poll(pfd, (nfds_t)nfds, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            perror("master: poll");
+            break;
+        }
+
+        // Drain signals: SIGCHLD only wakes us up, reaping is below
+        struct signalfd_siginfo si;
+        while (read(sig_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+            if (si.ssi_signo != SIGCHLD && !shutting_down) {
+                sim_log_info("master: signal %u, shutting down", si.ssi_signo);
+                shutting_down = 1;
+            }
+        }
+
+        if (master_reap(children, shutting_down) && !shutting_down) {
+            sim_log_info("master: UI process gone, shutting down");
+            shutting_down = 1;
+        }
+
+        if (shutting_down) {
+            if (shutdown_at == 0.0) {
+                shutdown_at = master_now();
+                master_signal_all(children, SIGINT);
+            } else if (master_now() - shutdown_at > MASTER_SHUTDOWN_GRACE_S) {
+                master_signal_all(children, SIGKILL);
+            }
+
+            int alive = 0;
+            for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+                alive += (children[r].pid > 0);
+            }
+            if (alive == 0) {
+                break;
+            }
+            continue;
+        }
+
+        // Pending restarts whose backoff has elapsed
+        double now = master_now();
+        for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+            MasterChild *c = &children[r];
+            if (c->pid == 0 && c->restart_at > 0.0 && now >= c->restart_at) {
+                // Counted before the fork: the new instance reads it as
+                // its epoch (targets tags its set with it)
+                sim_metrics_set(r, SIM_METRIC_RESTARTS, (uint64_t)(c->restarts + 1));
+                if (master_spawn(c, r, pipes, &orig_mask) == 0) {
+                    c->restarts++;
+                    c->awaiting_beat = 1;
+                    sim_log_info("master: %s restarted as pid %d (restart #%ld)",
+                                 c->name, (int)c->pid, c->restarts);
+                } else {
+                    sim_metrics_set(r, SIM_METRIC_RESTARTS, (uint64_t)c->restarts);
+                    c->restart_at = now + c->backoff;
+                }
+            }
+        }
+
+        master_check_heartbeats(children);
+
+        if (watch_idx >= 0 && (pfd[watch_idx].revents & POLLIN) &&
+            master_config_changed(watch_fd, config_base)) {
+            int rc = sim_params_reload(config_path);
+            if (rc > 0) {
+                sim_log_info("master: config reloaded, generation %lu",
+                             sim_params_generation());
+            } else if (rc < 0) {
+                sim_log_info("master: config reload failed, keeping generation %lu",
+                             sim_params_generation());
+            }
+        }
     }
 
-    if (targets_pid == 0) {
-        // Keep: pipe_targets[1] (write to bb_server)
-        // Close all other ends
-        close(pipe_targets[0]);
-        close(pipe_drone_cmd[0]);   close(pipe_drone_cmd[1]);
-        close(pipe_drone_state[0]); close(pipe_drone_state[1]);
-        close(pipe_input_cmd[0]);   close(pipe_input_cmd[1]);
-        close(pipe_obstacles[0]);   close(pipe_obstacles[1]);
-
-        char fd_tgt_out[16];
-        snprintf(fd_tgt_out, sizeof(fd_tgt_out), "%d", pipe_targets[1]);
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        const MasterChild *c = &children[r];
+        if (c->restarts > 0) {
+            sim_log_info("master: %s restarted %ld times, mean restart latency %.1f ms",
+                         c->name, c->restarts, c->latency_sum_ms / (double)c->restarts);
+        }
+    }
 
-        execl("./targets", "./targets", fd_tgt_out, (char *)NULL);
-        perror("master: exec targets");
-        _exit(EXIT_FAILURE);
-    }
-
-    // Close unused pipes in master
-    close(pipe_drone_cmd[0]);   close(pipe_drone_cmd[1]);
-    close(pipe_drone_state[0]); close(pipe_drone_state[1]);
-    close(pipe_input_cmd[0]);   close(pipe_input_cmd[1]);
-    close(pipe_obstacles[0]);   close(pipe_obstacles[1]);
-    close(pipe_targets[0]);     close(pipe_targets[1]);
-
-    // Wait for children
-    int status;
-    (void)waitpid(drone_pid, &status, 0);
-    (void)waitpid(input_pid, &status, 0);
-    (void)waitpid(bb_pid, &status, 0);
-    (void)waitpid(obstacles_pid, &status, 0);
-    (void)waitpid(targets_pid, &status, 0);
+    for (int i = 0; i < MASTER_NUM_PIPES; ++i) {
+        close(pipes[i][0]);
+        close(pipes[i][1]);
+    }
+    if (watch_fd >= 0) {
+        close(watch_fd);
+    }
+    if (params_fd >= 0) {
+        close(params_fd);
+    }
+    if (heartbeat_fd >= 0) {
+        close(heartbeat_fd);
+    }
+    if (metrics_fd >= 0) {
+        close(metrics_fd);
+    }
+    close(sig_fd);
+    sim_log_close();
 
     return EXIT_SUCCESS;
 }
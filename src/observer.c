@@ -0,0 +1,221 @@
+// Runtime observer: attach to bb_server's snapshot socket, print a status
+// line per second and optionally record every snapshot.
+//   ./sim_observer [socket] [recording]
+//   ./sim_observer -m
+// socket defaults to observer_socket from the config. The recording is
+// the raw sim_proto frame stream (readable again with sim_ipc_rx_fill()
+// and sim_proto_next()).
+// -m follows the shared-memory snapshot ring (sim_snapshot.h) instead.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_ipc.h"
+#include "sim_params.h"
+#include "sim_proto.h"
+#include "sim_snapshot.h"
+#include "sim_types.h"
+
+// Records taken per receive call
+#define SIM_OBSERVER_BATCH 16
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_sigint(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// -m: poll the shared-memory ring, no recording
+static int observe_shm(void)
+{
+    SimSnapshotHandle h;
+    if (sim_snapshot_subscribe(&h) != 0) {
+        perror(SIM_SNAPSHOT_SHM);
+        return EXIT_FAILURE;
+    }
+    printf("subscribed to %s (slot %d)\n", SIM_SNAPSHOT_SHM, h.sub);
+
+    static SimSnapshot snap;
+    unsigned long      received    = 0;
+    double             next_report = now_s() + 1.0;
+    const struct timespec idle     = { 0, 5 * 1000000L };
+
+    while (running) {
+        int r = sim_snapshot_next(&h, &snap);
+        if (r < 0) {
+            printf("bb_server closed the ring\n");
+            break;
+        }
+        if (r == 0) {
+            nanosleep(&idle, NULL);
+        } else {
+            received++;
+        }
+
+        if (now_s() >= next_report) {
+            next_report += 1.0;
+            printf("snapshots=%lu seq=%llu drone=(%.2f,%.2f) score=%.1f obstacles=%d "
+                   "targets=%d dropped=%lu\n",
+                   received, (unsigned long long)snap.seq,
+                   snap.world.drone.x, snap.world.drone.y, snap.world.score,
+                   snap.world.num_obstacles, snap.world.num_targets,
+                   sim_snapshot_dropped(&h));
+            fflush(stdout);
+        }
+    }
+
+    printf("unsubscribed: %lu snapshots, %lu dropped\n", received, sim_snapshot_dropped(&h));
+    sim_snapshot_close(&h);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sigint;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (argc > 1 && strcmp(argv[1], "-m") == 0) {
+        return observe_shm();
+    }
+
+    const char *path = NULL;
+    if (argc > 1) {
+        path = argv[1];
+    } else {
+        if (sim_params_load(NULL) != 0) {
+            fprintf(stderr, "%s: warning: could not fully load '%s'\n",
+                    argv[0], sim_params_resolve_path(NULL));
+        }
+        path = sim_params_get()->observer_socket;
+    }
+    if (path[0] == '\0') {
+        fprintf(stderr, "usage: %s [socket] [recording] | -m (no observer_socket in config)\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int fd = sim_ipc_connect(path);
+    if (fd < 0) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    int rec = -1;
+    if (argc > 2) {
+        rec = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (rec < 0) {
+            perror(argv[2]);
+            close(fd);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("attached to %s\n", path);
+
+    // Up to SIM_OBSERVER_BATCH queued records per recvmmsg, written to the
+    // recording with one writev
+    static uint8_t  bufs[SIM_OBSERVER_BATCH][SIM_PROTO_BATCH_MAX];
+    struct iovec    recs[SIM_OBSERVER_BATCH];
+    size_t          lens[SIM_OBSERVER_BATCH];
+    static SimMsg   msg;
+    static Obstacle obstacles[SIM_MAX_OBSTACLES];
+    static Target   targets[SIM_MAX_TARGETS];
+    SimMsgReader    reader;
+    DroneState      drone = { 0.0, 0.0, 0.0, 0.0 };
+    int             num_obstacles = 0;
+    int             num_targets   = 0;
+    unsigned long   records       = 0;
+    unsigned long   batches       = 0;
+    double          next_report   = now_s() + 1.0;
+
+    sim_proto_reader_init(&reader);
+    for (int i = 0; i < SIM_OBSERVER_BATCH; ++i) {
+        recs[i].iov_base = bufs[i];
+        recs[i].iov_len  = sizeof(bufs[i]);
+    }
+
+    while (running) {
+        int got = sim_ipc_recv_batch(fd, recs, lens, SIM_OBSERVER_BATCH, 1);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("recvmmsg");
+            break;
+        }
+        // We never send empty records: an empty one is the peer's EOF
+        if (got == 0 || lens[0] == 0) {
+            printf("bb_server closed the connection\n");
+            break;
+        }
+        batches++;
+        records += (unsigned long)got;
+
+        if (rec >= 0) {
+            struct iovec out[SIM_OBSERVER_BATCH];
+            ssize_t      want = 0;
+            for (int i = 0; i < got; ++i) {
+                out[i].iov_base = bufs[i];
+                out[i].iov_len  = lens[i];
+                want           += (ssize_t)lens[i];
+            }
+            if (sim_ipc_writev_full(rec, out, got) != want) {
+                perror(argv[2]);
+                break;
+            }
+        }
+
+        for (int i = 0; i < got; ++i) {
+            size_t off = 0;
+            size_t used;
+            while ((used = sim_proto_decode(bufs[i] + off, lens[i] - off, &reader, &msg)) > 0) {
+                off += used;
+                int count;
+                if (sim_proto_get_drone_state(&msg, &drone) == 0) {
+                    continue;
+                }
+                if ((count = sim_proto_get_obstacles(&msg, obstacles, SIM_MAX_OBSTACLES)) >= 0) {
+                    num_obstacles = count;
+                } else if ((count = sim_proto_get_targets(&msg, targets, SIM_MAX_TARGETS, NULL)) >= 0) {
+                    num_targets = count;
+                }
+            }
+        }
+
+        if (now_s() >= next_report) {
+            next_report += 1.0;
+            printf("snapshots=%lu drone=(%.2f,%.2f) v=(%.2f,%.2f) obstacles=%d targets=%d "
+                   "missed=%lu\n",
+                   records, drone.x, drone.y, drone.vx, drone.vy,
+                   num_obstacles, num_targets, reader.gaps);
+            fflush(stdout);
+        }
+    }
+
+    printf("detached: %lu snapshots in %lu receives, %lu frames, %lu frames missed\n",
+           records, batches, reader.frames, reader.gaps);
+    if (rec >= 0) {
+        close(rec);
+    }
+    close(fd);
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,7 @@
 // Obstacles process.
-// Generates a batch of static obstacles and sends them periodically to bb_server
-// via an anonymous pipe. bb_server stores them in WorldState and uses them
-// for drawing / repulsion in Phase 3.
+// Generates a batch of obstacles (static, or moving with obstacle_speed) and
+// sends them periodically to bb_server via an anonymous pipe, as trajectories:
+// bb_server and the drone move them on their own between updates.
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,6 +13,13 @@
 #include "sim_ipc.h"
 #include "sim_params.h"
 #include "sim_log.h"
+#include "sim_heartbeat.h"
+#include "sim_rng.h"
+#include "sim_scenario.h"
+#include "sim_role.h"
+#include "sim_rt.h"
+#include "sim_proto.h"
+#include "sim_physics.h"
 #include "sim_const.h"   
 
 static volatile sig_atomic_t running = 1;
@@ -23,29 +30,83 @@ static void handle_sigint(int sig)
     running = 0;
 }
 
-// small helper to keep obstacle generation in one place
-static void generate_random_obstacle(Obstacle *o, const SimParams *params, double radius)
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// small helper to keep obstacle generation in one place:
+// n obstacles at uniform positions, drawn as one batch, then (moving
+// obstacles only) velocities uniform in [-speed, speed) per axis
+static void generate_random_obstacles(Obstacle *o, int n, const SimParams *params,
+                                      double radius, SimRng *rng)
 {
     double margin = radius; 
+    double xs[SIM_MAX_OBSTACLES];
+    double ys[SIM_MAX_OBSTACLES];
+    double vxs[SIM_MAX_OBSTACLES] = { 0.0 };
+    double vys[SIM_MAX_OBSTACLES] = { 0.0 };
 
     double x_range = (double)params->world_width  - 2.0 * margin;
     double y_range = (double)params->world_height - 2.0 * margin;
     if (x_range < 0.0) x_range = 0.0;
     if (y_range < 0.0) y_range = 0.0;
 
-    double rx = (double)rand() / (double)RAND_MAX;
-    double ry = (double)rand() / (double)RAND_MAX;
+    sim_rng_uniform_points(rng, margin, margin, x_range, y_range, xs, ys, n);
+
+    double speed = params->obstacle_speed;
+    if (speed > 0.0) {
+        sim_rng_uniform_points(rng, -speed, -speed, 2.0 * speed, 2.0 * speed, vxs, vys, n);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        o[i].x      = xs[i];
+        o[i].y      = ys[i];
+        o[i].vx     = vxs[i];
+        o[i].vy     = vys[i];
+        o[i].radius = radius;
+        o[i].active = 1;
+    }
+}
 
-    o->x      = margin + rx * x_range;
-    o->y      = margin + ry * y_range;
-    o->radius = radius;
+// Spawn interval (seconds), default if unset / invalid
+static double spawn_interval(double interval)
+{
+    return (interval > 0.0) ? interval : SIM_DEFAULT_OBSTACLE_SPAWN_INTERVAL;
+}
+
+// Place a scenario entity (position / radius given by the file)
+static void place_obstacle(Obstacle *o, const SimScenarioEntity *e)
+{
+    o->x      = e->x;
+    o->y      = e->y;
+    o->vx     = 0.0;
+    o->vy     = 0.0;
+    o->radius = e->radius;
     o->active = 1;
 }
 
-int main(int argc, char *argv[])
+// Absolute CLOCK_MONOTONIC time start + t seconds (scheduled spawns)
+static struct timespec schedule_deadline(const struct timespec *start, double t)
+{
+    struct timespec ts = *start;
+    time_t whole = (time_t)t;
+
+    ts.tv_sec  += whole;
+    ts.tv_nsec += (long)((t - (double)whole) * 1e9);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec  += 1;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+SIM_ROLE_MAIN(obstacles)
 {
     sim_log_init("obstacles");
-    signal(SIGINT, handle_sigint);
+    SIM_ROLE_SIGNAL(SIGINT, handle_sigint);
 
     if (argc < 2) {
         sim_log_info("obstacles: usage error: expected fd_obstacles_out argument");
@@ -87,71 +148,142 @@ int main(int argc, char *argv[])
                  max_obstacles,
                  params->obstacle_spawn_interval);
 
+    // CPU set / SCHED_FIFO / mlockall from [realtime]
+    sim_rt_apply(SIM_ROLE_OBSTACLES, "obstacles");
+
     // If we have no capacity at all, just exit quietly
     if (max_obstacles == 0) {
         sim_log_info("obstacles: max_obstacles <= 0, nothing to do");
-        close(fd_obs_out);
+        sim_ipc_close(fd_obs_out);
         sim_log_info("obstacles: exiting (no capacity)");
         return EXIT_SUCCESS;
     }
 
     Obstacle obstacles[SIM_MAX_OBSTACLES];
 
-    // Seed RNG with time and PID to avoid identical maps across runs
-    srand((unsigned)time(NULL) ^ (unsigned)getpid());
+    // Optional scenario: fixed layout, spawn schedule and seed
+    SimScenario scenario;
+    int         use_scenario = 0;
+    if (params->scenario_path[0] != '\0') {
+        if (sim_scenario_load(params->scenario_path, &scenario) == 0) {
+            use_scenario = 1;
+        } else {
+            sim_log_info("obstacles: could not load scenario '%s', using random layout",
+                         params->scenario_path);
+        }
+    }
+    const SimScenarioEntity *schedule     = use_scenario ? scenario.obstacles : NULL;
+    int                      num_schedule = use_scenario ? scenario.num_obstacles : 0;
+    int                      next_event   = sim_scenario_initial_count(schedule, num_schedule);
+    int                      num_initial  = next_event;
+
+    // Own stream of the run seed (scenario seed wins over rng_seed)
+    uint64_t seed = params->rng_seed;
+    if (use_scenario && scenario.has_seed) {
+        seed = scenario.seed;
+    } else if (seed == 0) {
+        seed = sim_rng_entropy();  // no master block: not reproducible
+    }
+    SimRng rng;
+    sim_rng_seed(&rng, seed, SIM_RNG_STREAM_OBSTACLES);
 
     // Simple static obstacles: random positions in the world, fixed radius
     const double radius = 1.0;
 
     // Initialize the active obstacles
-    for (int i = 0; i < active_count; ++i) {
-        generate_random_obstacle(&obstacles[i], params, radius);
+    if (num_initial > 0) {
+        // Scenario layout replaces the random initial set
+        if (num_initial > max_obstacles) {
+            sim_log_info("obstacles: scenario has %d initial obstacles, cap is %d",
+                         num_initial, max_obstacles);
+            num_initial = max_obstacles;
+        }
+        active_count = num_initial;
+        for (int i = 0; i < active_count; ++i) {
+            place_obstacle(&obstacles[i], &schedule[i]);
+        }
+    } else {
+        generate_random_obstacles(obstacles, active_count, params, radius, &rng);
     }
 
     // Mark unused slots as inactive
     for (int i = active_count; i < max_obstacles; ++i) {
         obstacles[i].x      = 0.0;
         obstacles[i].y      = 0.0;
+        obstacles[i].vx     = 0.0;
+        obstacles[i].vy     = 0.0;
         obstacles[i].radius = 0.0;
         obstacles[i].active = 0;
     }
     // Anything above max_obstacles in the array is ignored
 
-    // Helper for how many bytes we send each time 
-    ssize_t expected = (ssize_t)(max_obstacles * (int)sizeof(Obstacle));
+    // Trajectories: every set goes out with the positions of its send
+    // time, so a later spawn does not move the others back
+    static SimKinematics kin;
+    sim_physics_kin_init(&kin, params, max_obstacles);
+    sim_physics_kin_set_obstacles(&kin, obstacles, max_obstacles, now_s());
+
+    // Active slots only, as one framed message (sim_proto.h)
+    static SimMsgWriter out;
+    sim_proto_writer_init(&out);
 
     // Send initial snapshot to bb_server
-    ssize_t w = write_full(fd_obs_out, obstacles,
-                           (size_t)(max_obstacles * (int)sizeof(Obstacle)));
-    if (w != expected) {
-        sim_log_info("obstacles: write_full(fd_obs_out) failed, returned %zd (expected %zd)",
-                     w, expected);
-        close(fd_obs_out);
+    sim_proto_put_obstacles(&out, obstacles, max_obstacles);
+    if (sim_proto_flush(fd_obs_out, &out) != 0) {
+        sim_log_info("obstacles: sim_proto_flush(fd_obs_out) failed");
+        sim_ipc_close(fd_obs_out);
         sim_log_info("obstacles: exiting (initial write failed)");
         return EXIT_FAILURE;
     }
     sim_log_info("obstacles: sent initial %d/%d obstacles to bb_server",
                  active_count, max_obstacles);
 
-    // Precompute sleep interval as timespec
-    double interval = params->obstacle_spawn_interval;
-    if (interval <= 0.0) {
-        interval = SIM_DEFAULT_OBSTACLE_SPAWN_INTERVAL; 
-    }
+    // Scheduled spawns are timed from here
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
-    struct timespec sleep_ts;
-    sleep_ts.tv_sec  = (time_t)interval;
-    sleep_ts.tv_nsec = (long)((interval - (double)sleep_ts.tv_sec) * 1e9);
-    if (sleep_ts.tv_nsec < 0) {
-        sleep_ts.tv_nsec = 0; 
-    }
+    // Seconds between random spawns (recomputed on config reload)
+    double interval = spawn_interval(params->obstacle_spawn_interval);
+
+    // Random spawns on an absolute grid: time spent generating and
+    // sending does not push later spawns back
+    SimPeriodic spawn;
+    int         spawn_armed = 0;
 
     int oldest_index = 0; 
 
     // Main spawn/update loop: keep sending updated obstacle sets
     while (running) {
-        // Sleep between spawns; SIGINT will just wake us up early
-        nanosleep(&sleep_ts, NULL);
+        // Scheduled spawn at its own time, then periodic random spawns
+        // (sleeps in short slices so master keeps seeing heartbeats)
+        int scheduled = (next_event < num_schedule);
+        struct timespec deadline;
+        if (scheduled) {
+            deadline = schedule_deadline(&start, schedule[next_event].t);
+        } else {
+            if (!spawn_armed) {
+                // Random spawns start one interval after the schedule ends
+                sim_periodic_init(&spawn, interval);
+                spawn_armed = 1;
+            }
+            deadline = sim_periodic_deadline(&spawn);
+        }
+        if (sim_heartbeat_sleep_until(SIM_ROLE_OBSTACLES, &deadline) != 0) {
+            continue;  // EINTR: re-check running, sleep again
+        }
+        if (!scheduled) {
+            sim_periodic_poll(&spawn);
+        }
+
+        // Pick up a config edit published by master
+        if (sim_params_refresh()) {
+            interval = spawn_interval(params->obstacle_spawn_interval);
+            if (spawn_armed) {
+                sim_periodic_set_period(&spawn, interval);
+            }
+            sim_log_info("obstacles: params generation %lu, spawn interval %.2f s",
+                         sim_params_generation(), params->obstacle_spawn_interval);
+        }
 
         if (!running) {
             break; 
@@ -167,14 +299,24 @@ int main(int argc, char *argv[])
             oldest_index = (oldest_index + 1) % max_obstacles;
         }
 
-        generate_random_obstacle(&obstacles[idx], params, radius);
+        double t = now_s();
+        if (kin.moving > 0) {
+            sim_physics_kin_advance(&kin, t);
+            sim_physics_kin_get_obstacles(&kin, obstacles, max_obstacles);
+        }
+
+        if (scheduled) {
+            place_obstacle(&obstacles[idx], &schedule[next_event++]);
+        } else {
+            generate_random_obstacles(&obstacles[idx], 1, params, radius, &rng);
+        }
+        sim_physics_kin_set(&kin, idx, obstacles[idx].x, obstacles[idx].y,
+                            obstacles[idx].vx, obstacles[idx].vy, obstacles[idx].radius, t);
 
         // after we modify the array, send the whole cap (bb_server will look at .active)
-        w = write_full(fd_obs_out, obstacles,
-                       (size_t)(max_obstacles * (int)sizeof(Obstacle)));
-        if (w != expected) {
-            sim_log_info("obstacles: write_full(fd_obs_out) failed in loop, returned %zd (expected %zd)",
-                         w, expected);
+        sim_proto_put_obstacles(&out, obstacles, max_obstacles);
+        if (sim_proto_flush(fd_obs_out, &out) != 0) {
+            sim_log_info("obstacles: sim_proto_flush(fd_obs_out) failed in loop");
             break; 
         }
 
@@ -182,7 +324,10 @@ int main(int argc, char *argv[])
                      idx, active_count, max_obstacles);
     }
 
-    close(fd_obs_out);
+    if (use_scenario) {
+        sim_scenario_free(&scenario);
+    }
+    sim_ipc_close(fd_obs_out);
     sim_log_info("obstacles: exiting (signal or pipe error)");
     return EXIT_SUCCESS;
 }
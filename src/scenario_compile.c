@@ -0,0 +1,31 @@
+// Offline tool: convert a text scenario into the binary (mmap) form.
+//   ./scenario_compile <scenario.txt> <scenario.bin>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim_scenario.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <scenario.txt> <scenario.bin>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    SimScenario sc;
+    if (sim_scenario_load(argv[1], &sc) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    int rc = sim_scenario_write_binary(&sc, argv[2]);
+    if (rc == 0) {
+        printf("%s: %d obstacles, %d targets, seed %s%llu\n",
+               argv[2], sc.num_obstacles, sc.num_targets,
+               sc.has_seed ? "" : "(none) ",
+               (unsigned long long)sc.seed);
+    }
+
+    sim_scenario_free(&sc);
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
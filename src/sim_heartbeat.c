@@ -0,0 +1,193 @@
+// Shared heartbeat counters (see sim_heartbeat.h).
+
+#define _GNU_SOURCE   // memfd_create, ppoll
+
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sim_heartbeat.h"
+
+#define SIM_HEARTBEAT_MAGIC 0x54424D53u   // 'SMBT'
+
+typedef struct {
+    uint32_t         magic;
+    uint32_t         num_roles;
+    _Atomic uint64_t beat[SIM_ROLE_COUNT];
+} SimHeartbeatBlock;
+
+static SimHeartbeatBlock *g_hb = NULL;
+static int g_hb_tried = 0;
+
+int sim_heartbeat_create(void)
+{
+    int fd;
+#ifdef MFD_ALLOW_SEALING
+    // No MFD_CLOEXEC: children must inherit it across exec
+    fd = memfd_create("sim_heartbeat", 0);
+#else
+    char tmpl[] = "/tmp/sim_heartbeat_XXXXXX";
+    fd = mkstemp(tmpl);
+    if (fd >= 0) {
+        unlink(tmpl);
+    }
+#endif
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (ftruncate(fd, (off_t)sizeof(SimHeartbeatBlock)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    SimHeartbeatBlock *hb = mmap(NULL, sizeof(SimHeartbeatBlock),
+                                 PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (hb == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    memset(hb, 0, sizeof(*hb));
+    hb->magic     = SIM_HEARTBEAT_MAGIC;
+    hb->num_roles = SIM_ROLE_COUNT;
+
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", fd);
+    if (setenv(SIM_HEARTBEAT_FD_ENV, buf, 1) != 0) {
+        munmap(hb, sizeof(SimHeartbeatBlock));
+        close(fd);
+        return -1;
+    }
+
+    g_hb       = hb;
+    g_hb_tried = 1;
+    return fd;
+}
+
+// Map the block named by SIM_HEARTBEAT_FD once; NULL if there is none
+static SimHeartbeatBlock *sim_heartbeat_block(void)
+{
+    if (g_hb_tried) {
+        return g_hb;
+    }
+    g_hb_tried = 1;
+
+    const char *env = getenv(SIM_HEARTBEAT_FD_ENV);
+    if (env == NULL || env[0] == '\0') {
+        return NULL;
+    }
+
+    char *end = NULL;
+    long fd = strtol(env, &end, 10);
+    struct stat st;
+    if (end == env || *end != '\0' || fd < 0 ||
+        fstat((int)fd, &st) != 0 || st.st_size < (off_t)sizeof(SimHeartbeatBlock)) {
+        return NULL;
+    }
+
+    SimHeartbeatBlock *hb = mmap(NULL, sizeof(SimHeartbeatBlock),
+                                 PROT_READ | PROT_WRITE, MAP_SHARED, (int)fd, 0);
+    if (hb == MAP_FAILED) {
+        return NULL;
+    }
+    if (hb->magic != SIM_HEARTBEAT_MAGIC || hb->num_roles != SIM_ROLE_COUNT) {
+        munmap(hb, sizeof(SimHeartbeatBlock));
+        return NULL;
+    }
+
+    g_hb = hb;
+    return g_hb;
+}
+
+uint64_t sim_heartbeat_read(int role)
+{
+    if (g_hb == NULL || role < 0 || role >= SIM_ROLE_COUNT) {
+        return 0;
+    }
+    return atomic_load_explicit(&g_hb->beat[role], memory_order_relaxed);
+}
+
+void sim_heartbeat_beat(int role)
+{
+    SimHeartbeatBlock *hb = sim_heartbeat_block();
+    if (hb == NULL || role < 0 || role >= SIM_ROLE_COUNT) {
+        return;
+    }
+    atomic_fetch_add_explicit(&hb->beat[role], 1, memory_order_relaxed);
+}
+
+int sim_heartbeat_sleep_until(int role, const struct timespec *deadline)
+{
+    const long period_ns = (long)(SIM_HEARTBEAT_PERIOD_S * 1e9);
+
+    for (;;) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        sim_heartbeat_beat(role);
+        if (now.tv_sec > deadline->tv_sec ||
+            (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec)) {
+            return 0;
+        }
+
+        // Wake at the deadline or one period from now, whichever is first
+        struct timespec wake = now;
+        wake.tv_nsec += period_ns;
+        if (wake.tv_nsec >= 1000000000L) {
+            wake.tv_sec  += 1;
+            wake.tv_nsec -= 1000000000L;
+        }
+        if (wake.tv_sec > deadline->tv_sec ||
+            (wake.tv_sec == deadline->tv_sec && wake.tv_nsec > deadline->tv_nsec)) {
+            wake = *deadline;
+        }
+
+        if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) != 0) {
+            return -1;
+        }
+    }
+}
+
+int sim_heartbeat_wait_fd(int role, int fd, const struct timespec *deadline)
+{
+    const long period_ns = (long)(SIM_HEARTBEAT_PERIOD_S * 1e9);
+
+    for (;;) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        sim_heartbeat_beat(role);
+        if (now.tv_sec > deadline->tv_sec ||
+            (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec)) {
+            return 0;
+        }
+
+        // ppoll takes a relative timeout: what is left, at most one period
+        struct timespec left;
+        left.tv_sec  = deadline->tv_sec  - now.tv_sec;
+        left.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+        if (left.tv_nsec < 0) {
+            left.tv_sec  -= 1;
+            left.tv_nsec += 1000000000L;
+        }
+        if (left.tv_sec > 0 || left.tv_nsec > period_ns) {
+            left.tv_sec  = 0;
+            left.tv_nsec = period_ns;
+        }
+
+        struct pollfd p = { fd, POLLIN, 0 };
+        int r = ppoll(&p, 1, &left, NULL);
+        if (r < 0) {
+            return -1;
+        }
+        if (r > 0) {
+            return 1;
+        }
+    }
+}
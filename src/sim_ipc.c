@@ -1,11 +1,220 @@
+#define _GNU_SOURCE   // accept4
+
 #include "sim_ipc.h"
 
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "sim_log.h"
+
+// Highest fd number that can name a channel end
+#define SIM_IPC_MAX_FD 1024
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;         // signalled on data, space and close
+    size_t          head;         // next byte to read
+    size_t          len;          // bytes in the ring
+    int             reader_open;
+    int             writer_open;
+    int             read_nonblock;   // sim_ipc_set_nonblock() on an end
+    int             write_nonblock;
+    int             read_fd;
+    int             write_fd;
+    int             evfd;         // readable <=> len > 0 || !writer_open
+    int             ev_set;       // evfd currently holds a count
+    unsigned char   buf[SIM_IPC_CHANNEL_SIZE];
+} SimIpcChannel;
+
+// fd -> channel; written once per end before the fd is handed out
+static _Atomic(SimIpcChannel *) g_channels[SIM_IPC_MAX_FD];
+
+static SimIpcChannel *sim_ipc_lookup(int fd)
+{
+    if (fd < 0 || fd >= SIM_IPC_MAX_FD) {
+        return NULL;
+    }
+    return atomic_load_explicit(&g_channels[fd], memory_order_acquire);
+}
+
+// Called with ch->lock held: make evfd readiness match the ring state
+static void sim_ipc_sync_event(SimIpcChannel *ch)
+{
+    int want = (ch->len > 0 || !ch->writer_open);
+    uint64_t v = 1;
+
+    if (want && !ch->ev_set) {
+        if (write(ch->evfd, &v, sizeof(v)) == (ssize_t)sizeof(v)) {
+            ch->ev_set = 1;
+        }
+    } else if (!want && ch->ev_set) {
+        if (read(ch->evfd, &v, sizeof(v)) == (ssize_t)sizeof(v)) {
+            ch->ev_set = 0;
+        }
+    }
+}
+
+static ssize_t sim_ipc_channel_read(SimIpcChannel *ch, void *buf, size_t n)
+{
+    size_t total = 0;
+    unsigned char *p = (unsigned char *)buf;
+
+    pthread_mutex_lock(&ch->lock);
+    while (total < n) {
+        while (ch->len == 0 && ch->writer_open) {
+            pthread_cond_wait(&ch->cond, &ch->lock);
+        }
+        if (ch->len == 0) {
+            break;  // writer closed, ring drained: EOF
+        }
+
+        size_t chunk = n - total;
+        if (chunk > ch->len) {
+            chunk = ch->len;
+        }
+        if (chunk > SIM_IPC_CHANNEL_SIZE - ch->head) {
+            chunk = SIM_IPC_CHANNEL_SIZE - ch->head;
+        }
+        memcpy(p + total, ch->buf + ch->head, chunk);
+        ch->head = (ch->head + chunk) % SIM_IPC_CHANNEL_SIZE;
+        ch->len -= chunk;
+        total   += chunk;
+        pthread_cond_broadcast(&ch->cond);
+    }
+    sim_ipc_sync_event(ch);
+    pthread_mutex_unlock(&ch->lock);
+
+    return (ssize_t)total;
+}
+
+// Single read(): wait for some data (or EOF), take what fits in iov
+static ssize_t sim_ipc_channel_readv(SimIpcChannel *ch, const struct iovec *iov, int n)
+{
+    size_t total = 0;
+
+    pthread_mutex_lock(&ch->lock);
+    while (ch->len == 0 && ch->writer_open) {
+        if (ch->read_nonblock) {
+            pthread_mutex_unlock(&ch->lock);
+            errno = EAGAIN;
+            return -1;
+        }
+        pthread_cond_wait(&ch->cond, &ch->lock);
+    }
+    for (int i = 0; i < n && ch->len > 0; ++i) {
+        unsigned char *p    = iov[i].iov_base;
+        size_t         want = iov[i].iov_len;
+        size_t         got  = 0;
+
+        while (got < want && ch->len > 0) {
+            size_t chunk = want - got;
+            if (chunk > ch->len) {
+                chunk = ch->len;
+            }
+            if (chunk > SIM_IPC_CHANNEL_SIZE - ch->head) {
+                chunk = SIM_IPC_CHANNEL_SIZE - ch->head;
+            }
+            memcpy(p + got, ch->buf + ch->head, chunk);
+            ch->head = (ch->head + chunk) % SIM_IPC_CHANNEL_SIZE;
+            ch->len -= chunk;
+            got     += chunk;
+        }
+        total += got;
+    }
+    pthread_cond_broadcast(&ch->cond);
+    sim_ipc_sync_event(ch);
+    pthread_mutex_unlock(&ch->lock);
+
+    return (ssize_t)total;
+}
+
+// Called with ch->lock held; -1 / EPIPE once the reader is gone.
+// Non-blocking end: stops when the ring is full (-1 / EAGAIN if nothing fit).
+static ssize_t sim_ipc_channel_put(SimIpcChannel *ch, const void *buf, size_t n)
+{
+    size_t total = 0;
+    const unsigned char *p = (const unsigned char *)buf;
+
+    while (total < n) {
+        while (ch->len == SIM_IPC_CHANNEL_SIZE && ch->reader_open) {
+            if (ch->write_nonblock) {
+                if (total > 0) {
+                    return (ssize_t)total;
+                }
+                errno = EAGAIN;
+                return -1;
+            }
+            pthread_cond_wait(&ch->cond, &ch->lock);
+        }
+        if (!ch->reader_open) {
+            errno = EPIPE;
+            return -1;
+        }
+
+        size_t tail  = (ch->head + ch->len) % SIM_IPC_CHANNEL_SIZE;
+        size_t chunk = n - total;
+        if (chunk > SIM_IPC_CHANNEL_SIZE - ch->len) {
+            chunk = SIM_IPC_CHANNEL_SIZE - ch->len;
+        }
+        if (chunk > SIM_IPC_CHANNEL_SIZE - tail) {
+            chunk = SIM_IPC_CHANNEL_SIZE - tail;
+        }
+        memcpy(ch->buf + tail, p + total, chunk);
+        ch->len += chunk;
+        total   += chunk;
+        sim_ipc_sync_event(ch);
+        pthread_cond_broadcast(&ch->cond);
+    }
+
+    return (ssize_t)total;
+}
+
+static ssize_t sim_ipc_channel_write(SimIpcChannel *ch, const void *buf, size_t n)
+{
+    pthread_mutex_lock(&ch->lock);
+    ssize_t w = sim_ipc_channel_put(ch, buf, n);
+    pthread_mutex_unlock(&ch->lock);
+    return w;
+}
+
+// All iovecs under one lock, so the reader wakes once for the batch
+static ssize_t sim_ipc_channel_writev(SimIpcChannel *ch, const struct iovec *iov, int n)
+{
+    ssize_t total = 0;
+
+    pthread_mutex_lock(&ch->lock);
+    for (int i = 0; i < n; ++i) {
+        ssize_t w = sim_ipc_channel_put(ch, iov[i].iov_base, iov[i].iov_len);
+        if (w < 0) {
+            total = (total > 0 && errno == EAGAIN) ? total : -1;
+            break;
+        }
+        total += w;
+        if ((size_t)w < iov[i].iov_len) {
+            break;   // non-blocking end, ring full
+        }
+    }
+    pthread_mutex_unlock(&ch->lock);
+    return total;
+}
 
 // Phase_Migration: helper to read exactly n bytes from an fd
 ssize_t read_full(int fd, void *buf, size_t n)
 {
+    SimIpcChannel *ch = sim_ipc_lookup(fd);
+    if (ch != NULL) {
+        return sim_ipc_channel_read(ch, buf, n);
+    }
+
     size_t total = 0;
     char *p = (char *)buf;
 
@@ -29,6 +238,11 @@ ssize_t read_full(int fd, void *buf, size_t n)
 // Phase_Migration: helper to write exactly n bytes to an fd
 ssize_t write_full(int fd, const void *buf, size_t n)
 {
+    SimIpcChannel *ch = sim_ipc_lookup(fd);
+    if (ch != NULL) {
+        return sim_ipc_channel_write(ch, buf, n);
+    }
+
     size_t total = 0;
     const char *p = (const char *)buf;
 
@@ -48,3 +262,543 @@ ssize_t write_full(int fd, const void *buf, size_t n)
 
     return (total == n) ? (ssize_t)total : -1;
 }
+
+int sim_ipc_set_nonblock(int fd)
+{
+    SimIpcChannel *ch = sim_ipc_lookup(fd);
+    if (ch != NULL) {
+        pthread_mutex_lock(&ch->lock);
+        if (fd == ch->read_fd) {
+            ch->read_nonblock = 1;
+        } else {
+            ch->write_nonblock = 1;
+        }
+        pthread_mutex_unlock(&ch->lock);
+        return 0;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+ssize_t sim_ipc_writev_full(int fd, const struct iovec *iov, int n)
+{
+    SimIpcChannel *ch = sim_ipc_lookup(fd);
+    if (ch != NULL) {
+        return sim_ipc_channel_writev(ch, iov, n);
+    }
+
+    struct iovec left[SIM_IPC_BATCH_MAX];
+    size_t       want = 0;
+    if (n > SIM_IPC_BATCH_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (int i = 0; i < n; ++i) {
+        left[i] = iov[i];
+        want   += iov[i].iov_len;
+    }
+
+    // Short writes: drop what went out and resume mid-iovec
+    struct iovec *cur   = left;
+    int           count = n;
+    size_t        total = 0;
+    while (total < want) {
+        ssize_t w = writev(fd, cur, count);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        total += (size_t)w;
+        while (count > 0 && (size_t)w >= cur->iov_len) {
+            w -= (ssize_t)cur->iov_len;
+            cur++;
+            count--;
+        }
+        if (count > 0) {
+            cur->iov_base = (char *)cur->iov_base + w;
+            cur->iov_len -= (size_t)w;
+        }
+    }
+    return (ssize_t)total;
+}
+
+ssize_t sim_ipc_readv(int fd, const struct iovec *iov, int n)
+{
+    SimIpcChannel *ch = sim_ipc_lookup(fd);
+    if (ch != NULL) {
+        return sim_ipc_channel_readv(ch, iov, n);
+    }
+
+    ssize_t r;
+    do {
+        r = readv(fd, iov, n);
+    } while (r < 0 && errno == EINTR);
+    return r;
+}
+
+ssize_t sim_ipc_rx_fill(int fd, SimIpcRx *rx)
+{
+    struct iovec iov = { rx->buf + rx->len, sizeof(rx->buf) - rx->len };
+    if (iov.iov_len == 0) {
+        errno = ENOBUFS;   // consumer did not take the messages out
+        return -1;
+    }
+
+    ssize_t r = sim_ipc_readv(fd, &iov, 1);
+    if (r > 0) {
+        rx->len += (size_t)r;
+    }
+    return r;
+}
+
+void sim_ipc_rx_consume(SimIpcRx *rx, size_t n)
+{
+    if (n >= rx->len) {
+        rx->len = 0;
+        return;
+    }
+    memmove(rx->buf, rx->buf + n, rx->len - n);
+    rx->len -= n;
+}
+
+void sim_ipc_tx_init(SimIpcTx *q)
+{
+    q->len         = 0;
+    q->sent        = 0;
+    q->count       = 0;
+    q->dropped     = 0;
+    q->overwritten = 0;
+}
+
+// Remove message i (not one that has started going out) from the queue
+static void sim_ipc_tx_remove(SimIpcTx *q, int i)
+{
+    uint32_t off = q->msg[i].off;
+    uint32_t len = q->msg[i].len;
+
+    memmove(q->buf + off, q->buf + off + len, q->len - off - len);
+    q->len -= len;
+    for (int k = i; k + 1 < q->count; ++k) {
+        q->msg[k]      = q->msg[k + 1];
+        q->msg[k].off -= len;
+    }
+    q->count--;
+}
+
+int sim_ipc_tx_push(SimIpcTx *q, const void *buf, size_t n, int key,
+                    SimIpcTxPolicy policy)
+{
+    if (n == 0) {
+        return 0;
+    }
+    if (n > SIM_IPC_TX_SIZE) {
+        q->dropped++;
+        return -1;
+    }
+
+    // msg[0] may be half written: it has to finish as it is
+    int first = (q->sent > 0) ? 1 : 0;
+
+    if (policy == SIM_IPC_TX_OVERWRITE) {
+        for (int i = first; i < q->count; ++i) {
+            if (q->msg[i].key == key) {
+                sim_ipc_tx_remove(q, i);
+                q->overwritten++;
+                break;
+            }
+        }
+    }
+
+    while (q->len + n > SIM_IPC_TX_SIZE || q->count == SIM_IPC_TX_MAX_MSGS) {
+        if (policy == SIM_IPC_TX_DROP_NEWEST || q->count <= first) {
+            q->dropped++;
+            return -1;
+        }
+        sim_ipc_tx_remove(q, first);
+        q->dropped++;
+    }
+
+    memcpy(q->buf + q->len, buf, n);
+    q->msg[q->count].off = (uint32_t)q->len;
+    q->msg[q->count].len = (uint32_t)n;
+    q->msg[q->count].key = key;
+    q->count++;
+    q->len += n;
+    return 0;
+}
+
+// One write of up to n bytes that never waits on a non-blocking fd
+static ssize_t sim_ipc_write_some(int fd, const void *buf, size_t n)
+{
+    SimIpcChannel *ch = sim_ipc_lookup(fd);
+    if (ch != NULL) {
+        return sim_ipc_channel_write(ch, buf, n);
+    }
+
+    ssize_t w;
+    do {
+        w = write(fd, buf, n);
+    } while (w < 0 && errno == EINTR);
+    return w;
+}
+
+ssize_t sim_ipc_tx_flush(int fd, SimIpcTx *q)
+{
+    size_t total = 0;
+
+    while (q->sent < q->len) {
+        ssize_t w = sim_ipc_write_some(fd, q->buf + q->sent, q->len - q->sent);
+        if (w < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        if (w == 0) {
+            break;
+        }
+        q->sent += (size_t)w;
+        total   += (size_t)w;
+    }
+
+    // Forget the messages that are fully out, keep the rest at the front
+    int    done  = 0;
+    size_t bytes = 0;
+    while (done < q->count && bytes + q->msg[done].len <= q->sent) {
+        bytes += q->msg[done].len;
+        done++;
+    }
+    if (done > 0) {
+        memmove(q->buf, q->buf + bytes, q->len - bytes);
+        q->len  -= bytes;
+        q->sent -= bytes;
+        for (int k = 0; k + done < q->count; ++k) {
+            q->msg[k]      = q->msg[k + done];
+            q->msg[k].off -= (uint32_t)bytes;
+        }
+        q->count -= done;
+    }
+    return (ssize_t)total;
+}
+
+size_t sim_ipc_tx_pending(const SimIpcTx *q)
+{
+    return q->len - q->sent;
+}
+
+void sim_ipc_tx_clear(SimIpcTx *q)
+{
+    // A half-written msg[0] must still finish or the stream desyncs
+    int keep = (q->sent > 0) ? 1 : 0;
+    while (q->count > keep) {
+        sim_ipc_tx_remove(q, keep);
+        q->dropped++;
+    }
+}
+
+int sim_ipc_channel(int fds[2])
+{
+    SimIpcChannel *ch = calloc(1, sizeof(*ch));
+    if (ch == NULL) {
+        return -1;
+    }
+
+    ch->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ch->evfd < 0) {
+        free(ch);
+        return -1;
+    }
+
+    // Each end gets its own fd number so it can be looked up and closed
+    int rd = dup(ch->evfd);
+    int wr = (rd >= 0) ? dup(ch->evfd) : -1;
+    if (rd < 0 || wr < 0 || rd >= SIM_IPC_MAX_FD || wr >= SIM_IPC_MAX_FD) {
+        if (rd >= 0) close(rd);
+        if (wr >= 0) close(wr);
+        close(ch->evfd);
+        free(ch);
+        errno = EMFILE;
+        return -1;
+    }
+
+    pthread_mutex_init(&ch->lock, NULL);
+    pthread_cond_init(&ch->cond, NULL);
+    ch->read_fd     = rd;
+    ch->write_fd    = wr;
+    ch->reader_open = 1;
+    ch->writer_open = 1;
+
+    atomic_store_explicit(&g_channels[rd], ch, memory_order_release);
+    atomic_store_explicit(&g_channels[wr], ch, memory_order_release);
+
+    fds[0] = rd;
+    fds[1] = wr;
+    return 0;
+}
+
+int sim_ipc_close(int fd)
+{
+    SimIpcChannel *ch = sim_ipc_lookup(fd);
+    if (ch == NULL) {
+        return close(fd);
+    }
+
+    atomic_store_explicit(&g_channels[fd], NULL, memory_order_release);
+
+    pthread_mutex_lock(&ch->lock);
+    if (fd == ch->read_fd) {
+        ch->reader_open = 0;
+    } else {
+        ch->writer_open = 0;
+    }
+    sim_ipc_sync_event(ch);
+    pthread_cond_broadcast(&ch->cond);
+    int last = !ch->reader_open && !ch->writer_open;
+    pthread_mutex_unlock(&ch->lock);
+
+    close(fd);
+
+    if (last) {
+        close(ch->evfd);
+        pthread_cond_destroy(&ch->cond);
+        pthread_mutex_destroy(&ch->lock);
+        free(ch);
+    }
+    return 0;
+}
+
+static int sim_ipc_sockaddr(struct sockaddr_un *addr, const char *path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+int sim_ipc_listen(const char *path, int backlog)
+{
+    struct sockaddr_un addr;
+    if (sim_ipc_sockaddr(&addr, path) != 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Left behind by a run that did not exit cleanly
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, backlog) != 0) {
+        int e = errno;
+        close(fd);
+        errno = e;
+        return -1;
+    }
+    return fd;
+}
+
+int sim_ipc_accept(int listen_fd)
+{
+    int fd;
+    do {
+        fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    return fd;
+}
+
+int sim_ipc_connect(const char *path)
+{
+    struct sockaddr_un addr;
+    if (sim_ipc_sockaddr(&addr, path) != 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int e = errno;
+        close(fd);
+        errno = e;
+        return -1;
+    }
+    return fd;
+}
+
+ssize_t sim_ipc_send_packet(int fd, const void *buf, size_t n)
+{
+    ssize_t w;
+    do {
+        w = send(fd, buf, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (w < 0 && errno == EINTR);
+    return w;
+}
+
+int sim_ipc_recv_batch(int fd, const struct iovec *rec, size_t *lens, int n, int wait)
+{
+    struct mmsghdr msgs[SIM_IPC_BATCH_MAX];
+    if (n > SIM_IPC_BATCH_MAX) {
+        n = SIM_IPC_BATCH_MAX;
+    }
+    memset(msgs, 0, (size_t)n * sizeof(msgs[0]));
+    for (int i = 0; i < n; ++i) {
+        msgs[i].msg_hdr.msg_iov    = (struct iovec *)&rec[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Block for the first record only, then take whatever else is queued.
+    // EINTR is returned to the caller (shutdown requests).
+    int got = recvmmsg(fd, msgs, (unsigned)n, wait ? MSG_WAITFORONE : MSG_DONTWAIT, NULL);
+
+    for (int i = 0; i < got; ++i) {
+        lens[i] = msgs[i].msg_len;
+    }
+    return got;
+}
+
+int sim_ipc_fanout_open(SimIpcFanout *f, const char *path, int max)
+{
+    memset(f, 0, sizeof(*f));
+    f->listen_fd = -1;
+    for (int i = 0; i < SIM_IPC_MAX_OBSERVERS; ++i) {
+        f->fd[i] = -1;
+    }
+    if (path == NULL || path[0] == '\0' || max <= 0) {
+        return 0;  // disabled
+    }
+    if (strlen(path) >= sizeof(f->path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    f->max = (max > SIM_IPC_MAX_OBSERVERS) ? SIM_IPC_MAX_OBSERVERS : max;
+    f->listen_fd = sim_ipc_listen(path, f->max);
+    if (f->listen_fd < 0) {
+        return -1;
+    }
+    strcpy(f->path, path);
+    return 0;
+}
+
+void sim_ipc_fanout_fdset(const SimIpcFanout *f, fd_set *set, int *maxfd)
+{
+    if (f->listen_fd < 0) {
+        return;
+    }
+    FD_SET(f->listen_fd, set);
+    if (f->listen_fd > *maxfd) {
+        *maxfd = f->listen_fd;
+    }
+    for (int i = 0; i < f->max; ++i) {
+        if (f->fd[i] >= 0) {
+            FD_SET(f->fd[i], set);
+            if (f->fd[i] > *maxfd) {
+                *maxfd = f->fd[i];
+            }
+        }
+    }
+}
+
+static void sim_ipc_fanout_drop(SimIpcFanout *f, int i, const char *why)
+{
+    sim_log_info("ipc: observer %d detached (%s), sent=%lu dropped=%lu",
+                 i, why, f->sent[i], f->dropped[i]);
+    close(f->fd[i]);
+    f->fd[i] = -1;
+}
+
+void sim_ipc_fanout_poll(SimIpcFanout *f, const fd_set *set)
+{
+    if (f->listen_fd < 0) {
+        return;
+    }
+
+    // Observers only listen: readable means EOF (or stray data to discard)
+    for (int i = 0; i < f->max; ++i) {
+        if (f->fd[i] >= 0 && FD_ISSET(f->fd[i], set)) {
+            char    junk[256];
+            ssize_t r = recv(f->fd[i], junk, sizeof(junk), MSG_DONTWAIT);
+            if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR)) {
+                sim_ipc_fanout_drop(f, i, r == 0 ? "hung up" : strerror(errno));
+            }
+        }
+    }
+
+    if (!FD_ISSET(f->listen_fd, set)) {
+        return;
+    }
+
+    int fd;
+    while ((fd = sim_ipc_accept(f->listen_fd)) >= 0) {
+        int slot = -1;
+        for (int i = 0; i < f->max && slot < 0; ++i) {
+            if (f->fd[i] < 0) {
+                slot = i;
+            }
+        }
+        if (slot < 0) {
+            sim_log_info("ipc: %s: %d observers already attached, refusing one",
+                         f->path, f->max);
+            close(fd);
+            continue;
+        }
+        f->fd[slot]      = fd;
+        f->sent[slot]    = 0;
+        f->dropped[slot] = 0;
+        f->attached++;
+        sim_log_info("ipc: observer %d attached to %s", slot, f->path);
+    }
+}
+
+int sim_ipc_fanout_count(const SimIpcFanout *f)
+{
+    int n = 0;
+    for (int i = 0; i < f->max; ++i) {
+        n += (f->fd[i] >= 0);
+    }
+    return n;
+}
+
+void sim_ipc_fanout_send(SimIpcFanout *f, const void *buf, size_t n)
+{
+    for (int i = 0; i < f->max; ++i) {
+        if (f->fd[i] < 0) {
+            continue;
+        }
+        if (sim_ipc_send_packet(f->fd[i], buf, n) == (ssize_t)n) {
+            f->sent[i]++;
+        } else if (errno == EAGAIN || errno == ENOBUFS) {
+            f->dropped[i]++;
+        } else {
+            sim_ipc_fanout_drop(f, i, strerror(errno));
+        }
+    }
+}
+
+void sim_ipc_fanout_close(SimIpcFanout *f)
+{
+    for (int i = 0; i < f->max; ++i) {
+        if (f->fd[i] >= 0) {
+            sim_ipc_fanout_drop(f, i, "shutdown");
+        }
+    }
+    if (f->listen_fd >= 0) {
+        close(f->listen_fd);
+        unlink(f->path);
+        f->listen_fd = -1;
+    }
+}
@@ -4,10 +4,18 @@
 #include <stdarg.h>
 #include <time.h>
 #include <string.h>
+#include <pthread.h>
 
 static FILE *log_fp = NULL;
 static int   log_owns_fp = 0;  // 1 if we opened a real file, 0 if using stderr
 
+// Single-process build: every role thread calls init/close, the first
+// init opens the file and the last close releases it
+static int             log_refs = 0;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void log_open(const char *process_name);
+
 // Internal helper: get ISO-like timestamp "YYYY-MM-DD HH:MM:SS"
 static void log_get_timestamp(char *buf, size_t buf_size)
 {
@@ -35,11 +43,15 @@ static void log_get_timestamp(char *buf, size_t buf_size)
 
 void sim_log_init(const char *process_name)
 {
-    if (log_fp) {
-        // Already initialized
-        return;
+    pthread_mutex_lock(&log_lock);
+    if (log_refs++ == 0 && !log_fp) {
+        log_open(process_name);
     }
+    pthread_mutex_unlock(&log_lock);
+}
 
+static void log_open(const char *process_name)
+{
     if (!process_name || process_name[0] == '\0') {
         // Fallback to stderr if no name is provided
         log_fp = stderr;
@@ -87,6 +99,8 @@ void sim_log_info(const char *fmt, ...)
     char ts[32];
     log_get_timestamp(ts, sizeof(ts));
 
+    // One line at a time even when several threads share the file
+    flockfile(log_fp);
     fprintf(log_fp, "[%s] [INFO] ", (ts[0] ? ts : "??????????"));
 
     va_list ap;
@@ -96,13 +110,20 @@ void sim_log_info(const char *fmt, ...)
 
     fputc('\n', log_fp);
     fflush(log_fp);
+    funlockfile(log_fp);
 }
 
 void sim_log_close(void)
 {
+    pthread_mutex_lock(&log_lock);
+    if (log_refs > 0 && --log_refs > 0) {
+        pthread_mutex_unlock(&log_lock);
+        return;
+    }
     if (log_fp && log_owns_fp) {
         fclose(log_fp);
     }
     log_fp = NULL;
     log_owns_fp = 0;
+    pthread_mutex_unlock(&log_lock);
 }
@@ -0,0 +1,496 @@
+// Shared performance counters (see sim_metrics.h).
+
+#define _GNU_SOURCE   // memfd_create
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_metrics.h"
+
+#define SIM_METRICS_MAGIC 0x544D4D53u   // 'SMMT'
+
+// One row per role, alone on its cache line(s)
+typedef struct {
+    _Alignas(64) _Atomic uint64_t v[SIM_METRIC_COUNT];
+    _Atomic uint64_t hist[SIM_METRICS_HIST_BUCKETS];   // not cumulative
+} SimMetricsRow;
+
+typedef struct {
+    uint32_t         magic;
+    uint32_t         num_roles;
+    uint32_t         num_metrics;
+    uint32_t         num_chans;
+    SimMetricsRow    role[SIM_ROLE_COUNT];
+    _Alignas(64) _Atomic uint64_t chan[SIM_METRIC_CHAN_COUNT];
+    _Atomic uint64_t chan_bytes[SIM_METRIC_CHAN_COUNT];
+} SimMetricsBlock;
+
+static SimMetricsBlock *g_metrics = NULL;
+static int g_metrics_tried = 0;
+
+static const char *const g_role_names[SIM_ROLE_COUNT] = {
+    "bb_server", "input", "drone", "obstacles", "targets"
+};
+
+// Also the Prometheus label values: keep them [a-z_]
+static const char *const g_chan_names[SIM_METRIC_CHAN_COUNT] = {
+    "drone_state", "drone_cmd", "input_cmd", "obstacles", "targets",
+    "target_hits", "observers", "snapshots"
+};
+
+// Upper bounds of the histogram buckets; the last bucket is +Inf
+static const uint64_t g_hist_le_ns[SIM_METRICS_HIST_BUCKETS - 1] = {
+    50000, 100000, 250000, 500000, 1000000,
+    2500000, 5000000, 10000000, 25000000, 50000000
+};
+
+// Exposition of the per-role metrics (NULL name: not exported on its own)
+typedef struct {
+    const char *name;
+    const char *type;
+    const char *help;
+    double      scale;
+} SimMetricsInfo;
+
+static const SimMetricsInfo g_role_info[SIM_METRIC_COUNT] = {
+    [SIM_METRIC_TICKS]        = { "sim_ticks_total", "counter", "Loop passes.", 1.0 },
+    [SIM_METRIC_TICK_NS]      = { NULL, NULL, NULL, 1e-9 },   // histogram _sum
+    [SIM_METRIC_TICK_MAX_NS]  = { "sim_tick_max_seconds", "gauge",
+                                  "Longest loop pass of the last window.", 1e-9 },
+    [SIM_METRIC_FRAMES]       = { "sim_frames_total", "counter", "Frames drawn.", 1.0 },
+    [SIM_METRIC_DROPPED]      = { "sim_ipc_dropped_messages", "gauge",
+                                  "Messages lost to a full queue since the process started.", 1.0 },
+    [SIM_METRIC_COALESCED]    = { "sim_ipc_coalesced_messages", "gauge",
+                                  "Messages replaced by a newer one since the process started.", 1.0 },
+    [SIM_METRIC_QUEUE_BYTES]  = { "sim_ipc_queue_bytes", "gauge",
+                                  "Bytes waiting in the outbound queue.", 1.0 },
+    [SIM_METRIC_TARGET_HITS]  = { "sim_target_hits_total", "counter", "Targets hit.", 1.0 },
+    [SIM_METRIC_REPULSION_ON] = { "sim_repulsion_activations_total", "counter",
+                                  "Wall repulsion activations.", 1.0 },
+    [SIM_METRIC_COLLISIONS]   = { "sim_collisions_total", "counter", "Obstacle contacts.", 1.0 },
+    [SIM_METRIC_RESTARTS]     = { "sim_restarts_total", "counter",
+                                  "Restarts by the supervisor.", 1.0 },
+};
+
+int sim_metrics_create(void)
+{
+    int fd;
+#ifdef MFD_ALLOW_SEALING
+    // No MFD_CLOEXEC: children must inherit it across exec
+    fd = memfd_create("sim_metrics", 0);
+#else
+    char tmpl[] = "/tmp/sim_metrics_XXXXXX";
+    fd = mkstemp(tmpl);
+    if (fd >= 0) {
+        unlink(tmpl);
+    }
+#endif
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (ftruncate(fd, (off_t)sizeof(SimMetricsBlock)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    SimMetricsBlock *mb = mmap(NULL, sizeof(SimMetricsBlock),
+                               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mb == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    memset(mb, 0, sizeof(*mb));
+    mb->magic       = SIM_METRICS_MAGIC;
+    mb->num_roles   = SIM_ROLE_COUNT;
+    mb->num_metrics = SIM_METRIC_COUNT;
+    mb->num_chans   = SIM_METRIC_CHAN_COUNT;
+
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", fd);
+    if (setenv(SIM_METRICS_FD_ENV, buf, 1) != 0) {
+        munmap(mb, sizeof(SimMetricsBlock));
+        close(fd);
+        return -1;
+    }
+
+    g_metrics       = mb;
+    g_metrics_tried = 1;
+    return fd;
+}
+
+// Map the block named by SIM_METRICS_FD once; NULL if there is none
+static SimMetricsBlock *sim_metrics_block(void)
+{
+    if (g_metrics_tried) {
+        return g_metrics;
+    }
+    g_metrics_tried = 1;
+
+    const char *env = getenv(SIM_METRICS_FD_ENV);
+    if (env == NULL || env[0] == '\0') {
+        return NULL;
+    }
+
+    char *end = NULL;
+    long fd = strtol(env, &end, 10);
+    struct stat st;
+    if (end == env || *end != '\0' || fd < 0 ||
+        fstat((int)fd, &st) != 0 || st.st_size < (off_t)sizeof(SimMetricsBlock)) {
+        return NULL;
+    }
+
+    SimMetricsBlock *mb = mmap(NULL, sizeof(SimMetricsBlock),
+                               PROT_READ | PROT_WRITE, MAP_SHARED, (int)fd, 0);
+    if (mb == MAP_FAILED) {
+        return NULL;
+    }
+    if (mb->magic != SIM_METRICS_MAGIC || mb->num_roles != SIM_ROLE_COUNT ||
+        mb->num_metrics != SIM_METRIC_COUNT || mb->num_chans != SIM_METRIC_CHAN_COUNT) {
+        munmap(mb, sizeof(SimMetricsBlock));
+        return NULL;
+    }
+
+    g_metrics = mb;
+    return g_metrics;
+}
+
+uint64_t sim_metrics_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Single writer per counter: load + store, no locked read-modify-write
+void sim_metrics_add(int role, int metric, uint64_t n)
+{
+    SimMetricsBlock *mb = sim_metrics_block();
+    if (mb == NULL || role < 0 || role >= SIM_ROLE_COUNT ||
+        metric < 0 || metric >= SIM_METRIC_COUNT) {
+        return;
+    }
+    _Atomic uint64_t *c = &mb->role[role].v[metric];
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+void sim_metrics_set(int role, int metric, uint64_t v)
+{
+    SimMetricsBlock *mb = sim_metrics_block();
+    if (mb == NULL || role < 0 || role >= SIM_ROLE_COUNT ||
+        metric < 0 || metric >= SIM_METRIC_COUNT) {
+        return;
+    }
+    atomic_store_explicit(&mb->role[role].v[metric], v, memory_order_relaxed);
+}
+
+void sim_metrics_chan_add(int chan, uint64_t n)
+{
+    SimMetricsBlock *mb = sim_metrics_block();
+    if (mb == NULL || chan < 0 || chan >= SIM_METRIC_CHAN_COUNT) {
+        return;
+    }
+    _Atomic uint64_t *c = &mb->chan[chan];
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+void sim_metrics_chan_bytes(int chan, uint64_t n)
+{
+    SimMetricsBlock *mb = sim_metrics_block();
+    if (mb == NULL || chan < 0 || chan >= SIM_METRIC_CHAN_COUNT) {
+        return;
+    }
+    _Atomic uint64_t *c = &mb->chan_bytes[chan];
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+void sim_metrics_timer_init(SimMetricsTimer *t, int role)
+{
+    t->role          = role;
+    t->start_ns      = 0;
+    t->window_end_ns = sim_metrics_now_ns() + (uint64_t)(SIM_METRICS_WINDOW_S * 1e9);
+    t->window_max_ns = 0;
+}
+
+void sim_metrics_tick_begin(SimMetricsTimer *t)
+{
+    t->start_ns = sim_metrics_now_ns();
+}
+
+void sim_metrics_tick_end(SimMetricsTimer *t)
+{
+    uint64_t now = sim_metrics_now_ns();
+    uint64_t ns  = now - t->start_ns;
+
+    sim_metrics_add(t->role, SIM_METRIC_TICKS, 1);
+    sim_metrics_add(t->role, SIM_METRIC_TICK_NS, ns);
+
+    SimMetricsBlock *mb = sim_metrics_block();
+    if (mb != NULL && t->role >= 0 && t->role < SIM_ROLE_COUNT) {
+        int b = 0;
+        while (b < SIM_METRICS_HIST_BUCKETS - 1 && ns > g_hist_le_ns[b]) {
+            b++;
+        }
+        _Atomic uint64_t *c = &mb->role[t->role].hist[b];
+        atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+    }
+
+    if (ns > t->window_max_ns) {
+        t->window_max_ns = ns;
+    }
+
+    // Publish the window's maximum, then start a new window
+    if (now >= t->window_end_ns) {
+        sim_metrics_set(t->role, SIM_METRIC_TICK_MAX_NS, t->window_max_ns);
+        t->window_max_ns  = 0;
+        t->window_end_ns  = now + (uint64_t)(SIM_METRICS_WINDOW_S * 1e9);
+    }
+}
+
+uint64_t sim_metrics_get(int role, int metric)
+{
+    SimMetricsBlock *mb = sim_metrics_block();
+    if (mb == NULL || role < 0 || role >= SIM_ROLE_COUNT ||
+        metric < 0 || metric >= SIM_METRIC_COUNT) {
+        return 0;
+    }
+    return atomic_load_explicit(&mb->role[role].v[metric], memory_order_relaxed);
+}
+
+int sim_metrics_sample(SimMetricsSample *s)
+{
+    SimMetricsBlock *mb = sim_metrics_block();
+    if (mb == NULL) {
+        return -1;
+    }
+
+    s->t_ns = sim_metrics_now_ns();
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        for (int m = 0; m < SIM_METRIC_COUNT; ++m) {
+            s->role[r][m] = atomic_load_explicit(&mb->role[r].v[m], memory_order_relaxed);
+        }
+    }
+    for (int c = 0; c < SIM_METRIC_CHAN_COUNT; ++c) {
+        s->chan[c] = atomic_load_explicit(&mb->chan[c], memory_order_relaxed);
+    }
+    return 0;
+}
+
+void sim_metrics_rates(const SimMetricsSample *prev, const SimMetricsSample *cur,
+                       SimMetricsRates *out)
+{
+    double dt = (double)(cur->t_ns - prev->t_ns) * 1e-9;
+    if (dt <= 0.0) {
+        dt = 1.0;
+    }
+
+    // A restarted process starts its counters from where they were, but
+    // guard against going backwards anyway
+#define SIM_METRICS_DELTA(a, b) ((b) >= (a) ? (double)((b) - (a)) : 0.0)
+
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        double ticks = SIM_METRICS_DELTA(prev->role[r][SIM_METRIC_TICKS],
+                                         cur->role[r][SIM_METRIC_TICKS]);
+        double ns    = SIM_METRICS_DELTA(prev->role[r][SIM_METRIC_TICK_NS],
+                                         cur->role[r][SIM_METRIC_TICK_NS]);
+
+        out->ticks_per_s[r]  = ticks / dt;
+        out->tick_avg_ms[r]  = (ticks > 0.0) ? ns / ticks * 1e-6 : 0.0;
+        out->tick_max_ms[r]  = (double)cur->role[r][SIM_METRIC_TICK_MAX_NS] * 1e-6;
+        out->frames_per_s[r] = SIM_METRICS_DELTA(prev->role[r][SIM_METRIC_FRAMES],
+                                                 cur->role[r][SIM_METRIC_FRAMES]) / dt;
+        out->dropped[r]      = cur->role[r][SIM_METRIC_DROPPED];
+        out->coalesced[r]    = cur->role[r][SIM_METRIC_COALESCED];
+        out->queue_bytes[r]  = cur->role[r][SIM_METRIC_QUEUE_BYTES];
+    }
+    for (int c = 0; c < SIM_METRIC_CHAN_COUNT; ++c) {
+        out->chan_per_s[c] = SIM_METRICS_DELTA(prev->chan[c], cur->chan[c]) / dt;
+    }
+
+#undef SIM_METRICS_DELTA
+}
+
+static void sim_metrics_write(FILE *f, const SimMetricsBlock *mb)
+{
+    for (int m = 0; m < SIM_METRIC_COUNT; ++m) {
+        const SimMetricsInfo *info = &g_role_info[m];
+        if (info->name == NULL) {
+            continue;
+        }
+        fprintf(f, "# HELP %s %s\n# TYPE %s %s\n",
+                info->name, info->help, info->name, info->type);
+        for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+            uint64_t v = atomic_load_explicit(&mb->role[r].v[m], memory_order_relaxed);
+            if (info->scale == 1.0) {
+                fprintf(f, "%s{role=\"%s\"} %llu\n", info->name, g_role_names[r],
+                        (unsigned long long)v);
+            } else {
+                fprintf(f, "%s{role=\"%s\"} %.9g\n", info->name, g_role_names[r],
+                        (double)v * info->scale);
+            }
+        }
+    }
+
+    // Buckets are stored per bucket, exposed cumulatively
+    fprintf(f, "# HELP sim_tick_duration_seconds Loop pass duration.\n"
+               "# TYPE sim_tick_duration_seconds histogram\n");
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        uint64_t count = 0;
+        for (int b = 0; b < SIM_METRICS_HIST_BUCKETS; ++b) {
+            count += atomic_load_explicit(&mb->role[r].hist[b], memory_order_relaxed);
+            if (b < SIM_METRICS_HIST_BUCKETS - 1) {
+                fprintf(f, "sim_tick_duration_seconds_bucket{role=\"%s\",le=\"%.9g\"} %llu\n",
+                        g_role_names[r], (double)g_hist_le_ns[b] * 1e-9,
+                        (unsigned long long)count);
+            } else {
+                fprintf(f, "sim_tick_duration_seconds_bucket{role=\"%s\",le=\"+Inf\"} %llu\n",
+                        g_role_names[r], (unsigned long long)count);
+            }
+        }
+        uint64_t ns = atomic_load_explicit(&mb->role[r].v[SIM_METRIC_TICK_NS],
+                                           memory_order_relaxed);
+        fprintf(f, "sim_tick_duration_seconds_sum{role=\"%s\"} %.9g\n",
+                g_role_names[r], (double)ns * 1e-9);
+        fprintf(f, "sim_tick_duration_seconds_count{role=\"%s\"} %llu\n",
+                g_role_names[r], (unsigned long long)count);
+    }
+
+    fprintf(f, "# HELP sim_ipc_messages_total Messages per channel.\n"
+               "# TYPE sim_ipc_messages_total counter\n");
+    for (int c = 0; c < SIM_METRIC_CHAN_COUNT; ++c) {
+        fprintf(f, "sim_ipc_messages_total{channel=\"%s\"} %llu\n", g_chan_names[c],
+                (unsigned long long)atomic_load_explicit(&mb->chan[c], memory_order_relaxed));
+    }
+    fprintf(f, "# HELP sim_ipc_bytes_total Bytes per channel.\n"
+               "# TYPE sim_ipc_bytes_total counter\n");
+    for (int c = 0; c < SIM_METRIC_CHAN_COUNT; ++c) {
+        fprintf(f, "sim_ipc_bytes_total{channel=\"%s\"} %llu\n", g_chan_names[c],
+                (unsigned long long)atomic_load_explicit(&mb->chan_bytes[c],
+                                                         memory_order_relaxed));
+    }
+}
+
+int sim_metrics_export(const char *path)
+{
+    SimMetricsBlock *mb = sim_metrics_block();
+    if (mb == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    char tmp[512];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    FILE *f = fopen(tmp, "we");
+    if (f == NULL) {
+        return -1;
+    }
+    sim_metrics_write(f, mb);
+
+    int failed = ferror(f);
+    if (fclose(f) != 0 || failed) {
+        int e = errno;
+        unlink(tmp);
+        errno = e;
+        return -1;
+    }
+    return rename(tmp, path);
+}
+
+static void *sim_metrics_exporter_run(void *arg)
+{
+    SimMetricsExporter *e = arg;
+
+    pthread_mutex_lock(&e->lock);
+    while (!e->stop) {
+        struct timespec until;
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        uint64_t ns = (uint64_t)until.tv_nsec + (uint64_t)(e->interval * 1e9);
+        until.tv_sec  += (time_t)(ns / 1000000000u);
+        until.tv_nsec  = (long)(ns % 1000000000u);
+
+        while (!e->stop &&
+               pthread_cond_timedwait(&e->wake, &e->lock, &until) != ETIMEDOUT) {
+        }
+
+        // The file is written outside the lock; stop() waits for it
+        pthread_mutex_unlock(&e->lock);
+        if (sim_metrics_export(e->path) == 0) {
+            e->written++;
+        }
+        pthread_mutex_lock(&e->lock);
+    }
+    pthread_mutex_unlock(&e->lock);
+    return NULL;
+}
+
+int sim_metrics_exporter_start(SimMetricsExporter *e, const char *path, double interval)
+{
+    memset(e, 0, sizeof(*e));
+    if (path == NULL || path[0] == '\0' || interval <= 0.0 ||
+        strlen(path) >= sizeof(e->path)) {
+        errno = EINVAL;
+        return -1;
+    }
+    snprintf(e->path, sizeof(e->path), "%s", path);
+    e->interval = interval;
+
+    // Timed waits on the monotonic clock: wall clock jumps do not matter
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&e->wake, &ca);
+    pthread_condattr_destroy(&ca);
+    pthread_mutex_init(&e->lock, NULL);
+
+    int rc = pthread_create(&e->thread, NULL, sim_metrics_exporter_run, e);
+    if (rc != 0) {
+        pthread_cond_destroy(&e->wake);
+        pthread_mutex_destroy(&e->lock);
+        errno = rc;
+        return -1;
+    }
+    e->started = 1;
+    return 0;
+}
+
+void sim_metrics_exporter_stop(SimMetricsExporter *e)
+{
+    if (!e->started) {
+        return;
+    }
+
+    pthread_mutex_lock(&e->lock);
+    e->stop = 1;
+    pthread_cond_signal(&e->wake);
+    pthread_mutex_unlock(&e->lock);
+
+    pthread_join(e->thread, NULL);
+    pthread_cond_destroy(&e->wake);
+    pthread_mutex_destroy(&e->lock);
+    e->started = 0;
+}
+
+const char *sim_metrics_role_name(int role)
+{
+    return (role >= 0 && role < SIM_ROLE_COUNT) ? g_role_names[role] : "?";
+}
+
+const char *sim_metrics_chan_name(int chan)
+{
+    return (chan >= 0 && chan < SIM_METRIC_CHAN_COUNT) ? g_chan_names[chan] : "?";
+}
@@ -1,169 +1,737 @@
 // Runtime simulation parameters implementation.
 // Loads values from a text file and falls back to sim_const.h defaults if anything goes wrong.
+// master parses once and publishes a binary block; children just map it.
 
+#define _GNU_SOURCE   // memfd_create
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
 
 #include "sim_const.h"
 #include "sim_params.h"
+#include "sim_rng.h"
+#include "sim_types.h"
 
 // Internal global parameter set
 static SimParams g_params;
 static int g_params_initialized = 0;
+static int g_params_loaded = 0;       // a load succeeded in this process
 
-// Fill g_params with factory defaults from sim_const.h
-static void sim_params_init_defaults(void)
+/*
+    Shared binary block layout (versioned by SIM_PARAMS_VERSION).
+
+    Double buffered: generation g lives in slot[g & 1]. master writes the
+    next generation into the other slot and only then bumps generation
+    (release). Readers load generation (acquire), copy the slot, and retry
+    if generation moved meanwhile or the checksum does not match.
+*/
+typedef struct {
+    uint32_t  checksum;   // FNV-1a over params
+    uint32_t  reserved;
+    SimParams params;
+} SimParamsSlot;
+
+typedef struct {
+    uint32_t         magic;
+    uint32_t         version;
+    uint32_t         size;       // sizeof(SimParams) of the writer
+    uint32_t         reserved;
+    _Atomic uint64_t generation;
+    SimParamsSlot    slot[2];
+} SimParamsBlock;
+
+// Writer side (master) keeps its mapping for later generations
+static SimParamsBlock *g_block_rw = NULL;
+
+// Reader side (children) keeps its mapping to pick up new generations
+static const SimParamsBlock *g_block = NULL;
+static uint64_t g_generation = 0;
+
+// Fill a parameter set with factory defaults from sim_const.h
+static void sim_params_set_defaults(SimParams *sp)
 {
+    // Zero first: padding and string tails take part in memcmp on reload
+    memset(sp, 0, sizeof(*sp));
+
     // World size from sim_const.h
-    g_params.world_width  = (int)SIM_WORLD_WIDTH;
-    g_params.world_height = (int)SIM_WORLD_HEIGHT;
+    sp->world_width  = (int)SIM_WORLD_WIDTH;
+    sp->world_height = (int)SIM_WORLD_HEIGHT;
 
     // Drone dynamics
-    g_params.mass    = SIM_DEFAULT_MASS;
-    g_params.damping = SIM_DEFAULT_DAMPING;
-    g_params.dt      = SIM_DEFAULT_DT;
+    sp->mass    = SIM_DEFAULT_MASS;
+    sp->damping = SIM_DEFAULT_DAMPING;
+    sp->dt      = SIM_DEFAULT_DT;
 
     // Input force scaling
-    g_params.force_step = SIM_DEFAULT_FORCE_STEP;
-    g_params.max_force  = SIM_DEFAULT_MAX_FORCE;
+    sp->force_step = SIM_DEFAULT_FORCE_STEP;
+    sp->max_force  = SIM_DEFAULT_MAX_FORCE;
 
     // Potential-field repulsion
-    g_params.rho = SIM_DEFAULT_RHO;
-    g_params.eta = SIM_DEFAULT_ETA;
+    sp->rho = SIM_DEFAULT_RHO;
+    sp->eta = SIM_DEFAULT_ETA;
 
     // Environment population (caps)
-    g_params.num_obstacles = SIM_DEFAULT_NUM_OBSTACLES;
-    g_params.num_targets   = SIM_DEFAULT_NUM_TARGETS;   
+    sp->num_obstacles = SIM_DEFAULT_NUM_OBSTACLES;
+    sp->num_targets   = SIM_DEFAULT_NUM_TARGETS;   
 
     // Environment spawn control
-    g_params.initial_obstacles       = SIM_DEFAULT_INITIAL_OBSTACLES;      
-    g_params.initial_targets         = SIM_DEFAULT_INITIAL_TARGETS;         
-    g_params.obstacle_spawn_interval = SIM_DEFAULT_OBSTACLE_SPAWN_INTERVAL; 
-    g_params.target_spawn_interval   = SIM_DEFAULT_TARGET_SPAWN_INTERVAL;   
+    sp->initial_obstacles       = SIM_DEFAULT_INITIAL_OBSTACLES;      
+    sp->initial_targets         = SIM_DEFAULT_INITIAL_TARGETS;         
+    sp->obstacle_spawn_interval = SIM_DEFAULT_OBSTACLE_SPAWN_INTERVAL; 
+    sp->target_spawn_interval   = SIM_DEFAULT_TARGET_SPAWN_INTERVAL;   
+
+    // Obstacle collisions
+    sp->collision_response = SIM_DEFAULT_COLLISION_RESPONSE;
+    sp->restitution        = SIM_DEFAULT_RESTITUTION;
+
+    // Adaptive sub-stepping
+    sp->max_substeps = SIM_DEFAULT_MAX_SUBSTEPS;
+
+    // Precomputed wall repulsion table
+    sp->wall_lut_size = SIM_DEFAULT_WALL_LUT_SIZE;
+
+    // Cached obstacle repulsion field
+    sp->obstacle_field_cell = SIM_DEFAULT_OBSTACLE_FIELD_CELL;
+
+    // No scenario: random layout, run seed picked at startup
+    sp->scenario_path[0] = '\0';
+    sp->rng_seed         = 0;
+
+    // Not pinned, normal scheduling (cpu_mask / rt_priority zeroed above)
+    sp->mlock_all              = SIM_DEFAULT_MLOCK_ALL;
+    sp->jitter_report_interval = SIM_DEFAULT_JITTER_REPORT_INTERVAL;
 
+    // No observer socket unless the config names one
+    sp->observer_socket[0] = '\0';
+    sp->max_observers      = SIM_DEFAULT_MAX_OBSERVERS;
+    sp->snapshot_slots     = SIM_DEFAULT_SNAPSHOT_SLOTS;
+
+    // No metrics export unless the config names a file
+    sp->metrics_file[0]  = '\0';
+    sp->metrics_interval = SIM_DEFAULT_METRICS_INTERVAL;
+
+    // Static obstacles / targets
+    sp->obstacle_speed = SIM_DEFAULT_OBSTACLE_SPEED;
+    sp->target_speed   = SIM_DEFAULT_TARGET_SPEED;
+}
+
+static void sim_params_init_defaults(void)
+{
+    sim_params_set_defaults(&g_params);
     g_params_initialized = 1;
 }
 
-int sim_params_load(const char *path)
+// FNV-1a, enough to catch torn / foreign / stale-layout blocks
+static uint32_t sim_params_checksum(const SimParams *p)
 {
-    char line[256];
-    char key[64];
-    char value[64];
-    const char *use_path;
-    FILE *fp;
+    const unsigned char *b = (const unsigned char *)p;
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < sizeof(*p); ++i) {
+        h ^= b[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Copy the current generation out of the shared block (seqlock style)
+static int sim_params_read_block(const SimParamsBlock *blk,
+                                 SimParams *out, uint64_t *out_gen)
+{
+    for (int tries = 0; tries < 8; ++tries) {
+        uint64_t gen = atomic_load_explicit(&blk->generation, memory_order_acquire);
+        const SimParamsSlot *slot = &blk->slot[gen & 1];
+
+        SimParams copy = slot->params;
+        uint32_t  sum  = slot->checksum;
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&blk->generation, memory_order_relaxed) != gen) {
+            continue;  // writer lapped us, copy may be torn
+        }
+        if (sum != sim_params_checksum(&copy)) {
+            continue;
+        }
+
+        *out     = copy;
+        *out_gen = gen;
+        return 0;
+    }
+    return -1;
+}
+
+// Map the block master published in SIM_PARAMS_FD; 0 on success
+static int sim_params_map_shared(void)
+{
+    const char *env = getenv(SIM_PARAMS_FD_ENV);
+    if (env == NULL || env[0] == '\0') {
+        return -1;
+    }
+
+    char *end = NULL;
+    long fd = strtol(env, &end, 10);
+    if (end == env || *end != '\0' || fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat((int)fd, &st) != 0 || st.st_size < (off_t)sizeof(SimParamsBlock)) {
+        return -1;
+    }
+
+    const SimParamsBlock *blk = mmap(NULL, sizeof(SimParamsBlock), PROT_READ,
+                                     MAP_SHARED, (int)fd, 0);
+    if (blk == MAP_FAILED) {
+        return -1;
+    }
+
+    SimParams copy;
+    uint64_t  gen;
+    if (blk->magic   != SIM_PARAMS_MAGIC ||
+        blk->version != SIM_PARAMS_VERSION ||
+        blk->size    != sizeof(SimParams) ||
+        sim_params_read_block(blk, &copy, &gen) != 0) {
+        munmap((void *)blk, sizeof(SimParamsBlock));
+        return -1;
+    }
+
+    // Keep the mapping: sim_params_refresh() polls it for new generations
+    g_params             = copy;
+    g_params_initialized = 1;
+    g_block              = blk;
+    g_generation         = gen;
+    return 0;
+}
+
+// Write g_params as the next generation of the shared block
+static void sim_params_write_generation(void)
+{
+    uint64_t gen  = atomic_load_explicit(&g_block_rw->generation, memory_order_relaxed);
+    uint64_t next = gen + 1;
+    SimParamsSlot *slot = &g_block_rw->slot[next & 1];
+
+    slot->params   = g_params;
+    slot->checksum = sim_params_checksum(&slot->params);
 
+    atomic_store_explicit(&g_block_rw->generation, next, memory_order_release);
+}
+
+int sim_params_publish(void)
+{
     if (!g_params_initialized) {
         sim_params_init_defaults();
     }
 
-    // Use default path if caller passes NULL
-    use_path = (path != NULL) ? path : SIM_PARAMS_DEFAULT_PATH;
+    // One run seed for every child; logged by master for replays
+    if (g_params.rng_seed == 0) {
+        g_params.rng_seed = sim_rng_entropy();
+    }
+
+    int fd;
+#ifdef MFD_ALLOW_SEALING
+    // No MFD_CLOEXEC: children must inherit it across exec
+    fd = memfd_create("sim_params", MFD_ALLOW_SEALING);
+#else
+    char tmpl[] = "/tmp/sim_params_XXXXXX";
+    fd = mkstemp(tmpl);
+    if (fd >= 0) {
+        unlink(tmpl);
+    }
+#endif
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (ftruncate(fd, (off_t)sizeof(SimParamsBlock)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    SimParamsBlock *blk = mmap(NULL, sizeof(SimParamsBlock),
+                               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (blk == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    memset(blk, 0, sizeof(*blk));
+    blk->slot[0].params   = g_params;
+    blk->slot[0].checksum = sim_params_checksum(&g_params);
+    blk->size    = sizeof(SimParams);
+    blk->version = SIM_PARAMS_VERSION;
+    atomic_store_explicit(&blk->generation, 0, memory_order_relaxed);
+    blk->magic   = SIM_PARAMS_MAGIC;
+
+#ifdef F_SEAL_SHRINK
+    // Children may rely on the size never changing under their mapping
+    (void)fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW);
+#endif
+
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", fd);
+    if (setenv(SIM_PARAMS_FD_ENV, buf, 1) != 0) {
+        munmap(blk, sizeof(SimParamsBlock));
+        close(fd);
+        return -1;
+    }
+
+    // Keep the mapping: sim_params_reload() writes later generations
+    g_block_rw      = blk;
+    g_params_loaded = 1;  // what was published is this process's set
+    return fd;
+}
+
+/*
+    Text config parser.
 
-    fp = fopen(use_path, "r");
+    One "key value" pair per line, '#' or '//' comments, "[section]" lines
+    and "include <path>" (relative to the including file). Keys are looked
+    up by binary search in a table sorted by name; each entry knows where
+    the value lives in SimParams, its type, its valid range and the section
+    it belongs to. Aliases are just extra entries pointing at the same
+    field. Bad lines are reported as file:line on stderr and skipped, the
+    key keeps its previous value.
+*/
+#define SIM_PARAMS_MAX_INCLUDE_DEPTH 8
+#define SIM_PARAMS_MAX_LINE          512
+
+typedef enum {
+    SIM_PARAM_INT,
+    SIM_PARAM_DOUBLE,
+    SIM_PARAM_PATH,    // char[max], relative paths resolved like include
+    SIM_PARAM_U64,     // uint64_t, decimal or 0x hex, no range check
+    SIM_PARAM_CPUS     // uint64_t CPU mask from a list like "0-2,5"
+} SimParamType;
+
+typedef struct {
+    const char  *name;
+    const char  *section;
+    SimParamType type;
+    size_t       offset;
+    double       min;
+    double       max;
+} SimParamKey;
+
+#define P_INT(name, sec, field, lo, hi) \
+    { name, sec, SIM_PARAM_INT,    offsetof(SimParams, field), lo, hi }
+#define P_DBL(name, sec, field, lo, hi) \
+    { name, sec, SIM_PARAM_DOUBLE, offsetof(SimParams, field), lo, hi }
+#define P_U64(name, sec, field) \
+    { name, sec, SIM_PARAM_U64,    offsetof(SimParams, field), 0, 0 }
+#define P_CPUS(name, sec, field) \
+    { name, sec, SIM_PARAM_CPUS,   offsetof(SimParams, field), 0, 63 }
+#define P_PATH(name, sec, field) \
+    { name, sec, SIM_PARAM_PATH,   offsetof(SimParams, field), 0, sizeof(((SimParams *)0)->field) }
+
+// MUST stay sorted by name (strcmp order): looked up with bsearch
+static const SimParamKey g_param_keys[] = {
+    P_CPUS("bb_server_cpus",         "realtime",   cpu_mask[SIM_ROLE_BB_SERVER]),
+    P_INT("bb_server_priority",      "realtime",   rt_priority[SIM_ROLE_BB_SERVER], 0, 99),
+    P_DBL("coefficient",             "drone",      damping,                 0.0,   1e6),  // legacy
+    P_INT("collision_response",      "collisions", collision_response,      0,     2),
+    P_DBL("damping",                 "drone",      damping,                 0.0,   1e6),
+    P_CPUS("drone_cpus",             "realtime",   cpu_mask[SIM_ROLE_DRONE]),
+    P_INT("drone_priority",          "realtime",   rt_priority[SIM_ROLE_DRONE], 0, 99),
+    P_DBL("dt",                      "drone",      dt,                      1e-4,  1.0),
+    P_DBL("eta",                     "repulsion",  eta,                     0.0,   1e6),
+    P_DBL("force_step",              "forces",     force_step,              0.0,   1e4),
+    P_INT("height",                  "world",      world_height,            1,     10000), // legacy
+    P_INT("initial_obstacles",       "population", initial_obstacles,       0,     SIM_MAX_OBSTACLES),
+    P_INT("initial_targets",         "population", initial_targets,         0,     SIM_MAX_TARGETS),
+    P_CPUS("input_cpus",             "realtime",   cpu_mask[SIM_ROLE_INPUT]),
+    P_INT("input_priority",          "realtime",   rt_priority[SIM_ROLE_INPUT], 0, 99),
+    P_DBL("jitter_report_interval",  "realtime",   jitter_report_interval,  0.0,   3600.0),
+    P_DBL("mass",                    "drone",      mass,                    1e-3,  1e6),
+    P_DBL("max_force",               "forces",     max_force,               0.0,   1e6),
+    P_INT("max_observers",           "ipc",        max_observers,           0,     8),    // SIM_IPC_MAX_OBSERVERS
+    P_INT("max_obstacles",           "population", num_obstacles,           0,     SIM_MAX_OBSTACLES),
+    P_INT("max_substeps",            "drone",      max_substeps,            1,     1024),
+    P_INT("max_targets",             "population", num_targets,             0,     SIM_MAX_TARGETS),
+    P_PATH("metrics_file",           "metrics",    metrics_file),
+    P_DBL("metrics_interval",        "metrics",    metrics_interval,        0.1,   3600.0),
+    P_INT("mlock_all",               "realtime",   mlock_all,               0,     1),
+    P_INT("num_obstacles",           "population", num_obstacles,           0,     SIM_MAX_OBSTACLES),
+    P_INT("num_targets",             "population", num_targets,             0,     SIM_MAX_TARGETS),
+    P_PATH("observer_socket",        "ipc",        observer_socket),
+    P_DBL("obstacle_field_cell",     "repulsion",  obstacle_field_cell,     0.0,   100.0),
+    P_DBL("obstacle_spawn_interval", "spawn",      obstacle_spawn_interval, 1e-3,  3600.0),
+    P_DBL("obstacle_speed",          "motion",     obstacle_speed,          0.0,   1e3),
+    P_INT("obstacles",               "population", num_obstacles,           0,     SIM_MAX_OBSTACLES), // legacy
+    P_CPUS("obstacles_cpus",         "realtime",   cpu_mask[SIM_ROLE_OBSTACLES]),
+    P_INT("obstacles_priority",      "realtime",   rt_priority[SIM_ROLE_OBSTACLES], 0, 99),
+    P_DBL("radius",                  "repulsion",  rho,                     0.0,   1e4),  // legacy
+    P_DBL("refresh",                 "drone",      dt,                      1e-4,  1.0),  // legacy
+    P_DBL("restitution",             "collisions", restitution,             0.0,   1.0),
+    P_DBL("rho",                     "repulsion",  rho,                     0.0,   1e4),
+    P_U64("rng_seed",                "scenario",   rng_seed),
+    P_PATH("scenario_file",          "scenario",   scenario_path),
+    P_INT("snapshot_slots",          "ipc",        snapshot_slots,          0,     4096), // SIM_SNAPSHOT_MAX_SLOTS
+    P_DBL("target_spawn_interval",   "spawn",      target_spawn_interval,   1e-3,  3600.0),
+    P_DBL("target_speed",            "motion",     target_speed,            0.0,   1e3),
+    P_INT("targets",                 "population", num_targets,             0,     SIM_MAX_TARGETS), // legacy
+    P_CPUS("targets_cpus",           "realtime",   cpu_mask[SIM_ROLE_TARGETS]),
+    P_INT("targets_priority",        "realtime",   rt_priority[SIM_ROLE_TARGETS], 0, 99),
+    P_INT("wall_lut_size",           "repulsion",  wall_lut_size,           0,     4096), // SIM_PHYS_WALL_LUT_MAX
+    P_INT("width",                   "world",      world_width,             1,     10000), // legacy
+    P_INT("world_height",            "world",      world_height,            1,     10000),
+    P_INT("world_width",             "world",      world_width,             1,     10000),
+};
+
+#undef P_INT
+#undef P_DBL
+#undef P_PATH
+#undef P_U64
+#undef P_CPUS
+
+#define SIM_PARAMS_NUM_KEYS (sizeof(g_param_keys) / sizeof(g_param_keys[0]))
+
+static const char *const g_param_sections[] = {
+    "collisions", "drone", "forces", "ipc", "metrics", "motion", "population", "realtime",
+    "repulsion", "scenario", "spawn", "world"
+};
+
+static int sim_params_key_cmp(const void *name, const void *entry)
+{
+    return strcmp((const char *)name, ((const SimParamKey *)entry)->name);
+}
+
+static const SimParamKey *sim_params_find_key(const char *name)
+{
+    return bsearch(name, g_param_keys, SIM_PARAMS_NUM_KEYS,
+                   sizeof(g_param_keys[0]), sim_params_key_cmp);
+}
+
+static int sim_params_known_section(const char *name)
+{
+    for (size_t i = 0; i < sizeof(g_param_sections) / sizeof(g_param_sections[0]); ++i) {
+        if (strcmp(name, g_param_sections[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Report a problem at path:line; always returns 1 (one more error)
+static int sim_params_report(const char *path, int line_no, const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf(stderr, "%s:%d: ", path, line_no);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    return 1;
+}
+
+// Resolve a path named in a config file relative to that file's directory
+static void sim_params_include_path(char *out, size_t out_size,
+                                    const char *from, const char *target)
+{
+    const char *slash = strrchr(from, '/');
+
+    if (target[0] == '/' || slash == NULL) {
+        snprintf(out, out_size, "%s", target);
+    } else {
+        snprintf(out, out_size, "%.*s/%s", (int)(slash - from), from, target);
+    }
+}
+
+// "0-2,5" -> bits 0, 1, 2, 5; "all" -> 0 (no pinning). CPUs 0..max_cpu.
+static int sim_params_parse_cpus(const char *value, int max_cpu, uint64_t *out)
+{
+    if (strcmp(value, "all") == 0) {
+        *out = 0;
+        return 0;
+    }
+
+    uint64_t    mask = 0;
+    const char *p    = value;
+    for (;;) {
+        char *end = NULL;
+        long  lo  = strtol(p, &end, 10);
+        long  hi  = lo;
+        if (end == p || lo < 0) {
+            return -1;
+        }
+        p = end;
+        if (*p == '-') {
+            hi = strtol(p + 1, &end, 10);
+            if (end == p + 1) {
+                return -1;
+            }
+            p = end;
+        }
+        if (hi < lo || hi > max_cpu) {
+            return -1;
+        }
+        for (long c = lo; c <= hi; ++c) {
+            mask |= UINT64_C(1) << c;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (*p++ != ',') {
+            return -1;
+        }
+    }
+
+    *out = mask;
+    return 0;
+}
+
+// Convert and range-check value, store it in sp on success
+static int sim_params_store(const SimParamKey *k, const char *value,
+                            SimParams *sp, const char *path, int line_no)
+{
+    char  *end = NULL;
+    double v;
+
+    if (k->type == SIM_PARAM_PATH) {
+        char  *field = (char *)sp + k->offset;
+        size_t cap   = (size_t)k->max;
+        char   full[PATH_MAX];
+
+        sim_params_include_path(full, sizeof(full), path, value);
+        if (strlen(full) >= cap) {
+            return sim_params_report(path, line_no, "'%s': path longer than %zu characters",
+                                     k->name, cap - 1);
+        }
+        memcpy(field, full, strlen(full) + 1);
+        return 0;
+    }
+
+    if (k->type == SIM_PARAM_CPUS) {
+        uint64_t mask = 0;
+        if (sim_params_parse_cpus(value, (int)k->max, &mask) != 0) {
+            return sim_params_report(path, line_no,
+                                     "'%s': invalid CPU list '%s' (e.g. \"0-2,5\", CPUs 0..%d, \"all\")",
+                                     k->name, value, (int)k->max);
+        }
+        *(uint64_t *)((char *)sp + k->offset) = mask;
+        return 0;
+    }
+
+    errno = 0;
+    if (k->type == SIM_PARAM_U64) {
+        unsigned long long u = strtoull(value, &end, 0);
+        if (value[0] == '-' || end == value || *end != '\0' || errno == ERANGE) {
+            return sim_params_report(path, line_no, "'%s': invalid unsigned value '%s'",
+                                     k->name, value);
+        }
+        *(uint64_t *)((char *)sp + k->offset) = (uint64_t)u;
+        return 0;
+    }
+
+    if (k->type == SIM_PARAM_INT) {
+        long iv = strtol(value, &end, 10);
+        v = (double)iv;
+    } else {
+        v = strtod(value, &end);
+    }
+
+    if (end == value || *end != '\0' || errno == ERANGE) {
+        return sim_params_report(path, line_no, "'%s': invalid %s value '%s'",
+                                 k->name,
+                                 k->type == SIM_PARAM_INT ? "integer" : "numeric",
+                                 value);
+    }
+    if (!(v >= k->min && v <= k->max)) {
+        return sim_params_report(path, line_no, "'%s': %s out of range [%g, %g]",
+                                 k->name, value, k->min, k->max);
+    }
+
+    char *field = (char *)sp + k->offset;
+    if (k->type == SIM_PARAM_INT) {
+        *(int *)field = (int)v;
+    } else {
+        *(double *)field = v;
+    }
+    return 0;
+}
+
+/*
+    Parse one file on top of whatever sp already holds.
+    Returns the number of errors reported, -1 if the file cannot be opened.
+*/
+static int sim_params_parse_one(const char *path, SimParams *sp, int depth)
+{
+    char line[SIM_PARAMS_MAX_LINE];
+    char section[64] = "";
+    int  line_no = 0;
+    int  errors  = 0;
+    FILE *fp;
+
+    fp = fopen(path, "r");
     if (!fp) {
-        // Could not open file, keep defaults and tell caller it failed
         return -1;
     }
 
     while (fgets(line, sizeof(line), fp)) {
-        char *p = line;
+        line_no++;
 
-        // Skip leading spaces / tabs
-        while (*p == ' ' || *p == '\t') {
-            ++p;
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(fp)) {
+            errors += sim_params_report(path, line_no, "line too long (max %d)",
+                                        SIM_PARAMS_MAX_LINE - 2);
+            int ch;
+            while ((ch = fgetc(fp)) != EOF && ch != '\n') {
+                // discard the rest of the line
+            }
+            continue;
         }
 
-        // Skip empty lines and comments starting with # or //
-        if (*p == '\0' || *p == '\n' || *p == '#') {
+        // Tokenize: up to three whitespace-separated words
+        char *tok[3] = { NULL, NULL, NULL };
+        int   ntok   = 0;
+        char *save   = NULL;
+        for (char *t = strtok_r(line, " \t\r\n", &save);
+             t != NULL && ntok < 3;
+             t = strtok_r(NULL, " \t\r\n", &save)) {
+            // Comments may start anywhere a token does
+            if (t[0] == '#' || (t[0] == '/' && t[1] == '/')) {
+                break;
+            }
+            tok[ntok++] = t;
+        }
+
+        if (ntok == 0) {
             continue;
         }
-        if (p[0] == '/' && p[1] == '/') {
+
+        // [section]
+        if (tok[0][0] == '[') {
+            size_t n = strlen(tok[0]);
+            if (ntok != 1 || n < 3 || tok[0][n - 1] != ']') {
+                errors += sim_params_report(path, line_no, "malformed section header");
+                continue;
+            }
+            tok[0][n - 1] = '\0';
+            if (!sim_params_known_section(tok[0] + 1)) {
+                errors += sim_params_report(path, line_no, "unknown section [%s]", tok[0] + 1);
+                section[0] = '\0';
+                continue;
+            }
+            snprintf(section, sizeof(section), "%s", tok[0] + 1);
             continue;
         }
 
-        if (sscanf(p, "%63s %63s", key, value) != 2) {
+        if (ntok != 2) {
+            errors += sim_params_report(path, line_no, ntok == 1
+                                        ? "'%s': missing value"
+                                        : "'%s': trailing text after value",
+                                        tok[0]);
             continue;
         }
 
-        // Accept both legacy short keys and more explicit names
-        if (strcmp(key, "world_width") == 0 || strcmp(key, "width") == 0) {
-            g_params.world_width = (int)strtol(value, NULL, 10);
-        } else if (strcmp(key, "world_height") == 0 || strcmp(key, "height") == 0) {
-            g_params.world_height = (int)strtol(value, NULL, 10);
-
-        // Environment caps (max counts)
-        } else if (strcmp(key, "num_obstacles") == 0 || strcmp(key, "obstacles") == 0) {
-            g_params.num_obstacles = (int)strtol(value, NULL, 10); // legacy name kept for compatibility
-        } else if (strcmp(key, "num_targets") == 0 || strcmp(key, "targets") == 0) {
-            g_params.num_targets = (int)strtol(value, NULL, 10);
-        } else if (strcmp(key, "max_obstacles") == 0) {
-            g_params.num_obstacles = (int)strtol(value, NULL, 10); // explicit max name
-        } else if (strcmp(key, "max_targets") == 0) {
-            g_params.num_targets = (int)strtol(value, NULL, 10);
-
-        // Environment spawn control
-        } else if (strcmp(key, "initial_obstacles") == 0) {
-            g_params.initial_obstacles = (int)strtol(value, NULL, 10);
-        } else if (strcmp(key, "initial_targets") == 0) {
-            g_params.initial_targets = (int)strtol(value, NULL, 10);
-        } else if (strcmp(key, "obstacle_spawn_interval") == 0) {
-            g_params.obstacle_spawn_interval = strtod(value, NULL);
-        } else if (strcmp(key, "target_spawn_interval") == 0) {
-            g_params.target_spawn_interval = strtod(value, NULL);
-
-        // Drone dynamics
-        } else if (strcmp(key, "mass") == 0) {
-            g_params.mass = strtod(value, NULL);
-        } else if (strcmp(key, "damping") == 0 || strcmp(key, "coefficient") == 0) {
-            g_params.damping = strtod(value, NULL);
-        } else if (strcmp(key, "dt") == 0 || strcmp(key, "refresh") == 0) {
-            g_params.dt = strtod(value, NULL);
-
-        // User command forces
-        } else if (strcmp(key, "force_step") == 0) {
-            g_params.force_step = strtod(value, NULL);
-        } else if (strcmp(key, "max_force") == 0) {
-            g_params.max_force = strtod(value, NULL);
-
-        // Potential-field repulsion
-        } else if (strcmp(key, "rho") == 0 || strcmp(key, "radius") == 0) {
-            g_params.rho = strtod(value, NULL);
-        } else if (strcmp(key, "eta") == 0) {
-            g_params.eta = strtod(value, NULL);
-        }
-        // Unknown keys are ignored on purpose
+        // include <path>
+        if (strcmp(tok[0], "include") == 0) {
+            char inc[PATH_MAX];
+            if (depth + 1 >= SIM_PARAMS_MAX_INCLUDE_DEPTH) {
+                errors += sim_params_report(path, line_no, "include nested too deeply");
+                continue;
+            }
+            sim_params_include_path(inc, sizeof(inc), path, tok[1]);
+            int rc = sim_params_parse_one(inc, sp, depth + 1);
+            if (rc < 0) {
+                errors += sim_params_report(path, line_no, "cannot open include '%s'", inc);
+            } else {
+                errors += rc;
+            }
+            continue;
+        }
+
+        const SimParamKey *k = sim_params_find_key(tok[0]);
+        if (k == NULL) {
+            // Not an error: newer configs may carry keys older binaries lack
+            fprintf(stderr, "%s:%d: warning: unknown key '%s' ignored\n",
+                    path, line_no, tok[0]);
+            continue;
+        }
+        if (section[0] != '\0' && strcmp(section, k->section) != 0) {
+            errors += sim_params_report(path, line_no, "'%s' belongs in [%s], not [%s]",
+                                        k->name, k->section, section);
+            continue;
+        }
+
+        errors += sim_params_store(k, tok[1], sp, path, line_no);
     }
 
     fclose(fp);
+    return errors;
+}
 
-    // Small sanity checks so obviously broken configs don't explode too hard
-    if (g_params.num_obstacles < 0) {
-        g_params.num_obstacles = 0; 
-    }
-    if (g_params.num_targets < 0) {
-        g_params.num_targets = 0;
+// Cross-field checks that a per-key range cannot express
+static void sim_params_sanitize(SimParams *sp)
+{
+    if (sp->initial_obstacles > sp->num_obstacles) {
+        sp->initial_obstacles = sp->num_obstacles; 
     }
-    if (g_params.initial_obstacles < 0) {
-        g_params.initial_obstacles = 0;
+    if (sp->initial_targets > sp->num_targets) {
+        sp->initial_targets = sp->num_targets;
     }
-    if (g_params.initial_targets < 0) {
-        g_params.initial_targets = 0;
+}
+
+/*
+    Parse a text config (and its includes) on top of sp, then sanitize.
+    Returns 0 if everything parsed cleanly, -1 if the file is unreadable
+    or any line was rejected (valid lines are still applied).
+*/
+static int sim_params_parse_file(const char *path, SimParams *sp)
+{
+    int rc = sim_params_parse_one(path, sp, 0);
+
+    sim_params_sanitize(sp);
+    return rc == 0 ? 0 : -1;
+}
+
+const char *sim_params_resolve_path(const char *path)
+{
+    // Use default path if caller passes NULL
+    if (path != NULL) {
+        return path;
     }
-    if (g_params.initial_obstacles > g_params.num_obstacles) {
-        g_params.initial_obstacles = g_params.num_obstacles; 
+
+    const char *env = getenv(SIM_PARAMS_PATH_ENV);
+    if (env != NULL && env[0] != '\0') {
+        return env;
     }
-    if (g_params.initial_targets > g_params.num_targets) {
-        g_params.initial_targets = g_params.num_targets;
+    return SIM_PARAMS_DEFAULT_PATH;
+}
+
+int sim_params_load(const char *path)
+{
+    if (!g_params_initialized) {
+        sim_params_init_defaults();
     }
-    if (g_params.obstacle_spawn_interval <= 0.0) {
-        g_params.obstacle_spawn_interval = SIM_DEFAULT_OBSTACLE_SPAWN_INTERVAL; 
+
+    // Role threads of the single-process build: already loaded
+    if (path == NULL && g_params_loaded) {
+        return 0;
     }
-    if (g_params.target_spawn_interval <= 0.0) {
-        g_params.target_spawn_interval = SIM_DEFAULT_TARGET_SPAWN_INTERVAL;
+
+    // Children: master already parsed and validated everything
+    if (path == NULL && sim_params_map_shared() == 0) {
+        g_params_loaded = 1;
+        return 0;
     }
 
-    return 0;
+    int rc = sim_params_parse_file(sim_params_resolve_path(path), &g_params);
+    if (rc == 0) {
+        g_params_loaded = 1;
+    }
+    return rc;
 }
 
 const SimParams *sim_params_get(void)
@@ -183,3 +751,92 @@ void sim_params_get_copy(SimParams *out)
         *out = g_params;
     }
 }
+
+// Keys that size arrays / pipes / buffers cannot change under a live sim
+static void sim_params_keep_restart_only(SimParams *next, const SimParams *cur)
+{
+    next->world_width         = cur->world_width;
+    next->world_height        = cur->world_height;
+    next->num_obstacles       = cur->num_obstacles;
+    next->num_targets         = cur->num_targets;
+    next->initial_obstacles   = cur->initial_obstacles;
+    next->initial_targets     = cur->initial_targets;
+    next->obstacle_field_cell = cur->obstacle_field_cell;
+    memcpy(next->scenario_path, cur->scenario_path, sizeof(next->scenario_path));
+    next->rng_seed            = cur->rng_seed;
+
+    // Applied once by each role at startup (sim_rt_apply)
+    memcpy(next->cpu_mask, cur->cpu_mask, sizeof(next->cpu_mask));
+    memcpy(next->rt_priority, cur->rt_priority, sizeof(next->rt_priority));
+    next->mlock_all           = cur->mlock_all;
+
+    // bb_server binds the socket once
+    memcpy(next->observer_socket, cur->observer_socket, sizeof(next->observer_socket));
+    next->max_observers       = cur->max_observers;
+    next->snapshot_slots      = cur->snapshot_slots;
+
+    // bb_server starts the exporter once
+    memcpy(next->metrics_file, cur->metrics_file, sizeof(next->metrics_file));
+    next->metrics_interval    = cur->metrics_interval;
+
+    // bb_server / drone pick cached or exact obstacle repulsion once
+    next->obstacle_speed      = cur->obstacle_speed;
+    next->target_speed        = cur->target_speed;
+}
+
+int sim_params_reload(const char *path)
+{
+    SimParams next;
+
+    if (!g_params_initialized) {
+        sim_params_init_defaults();
+    }
+
+    // Start from factory defaults so keys removed from the file revert
+    sim_params_set_defaults(&next);
+    if (sim_params_parse_file(sim_params_resolve_path(path), &next) != 0) {
+        return -1;  // e.g. editor mid-save: keep the current generation
+    }
+
+    sim_params_keep_restart_only(&next, &g_params);
+    if (memcmp(&next, &g_params, sizeof(next)) == 0) {
+        return 0;
+    }
+
+    g_params = next;
+    if (g_block_rw != NULL) {
+        sim_params_write_generation();
+    }
+    return 1;
+}
+
+int sim_params_refresh(void)
+{
+    if (g_block == NULL) {
+        return 0;
+    }
+
+    // Fast path: one atomic load per tick
+    if (atomic_load_explicit(&g_block->generation, memory_order_relaxed) == g_generation) {
+        return 0;
+    }
+
+    SimParams copy;
+    uint64_t  gen;
+    if (sim_params_read_block(g_block, &copy, &gen) != 0) {
+        return 0;  // writer busy, try again next tick
+    }
+
+    g_params     = copy;
+    g_generation = gen;
+    return 1;
+}
+
+unsigned long sim_params_generation(void)
+{
+    if (g_block_rw != NULL) {
+        return (unsigned long)atomic_load_explicit(&g_block_rw->generation,
+                                                   memory_order_relaxed);
+    }
+    return (unsigned long)g_generation;
+}
@@ -0,0 +1,1261 @@
+// Drone physics implementation (repulsion, hit tests, integrator).
+// Moved out of bb_server.c / drone.c so every process and tool shares one copy.
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sim_physics.h"
+
+double sim_physics_repulsive_force(double distance,
+                                   double eta,
+                                   double rho,
+                                   double vx,
+                                   double vy)
+{
+    if (eta <= 0.0 || rho <= 0.0) {
+        return 0.0;
+    }
+
+    // Avoid insane spikes and ignore outside radius
+    if (distance <= SIM_PHYS_MIN_DIST || distance > rho) {
+        return 0.0;
+    }
+
+    double vel_mag = sqrt(vx * vx + vy * vy);
+    if (vel_mag <= 0.0) {
+        return 0.0;  // if we're not moving, no repulsion
+    }
+
+    double inv_d   = 1.0 / distance;
+    double inv_rho = 1.0 / rho;
+
+    double base = (inv_d - inv_rho) * inv_d * inv_d;  // (1/d - 1/rho)/d^2
+    if (base <= 0.0) {
+        return 0.0;
+    }
+
+    return eta * base * vel_mag;
+}
+
+void sim_physics_wall_repulsion(const SimParams  *params,
+                                const DroneState *drone,
+                                double           *out_fx,
+                                double           *out_fy)
+{
+    double fx = 0.0;
+    double fy = 0.0;
+
+    double rho = params->rho;  // radius of influence
+    double eta = params->eta;  // strength
+
+    if (rho <= 0.0 || eta <= 0.0) {
+        *out_fx = 0.0;
+        *out_fy = 0.0;
+        return;
+    }
+
+    double x  = drone->x;
+    double y  = drone->y;
+    double vx = drone->vx;
+    double vy = drone->vy;
+
+    double w = (double)params->world_width;
+    double h = (double)params->world_height;
+
+    // LEFT wall (x = 0): distance = x, push +x
+    if (x < rho) {
+        fx += sim_physics_repulsive_force(x, eta, rho, vx, vy);
+    }
+
+    // RIGHT wall (x = w): distance = w - x, push -x
+    if (x > w - rho) {
+        fx -= sim_physics_repulsive_force(w - x, eta, rho, vx, vy);
+    }
+
+    // BOTTOM wall (y = 0): distance = y, push +y
+    if (y < rho) {
+        fy += sim_physics_repulsive_force(y, eta, rho, vx, vy);
+    }
+
+    // TOP wall (y = h): distance = h - y, push -y
+    if (y > h - rho) {
+        fy -= sim_physics_repulsive_force(h - y, eta, rho, vx, vy);
+    }
+
+    *out_fx = fx;
+    *out_fy = fy;
+}
+
+void sim_physics_obstacle_repulsion(const SimParams  *params,
+                                    const DroneState *drone,
+                                    const Obstacle   *obstacles,
+                                    int               num_obstacles,
+                                    double           *out_fx,
+                                    double           *out_fy)
+{
+    double fx = 0.0;
+    double fy = 0.0;
+
+    double eta     = params->eta;
+    double rho_obs = params->rho * SIM_PHYS_OBS_RHO_SCALE;
+
+    if (rho_obs <= 0.0 || eta <= 0.0) {
+        *out_fx = 0.0;
+        *out_fy = 0.0;
+        return;
+    }
+
+    double x  = drone->x;
+    double y  = drone->y;
+    double vx = drone->vx;
+    double vy = drone->vy;
+
+    for (int i = 0; i < num_obstacles; ++i) {
+        const Obstacle *obs = &obstacles[i];
+        if (!obs->active) {
+            continue;
+        }
+
+        // Direction: AWAY from obstacle (from obstacle to drone)
+        double nx = x - obs->x;
+        double ny = y - obs->y;
+        double dist = sqrt(nx * nx + ny * ny);
+        if (dist <= 0.0 || dist > rho_obs) {
+            continue; // too far or invalid
+        }
+
+        double f_mag = sim_physics_repulsive_force(dist, eta, rho_obs, vx, vy);
+        if (f_mag <= 0.0) {
+            continue;
+        }
+
+        fx += f_mag * nx / dist;
+        fy += f_mag * ny / dist;
+    }
+
+    *out_fx = fx;
+    *out_fy = fy;
+}
+
+void sim_physics_wall_lut_build(SimWallLut *lut, const SimParams *params)
+{
+    int size = params->wall_lut_size;
+    if (size > SIM_PHYS_WALL_LUT_MAX) {
+        size = SIM_PHYS_WALL_LUT_MAX;
+    }
+
+    lut->rho   = params->rho;
+    lut->eta   = params->eta;
+    lut->d_min = SIM_PHYS_MIN_DIST;
+
+    if (size < 2 || params->rho <= SIM_PHYS_MIN_DIST || params->eta <= 0.0) {
+        lut->size     = 0;
+        lut->inv_step = 0.0;
+        return;
+    }
+
+    double step = (params->rho - SIM_PHYS_MIN_DIST) / (double)(size - 1);
+
+    lut->size     = size;
+    lut->inv_step = 1.0 / step;
+
+    // Unit speed: the law is linear in |v|. Sample 0 sits exactly on d_min,
+    // which the law itself excludes, so it is evaluated in closed form.
+    double inv_rho = 1.0 / params->rho;
+    for (int i = 0; i < size; ++i) {
+        double inv_d = 1.0 / (SIM_PHYS_MIN_DIST + step * (double)i);
+        lut->gain[i] = params->eta * (inv_d - inv_rho) * inv_d * inv_d;
+    }
+    lut->gain[size - 1] = 0.0;
+}
+
+// Linear interpolation of the tabulated gain, 0 outside (d_min, rho]
+static double wall_lut_gain(const SimWallLut *lut, double d)
+{
+    if (d <= lut->d_min || d > lut->rho) {
+        return 0.0;
+    }
+
+    double u = (d - lut->d_min) * lut->inv_step;
+    int    i = (int)u;
+    if (i >= lut->size - 1) {
+        return lut->gain[lut->size - 1];
+    }
+
+    double frac = u - (double)i;
+    return lut->gain[i] + frac * (lut->gain[i + 1] - lut->gain[i]);
+}
+
+void sim_physics_wall_repulsion_lut(const SimWallLut *lut,
+                                    const SimParams  *params,
+                                    const DroneState *drone,
+                                    double           *out_fx,
+                                    double           *out_fy)
+{
+    if (lut == NULL || lut->size == 0) {
+        sim_physics_wall_repulsion(params, drone, out_fx, out_fy);
+        return;
+    }
+
+    double rho = lut->rho;
+    double x   = drone->x;
+    double y   = drone->y;
+    double w   = (double)params->world_width;
+    double h   = (double)params->world_height;
+
+    double gx = 0.0;
+    double gy = 0.0;
+
+    // Same sign logic as sim_physics_wall_repulsion()
+    if (x < rho)     gx += wall_lut_gain(lut, x);
+    if (x > w - rho) gx -= wall_lut_gain(lut, w - x);
+    if (y < rho)     gy += wall_lut_gain(lut, y);
+    if (y > h - rho) gy -= wall_lut_gain(lut, h - y);
+
+    if (gx == 0.0 && gy == 0.0) {
+        *out_fx = 0.0;
+        *out_fy = 0.0;
+        return;
+    }
+
+    double vel_mag = sqrt(drone->vx * drone->vx + drone->vy * drone->vy);
+    *out_fx = gx * vel_mag;
+    *out_fy = gy * vel_mag;
+}
+
+// Grid size for the params' cell; 0 if disabled or over the node cap
+// (checked in floating point: a tiny cell would overflow the int sizes)
+static size_t field_dims(const SimParams *params, int *nx, int *ny)
+{
+    double cell = params->obstacle_field_cell;
+    if (cell <= 0.0) {
+        return 0;
+    }
+
+    double nxd = ceil((double)params->world_width  / cell) + 1.0;
+    double nyd = ceil((double)params->world_height / cell) + 1.0;
+    if (nxd * nyd > (double)SIM_PHYS_FIELD_MAX_NODES) {
+        return 0;
+    }
+
+    *nx = (int)nxd;
+    *ny = (int)nyd;
+    return (size_t)*nx * (size_t)*ny;
+}
+
+size_t sim_physics_field_nodes(const SimParams *params)
+{
+    int nx, ny;
+    return field_dims(params, &nx, &ny);
+}
+
+int sim_physics_field_init(SimObstacleField *field,
+                           const SimParams  *params,
+                           double           *gx,
+                           double           *gy,
+                           size_t            capacity)
+{
+    int    nx    = 0;
+    int    ny    = 0;
+    size_t nodes = field_dims(params, &nx, &ny);
+
+    memset(field, 0, sizeof(*field));
+
+    if (nodes == 0 || gx == NULL || gy == NULL || capacity < nodes) {
+        return -1;
+    }
+
+    field->cell     = params->obstacle_field_cell;
+    field->nx       = nx;
+    field->ny       = ny;
+    field->rho      = params->rho * SIM_PHYS_OBS_RHO_SCALE;
+    field->eta      = params->eta;
+    field->gx       = gx;
+    field->gy       = gy;
+    field->capacity = capacity;
+
+    memset(gx, 0, sizeof(double) * nodes);
+    memset(gy, 0, sizeof(double) * nodes);
+    return 0;
+}
+
+// Add (sign = +1) or remove (sign = -1) one obstacle's gain from the nodes
+// within its perception radius
+static void field_splat(SimObstacleField *field, const Obstacle *o, double sign)
+{
+    double rho  = field->rho;
+    double cell = field->cell;
+
+    if (rho <= 0.0 || field->eta <= 0.0) {
+        return;
+    }
+
+    int i0 = (int)ceil((o->x - rho) / cell);
+    int i1 = (int)floor((o->x + rho) / cell);
+    int j0 = (int)ceil((o->y - rho) / cell);
+    int j1 = (int)floor((o->y + rho) / cell);
+    if (i0 < 0) i0 = 0;
+    if (j0 < 0) j0 = 0;
+    if (i1 > field->nx - 1) i1 = field->nx - 1;
+    if (j1 > field->ny - 1) j1 = field->ny - 1;
+
+    for (int j = j0; j <= j1; ++j) {
+        double ny = (double)j * cell - o->y;
+        for (int i = i0; i <= i1; ++i) {
+            double nx   = (double)i * cell - o->x;
+            double dist = sqrt(nx * nx + ny * ny);
+
+            double g = sim_physics_repulsive_force(dist, field->eta, rho, 1.0, 0.0);
+            if (g <= 0.0) {
+                continue;
+            }
+
+            size_t idx = (size_t)j * (size_t)field->nx + (size_t)i;
+            field->gx[idx] += sign * g * nx / dist;
+            field->gy[idx] += sign * g * ny / dist;
+        }
+    }
+}
+
+static int obstacle_equal(const Obstacle *a, const Obstacle *b)
+{
+    return a->active == b->active &&
+           a->x == b->x && a->y == b->y && a->radius == b->radius;
+}
+
+void sim_physics_field_update(SimObstacleField *field,
+                              const Obstacle   *obstacles,
+                              int               num_obstacles)
+{
+    if (field->cell <= 0.0) {
+        return;
+    }
+    if (num_obstacles > SIM_MAX_OBSTACLES) {
+        num_obstacles = SIM_MAX_OBSTACLES;
+    }
+
+    int slots = (num_obstacles > field->num_applied) ? num_obstacles
+                                                     : field->num_applied;
+
+    for (int i = 0; i < slots; ++i) {
+        Obstacle *old = &field->applied[i];
+        Obstacle  none = { 0 };
+        const Obstacle *cur = (i < num_obstacles) ? &obstacles[i] : &none;
+
+        if (i < field->num_applied && obstacle_equal(old, cur)) {
+            continue;
+        }
+
+        if (i < field->num_applied && old->active) {
+            field_splat(field, old, -1.0);
+        }
+        if (cur->active) {
+            field_splat(field, cur, +1.0);
+        }
+        *old = *cur;
+    }
+
+    field->num_applied = num_obstacles;
+}
+
+void sim_physics_field_sample(const SimObstacleField *field,
+                              const DroneState       *drone,
+                              double                 *out_fx,
+                              double                 *out_fy)
+{
+    *out_fx = 0.0;
+    *out_fy = 0.0;
+
+    double u = drone->x / field->cell;
+    double v = drone->y / field->cell;
+    if (u < 0.0 || v < 0.0) {
+        return;
+    }
+
+    int i = (int)u;
+    int j = (int)v;
+    double fu = u - (double)i;
+    double fv = v - (double)j;
+
+    // On (or past) the far edge: weight the last node fully
+    if (i >= field->nx - 1) {
+        i  = field->nx - 2;
+        fu = 1.0;
+    }
+    if (j >= field->ny - 1) {
+        j  = field->ny - 2;
+        fv = 1.0;
+    }
+
+    size_t k00 = (size_t)j * (size_t)field->nx + (size_t)i;
+    size_t k10 = k00 + 1;
+    size_t k01 = k00 + (size_t)field->nx;
+    size_t k11 = k01 + 1;
+
+    double w00 = (1.0 - fu) * (1.0 - fv);
+    double w10 = fu * (1.0 - fv);
+    double w01 = (1.0 - fu) * fv;
+    double w11 = fu * fv;
+
+    double gx = w00 * field->gx[k00] + w10 * field->gx[k10] +
+                w01 * field->gx[k01] + w11 * field->gx[k11];
+    double gy = w00 * field->gy[k00] + w10 * field->gy[k10] +
+                w01 * field->gy[k01] + w11 * field->gy[k11];
+
+    if (gx == 0.0 && gy == 0.0) {
+        return;
+    }
+
+    double vel_mag = sqrt(drone->vx * drone->vx + drone->vy * drone->vy);
+    *out_fx = gx * vel_mag;
+    *out_fy = gy * vel_mag;
+}
+
+void sim_physics_env_repulsion(const SimParams  *params,
+                               const SimEnv     *env,
+                               const DroneState *drone,
+                               double           *out_fx_wall,
+                               double           *out_fy_wall,
+                               double           *out_fx_obs,
+                               double           *out_fy_obs)
+{
+    sim_physics_wall_repulsion_lut(env->wall_lut, params, drone,
+                                   out_fx_wall, out_fy_wall);
+
+    if (env->field != NULL && env->field->cell > 0.0) {
+        sim_physics_field_sample(env->field, drone, out_fx_obs, out_fy_obs);
+    } else if (env->obstacles != NULL && env->num_obstacles > 0) {
+        sim_physics_obstacle_repulsion(params, drone,
+                                       env->obstacles, env->num_obstacles,
+                                       out_fx_obs, out_fy_obs);
+    } else {
+        *out_fx_obs = 0.0;
+        *out_fy_obs = 0.0;
+    }
+}
+
+int sim_physics_segment_hits_circle(double x0, double y0,
+                                    double x1, double y1,
+                                    double cx, double cy,
+                                    double r)
+{
+    double r2 = r * r;
+
+    // Endpoint inside circle?
+    double dx0 = x0 - cx;
+    double dy0 = y0 - cy;
+    double dx1 = x1 - cx;
+    double dy1 = y1 - cy;
+
+    if (dx0 * dx0 + dy0 * dy0 <= r2 || dx1 * dx1 + dy1 * dy1 <= r2) {
+        return 1;
+    }
+
+    // Degenerate segment
+    double sx = x1 - x0;
+    double sy = y1 - y0;
+    double len2 = sx * sx + sy * sy;
+    if (len2 <= 1e-9) {
+        return 0;
+    }
+
+    // Projection of circle center onto segment
+    double t = ((cx - x0) * sx + (cy - y0) * sy) / len2;
+    if (t < 0.0) t = 0.0;
+    else if (t > 1.0) t = 1.0;
+
+    double dcx = x0 + t * sx - cx;
+    double dcy = y0 + t * sy - cy;
+
+    return dcx * dcx + dcy * dcy <= r2;
+}
+
+// Keep drone inside [0, world_width] x [0, world_height].
+// Also zero velocity components that point into the wall so we don't keep
+// bouncing or sliding along the boundary forever.
+static void apply_world_bounds(DroneState *d, double world_width, double world_height)
+{
+    if (d->x < 0.0) {
+        d->x = 0.0;
+        if (d->vx < 0.0) d->vx = 0.0;      // kill velocity into left wall
+    } else if (d->x > world_width) {
+        d->x = world_width;
+        if (d->vx > 0.0) d->vx = 0.0;      // kill velocity into right wall
+    }
+
+    if (d->y < 0.0) {
+        d->y = 0.0;
+        if (d->vy < 0.0) d->vy = 0.0;      // kill velocity into bottom wall
+    } else if (d->y > world_height) {
+        d->y = world_height;
+        if (d->vy > 0.0) d->vy = 0.0;      // kill velocity into top wall
+    }
+}
+
+// Zero out very small velocities so we don't get visual jitter from tiny
+// residual motion near equilibrium (especially near walls).
+static void apply_motion_deadzone(DroneState *d)
+{
+    if (fabs(d->vx) < SIM_PHYS_VEL_DEADZONE) d->vx = 0.0;
+    if (fabs(d->vy) < SIM_PHYS_VEL_DEADZONE) d->vy = 0.0;
+}
+
+void sim_physics_step(DroneState      *drone,
+                      double           fx,
+                      double           fy,
+                      const SimParams *params,
+                      double           dt)
+{
+    double ax = (fx - params->damping * drone->vx) / params->mass;
+    double ay = (fy - params->damping * drone->vy) / params->mass;
+
+    drone->vx += ax * dt;
+    drone->vy += ay * dt;
+
+    // Kill tiny velocities to avoid jitter when we're almost at rest
+    apply_motion_deadzone(drone);
+
+    drone->x += drone->vx * dt;
+    drone->y += drone->vy * dt;
+
+    apply_world_bounds(drone,
+                       (double)params->world_width,
+                       (double)params->world_height);
+}
+
+void sim_physics_step_batch(DroneState      *drones,
+                            const double    *fx,
+                            const double    *fy,
+                            int              n,
+                            const SimParams *params,
+                            double           dt)
+{
+    for (int i = 0; i < n; ++i) {
+        sim_physics_step(&drones[i], fx[i], fy[i], params, dt);
+    }
+}
+
+void sim_physics_forces_batch(const SimParams  *params,
+                              const DroneState *queries,
+                              int               m,
+                              const Obstacle   *obstacles,
+                              int               num_obstacles,
+                              double           *out_fx,
+                              double           *out_fy)
+{
+    for (int i = 0; i < m; ++i) {
+        double fx_wall, fy_wall, fx_obs, fy_obs;
+
+        sim_physics_wall_repulsion(params, &queries[i], &fx_wall, &fy_wall);
+        sim_physics_obstacle_repulsion(params, &queries[i],
+                                       obstacles, num_obstacles,
+                                       &fx_obs, &fy_obs);
+
+        out_fx[i] = fx_wall + fx_obs;
+        out_fy[i] = fy_wall + fy_obs;
+    }
+}
+
+int sim_physics_targets_hit(double        x0,
+                            double        y0,
+                            double        x1,
+                            double        y1,
+                            const Target *targets,
+                            int           num_targets,
+                            double        hit_radius,
+                            int          *out_idx,
+                            int           max_hits)
+{
+    int hits = 0;
+
+    for (int i = 0; i < num_targets && hits < max_hits; ++i) {
+        const Target *tgt = &targets[i];
+        if (!tgt->active) {
+            continue;
+        }
+
+        if (sim_physics_segment_hits_circle(x0, y0, x1, y1,
+                                            tgt->x, tgt->y, hit_radius)) {
+            out_idx[hits++] = i;
+        }
+    }
+
+    return hits;
+}
+
+void sim_physics_tindex_init(SimTargetIndex  *ix,
+                             const SimParams *params,
+                             double           hit_radius)
+{
+    double w = (double)params->world_width;
+    double h = (double)params->world_height;
+    if (w < 1.0) w = 1.0;
+    if (h < 1.0) h = 1.0;
+
+    // A few hit radii per cell, grown until the grid fits
+    double cell = 4.0 * hit_radius;
+    if (cell < 1.0) {
+        cell = 1.0;
+    }
+    while (ceil(w / cell) * ceil(h / cell) > (double)SIM_PHYS_TINDEX_MAX_CELLS) {
+        cell *= 2.0;
+    }
+
+    ix->cell  = cell;
+    ix->cols  = (int)ceil(w / cell);
+    ix->rows  = (int)ceil(h / cell);
+    ix->count = 0;
+
+    for (int c = 0; c < ix->cols * ix->rows; ++c) {
+        ix->head[c] = -1;
+    }
+    for (int i = 0; i < SIM_MAX_TARGETS; ++i) {
+        ix->next[i]    = -1;
+        ix->prev[i]    = -1;
+        ix->cell_of[i] = -1;
+        ix->id_of[i]   = 0;
+    }
+    for (int k = 0; k < SIM_PHYS_TINDEX_ID_SLOTS; ++k) {
+        ix->id_key[k]  = 0;
+        ix->id_slot[k] = -1;
+    }
+}
+
+static int tindex_cell(const SimTargetIndex *ix, double x, double y)
+{
+    int c = (int)floor(x / ix->cell);
+    int r = (int)floor(y / ix->cell);
+    if (c < 0) c = 0;
+    if (r < 0) r = 0;
+    if (c > ix->cols - 1) c = ix->cols - 1;
+    if (r > ix->rows - 1) r = ix->rows - 1;
+    return r * ix->cols + c;
+}
+
+static int tindex_home(int id)
+{
+    return (int)(((uint32_t)id * 2654435761u) % SIM_PHYS_TINDEX_ID_SLOTS);
+}
+
+// Position of id in the id table, or -1
+static int tindex_id_pos(const SimTargetIndex *ix, int id)
+{
+    int k = tindex_home(id);
+    for (int n = 0; n < SIM_PHYS_TINDEX_ID_SLOTS; ++n) {
+        if (ix->id_slot[k] < 0) {
+            return -1;
+        }
+        if (ix->id_key[k] == id) {
+            return k;
+        }
+        k = (k + 1) % SIM_PHYS_TINDEX_ID_SLOTS;
+    }
+    return -1;
+}
+
+static void tindex_id_put(SimTargetIndex *ix, int id, int slot)
+{
+    int k = tindex_home(id);
+    while (ix->id_slot[k] >= 0 && ix->id_key[k] != id) {
+        k = (k + 1) % SIM_PHYS_TINDEX_ID_SLOTS;
+    }
+    ix->id_key[k]  = id;
+    ix->id_slot[k] = slot;
+}
+
+// Linear probing delete: shift later entries of the run back (no tombstones)
+static void tindex_id_remove(SimTargetIndex *ix, int id, int slot)
+{
+    int i = tindex_id_pos(ix, id);
+    if (i < 0 || ix->id_slot[i] != slot) {
+        return;
+    }
+
+    int j = i;
+    for (;;) {
+        j = (j + 1) % SIM_PHYS_TINDEX_ID_SLOTS;
+        if (ix->id_slot[j] < 0) {
+            break;
+        }
+        int k = tindex_home(ix->id_key[j]);
+        int stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (stays) {
+            continue;
+        }
+        ix->id_key[i]  = ix->id_key[j];
+        ix->id_slot[i] = ix->id_slot[j];
+        i = j;
+    }
+    ix->id_slot[i] = -1;
+}
+
+void sim_physics_tindex_set(SimTargetIndex *ix, const Target *targets, int slot)
+{
+    if (slot < 0 || slot >= SIM_MAX_TARGETS) {
+        return;
+    }
+
+    // Unlink the old entry
+    int old = ix->cell_of[slot];
+    if (old >= 0) {
+        if (ix->prev[slot] >= 0) {
+            ix->next[ix->prev[slot]] = ix->next[slot];
+        } else {
+            ix->head[old] = ix->next[slot];
+        }
+        if (ix->next[slot] >= 0) {
+            ix->prev[ix->next[slot]] = ix->prev[slot];
+        }
+        tindex_id_remove(ix, ix->id_of[slot], slot);
+        ix->cell_of[slot] = -1;
+        ix->count--;
+    }
+
+    const Target *t = &targets[slot];
+    if (!t->active) {
+        return;
+    }
+
+    int c = tindex_cell(ix, t->x, t->y);
+    ix->prev[slot] = -1;
+    ix->next[slot] = ix->head[c];
+    if (ix->head[c] >= 0) {
+        ix->prev[ix->head[c]] = slot;
+    }
+    ix->head[c]       = slot;
+    ix->cell_of[slot] = c;
+    ix->id_of[slot]   = t->id;
+    tindex_id_put(ix, t->id, slot);
+    ix->count++;
+}
+
+int sim_physics_tindex_find(const SimTargetIndex *ix, int id)
+{
+    int k = tindex_id_pos(ix, id);
+    return (k >= 0) ? ix->id_slot[k] : -1;
+}
+
+int sim_physics_tindex_hit(const SimTargetIndex *ix,
+                           const Target         *targets,
+                           double x0, double y0,
+                           double x1, double y1,
+                           double                hit_radius,
+                           int                  *out_idx,
+                           int                   max_hits)
+{
+    if (ix->count == 0 || max_hits <= 0) {
+        return 0;
+    }
+
+    // Cells overlapped by the segment's bounding box grown by hit_radius
+    double cell = ix->cell;
+    int c0 = (int)floor((fmin(x0, x1) - hit_radius) / cell);
+    int c1 = (int)floor((fmax(x0, x1) + hit_radius) / cell);
+    int r0 = (int)floor((fmin(y0, y1) - hit_radius) / cell);
+    int r1 = (int)floor((fmax(y0, y1) + hit_radius) / cell);
+    if (c0 < 0) c0 = 0;
+    if (r0 < 0) r0 = 0;
+    if (c1 > ix->cols - 1) c1 = ix->cols - 1;
+    if (r1 > ix->rows - 1) r1 = ix->rows - 1;
+
+    // Each slot lives in exactly one cell: no duplicates to filter
+    int hits[SIM_MAX_TARGETS];
+    int n = 0;
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            for (int i = ix->head[r * ix->cols + c]; i >= 0; i = ix->next[i]) {
+                const Target *t = &targets[i];
+                if (sim_physics_segment_hits_circle(x0, y0, x1, y1,
+                                                    t->x, t->y, hit_radius)) {
+                    hits[n++] = i;
+                }
+            }
+        }
+    }
+
+    // Ascending slots, like the linear scan
+    for (int a = 1; a < n; ++a) {
+        int v = hits[a];
+        int b = a - 1;
+        while (b >= 0 && hits[b] > v) {
+            hits[b + 1] = hits[b];
+            b--;
+        }
+        hits[b + 1] = v;
+    }
+
+    if (n > max_hits) {
+        n = max_hits;
+    }
+    memcpy(out_idx, hits, sizeof(int) * (size_t)n);
+    return n;
+}
+
+_Static_assert(SIM_MAX_TARGETS <= SIM_PHYS_KIN_MAX, "targets must fit SimKinematics");
+
+void sim_physics_kin_init(SimKinematics *k, const SimParams *params, int count)
+{
+    if (count > SIM_PHYS_KIN_MAX) {
+        count = SIM_PHYS_KIN_MAX;
+    }
+    memset(k, 0, sizeof(*k));
+    k->width  = (double)params->world_width;
+    k->height = (double)params->world_height;
+    k->count  = (count > 0) ? count : 0;
+    for (int i = 0; i < SIM_PHYS_KIN_MAX; ++i) {
+        k->span_x[i] = 1.0;
+        k->span_y[i] = 1.0;
+    }
+}
+
+// One axis of a moving slot: band [lo, lo + span], start clamped into it
+static void kin_axis(double p, double size, double radius,
+                     double *lo, double *span, double *u0)
+{
+    double s = size - 2.0 * radius;
+    if (s < 1e-6) {
+        // No room to move: bounce in place around the middle
+        s      = 1e-6;
+        radius = 0.5 * (size - s);
+    }
+    *lo   = radius;
+    *span = s;
+
+    double u = p - radius;
+    if (u < 0.0) u = 0.0;
+    if (u > s)   u = s;
+    *u0 = u;
+}
+
+void sim_physics_kin_set(SimKinematics *k, int slot,
+                         double x, double y, double vx, double vy,
+                         double radius, double t0)
+{
+    if (slot < 0 || slot >= k->count) {
+        return;
+    }
+
+    int was_moving = (k->vx[slot] != 0.0 || k->vy[slot] != 0.0);
+    int is_moving  = (vx != 0.0 || vy != 0.0);
+    k->moving += is_moving - was_moving;
+
+    k->t0[slot] = t0;
+    k->vx[slot] = vx;
+    k->vy[slot] = vy;
+
+    if (is_moving) {
+        kin_axis(x, k->width,  radius, &k->lo_x[slot], &k->span_x[slot], &k->u0x[slot]);
+        kin_axis(y, k->height, radius, &k->lo_y[slot], &k->span_y[slot], &k->u0y[slot]);
+    } else {
+        // Fold of a zero offset is zero: the position comes back exactly
+        k->lo_x[slot]   = x;
+        k->lo_y[slot]   = y;
+        k->span_x[slot] = 1.0;
+        k->span_y[slot] = 1.0;
+        k->u0x[slot]    = 0.0;
+        k->u0y[slot]    = 0.0;
+    }
+    k->x[slot]   = k->lo_x[slot] + k->u0x[slot];
+    k->y[slot]   = k->lo_y[slot] + k->u0y[slot];
+    k->cvx[slot] = vx;
+    k->cvy[slot] = vy;
+}
+
+void sim_physics_kin_advance(SimKinematics *k, double t)
+{
+    const int n = k->count;
+
+    // Unfolded offset u = u0 + v (t - t0), reduced to one period 2 span:
+    // the way out is u itself, the way back 2 span - u (velocity flipped)
+    for (int i = 0; i < n; ++i) {
+        double dt = t - k->t0[i];
+
+        double px = 2.0 * k->span_x[i];
+        double ux = k->u0x[i] + k->vx[i] * dt;
+        ux -= px * floor(ux / px);
+        k->x[i]   = k->lo_x[i] + fmin(ux, px - ux);
+        k->cvx[i] = (ux <= k->span_x[i]) ? k->vx[i] : -k->vx[i];
+
+        double py = 2.0 * k->span_y[i];
+        double uy = k->u0y[i] + k->vy[i] * dt;
+        uy -= py * floor(uy / py);
+        k->y[i]   = k->lo_y[i] + fmin(uy, py - uy);
+        k->cvy[i] = (uy <= k->span_y[i]) ? k->vy[i] : -k->vy[i];
+    }
+}
+
+void sim_physics_kin_set_obstacles(SimKinematics *k, const Obstacle *obstacles,
+                                   int slots, double t0)
+{
+    for (int i = 0; i < slots && i < k->count; ++i) {
+        const Obstacle *o = &obstacles[i];
+        if (o->active) {
+            sim_physics_kin_set(k, i, o->x, o->y, o->vx, o->vy, o->radius, t0);
+        } else {
+            sim_physics_kin_set(k, i, 0.0, 0.0, 0.0, 0.0, 0.0, t0);
+        }
+    }
+}
+
+void sim_physics_kin_set_target(SimKinematics *k, const Target *targets,
+                                int slot, double t0)
+{
+    const Target *tg = &targets[slot];
+    if (tg->active) {
+        sim_physics_kin_set(k, slot, tg->x, tg->y, tg->vx, tg->vy, tg->radius, t0);
+    } else {
+        sim_physics_kin_set(k, slot, 0.0, 0.0, 0.0, 0.0, 0.0, t0);
+    }
+}
+
+void sim_physics_kin_get_obstacles(const SimKinematics *k, Obstacle *obstacles, int slots)
+{
+    for (int i = 0; i < slots && i < k->count; ++i) {
+        Obstacle *o = &obstacles[i];
+        if (o->active) {
+            o->x  = k->x[i];
+            o->y  = k->y[i];
+            o->vx = k->cvx[i];
+            o->vy = k->cvy[i];
+        }
+    }
+}
+
+void sim_physics_kin_get_targets(const SimKinematics *k, Target *targets, int slots)
+{
+    for (int i = 0; i < slots && i < k->count; ++i) {
+        Target *tg = &targets[i];
+        if (tg->active) {
+            tg->x  = k->x[i];
+            tg->y  = k->y[i];
+            tg->vx = k->cvx[i];
+            tg->vy = k->cvy[i];
+        }
+    }
+}
+
+void sim_physics_grid_build(SimObstacleGrid *grid,
+                            const SimParams *params,
+                            const Obstacle  *obstacles,
+                            int              num_obstacles)
+{
+    double w = (double)params->world_width;
+    double h = (double)params->world_height;
+    if (w < 1.0) w = 1.0;
+    if (h < 1.0) h = 1.0;
+
+    // Cells roughly one obstacle across, grown until the grid fits
+    double max_r = 0.0;
+    for (int i = 0; i < num_obstacles; ++i) {
+        if (obstacles[i].active && obstacles[i].radius > max_r) {
+            max_r = obstacles[i].radius;
+        }
+    }
+
+    double cell = 2.0 * max_r;
+    if (cell < 1.0) {
+        cell = 1.0;
+    }
+    while (ceil(w / cell) * ceil(h / cell) > (double)SIM_PHYS_GRID_MAX_CELLS) {
+        cell *= 2.0;
+    }
+
+    grid->cell     = cell;
+    grid->cols     = (int)ceil(w / cell);
+    grid->rows     = (int)ceil(h / cell);
+    grid->overflow = 0;
+
+    int num_cells = grid->cols * grid->rows;
+    memset(grid->cell_start, 0, sizeof(int) * (size_t)(num_cells + 1));
+
+    // Pass 1: count obstacles per cell (shifted by one for the prefix sum)
+    int total = 0;
+    for (int i = 0; i < num_obstacles; ++i) {
+        const Obstacle *o = &obstacles[i];
+        if (!o->active) {
+            continue;
+        }
+
+        int c0 = (int)floor((o->x - o->radius) / cell);
+        int c1 = (int)floor((o->x + o->radius) / cell);
+        int r0 = (int)floor((o->y - o->radius) / cell);
+        int r1 = (int)floor((o->y + o->radius) / cell);
+        if (c0 < 0) c0 = 0;
+        if (r0 < 0) r0 = 0;
+        if (c1 > grid->cols - 1) c1 = grid->cols - 1;
+        if (r1 > grid->rows - 1) r1 = grid->rows - 1;
+
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                grid->cell_start[r * grid->cols + c + 1]++;
+                total++;
+            }
+        }
+    }
+
+    if (total > SIM_PHYS_GRID_MAX_ITEMS) {
+        grid->overflow = 1;
+        return;
+    }
+
+    for (int c = 0; c < num_cells; ++c) {
+        grid->cell_start[c + 1] += grid->cell_start[c];
+    }
+
+    // Pass 2: scatter obstacle indices into their cells
+    int fill[SIM_PHYS_GRID_MAX_CELLS];
+    memcpy(fill, grid->cell_start, sizeof(int) * (size_t)num_cells);
+
+    for (int i = 0; i < num_obstacles; ++i) {
+        const Obstacle *o = &obstacles[i];
+        if (!o->active) {
+            continue;
+        }
+
+        int c0 = (int)floor((o->x - o->radius) / cell);
+        int c1 = (int)floor((o->x + o->radius) / cell);
+        int r0 = (int)floor((o->y - o->radius) / cell);
+        int r1 = (int)floor((o->y + o->radius) / cell);
+        if (c0 < 0) c0 = 0;
+        if (r0 < 0) r0 = 0;
+        if (c1 > grid->cols - 1) c1 = grid->cols - 1;
+        if (r1 > grid->rows - 1) r1 = grid->rows - 1;
+
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                grid->items[fill[r * grid->cols + c]++] = i;
+            }
+        }
+    }
+}
+
+// Time of impact of p0 + t * s (t in [0,1]) with circle (cx,cy,r), or -1
+static double sweep_circle(double x0, double y0,
+                           double sx, double sy,
+                           double cx, double cy,
+                           double r)
+{
+    double fx = x0 - cx;
+    double fy = y0 - cy;
+
+    double c = fx * fx + fy * fy - r * r;
+    if (c <= 0.0) {
+        return -1.0;  // already inside: let the drone leave
+    }
+
+    double a = sx * sx + sy * sy;
+    if (a <= 1e-12) {
+        return -1.0;
+    }
+
+    double b = 2.0 * (fx * sx + fy * sy);
+    if (b >= 0.0) {
+        return -1.0;  // moving away from the center
+    }
+
+    double disc = b * b - 4.0 * a * c;
+    if (disc < 0.0) {
+        return -1.0;
+    }
+
+    double t = (-b - sqrt(disc)) / (2.0 * a);
+    return (t >= 0.0 && t <= 1.0) ? t : -1.0;
+}
+
+int sim_physics_sweep_obstacles(const SimObstacleGrid *grid,
+                                const Obstacle        *obstacles,
+                                int                    num_obstacles,
+                                double x0, double y0,
+                                double x1, double y1,
+                                double *out_t,
+                                double *out_nx,
+                                double *out_ny)
+{
+    double sx = x1 - x0;
+    double sy = y1 - y0;
+
+    int    best   = -1;
+    double best_t = 2.0;
+
+    if (num_obstacles > SIM_MAX_OBSTACLES) {
+        num_obstacles = SIM_MAX_OBSTACLES;
+    }
+
+    if (grid == NULL || grid->overflow) {
+        // Narrow phase only
+        for (int i = 0; i < num_obstacles; ++i) {
+            const Obstacle *o = &obstacles[i];
+            if (!o->active) {
+                continue;
+            }
+            double t = sweep_circle(x0, y0, sx, sy, o->x, o->y, o->radius);
+            if (t >= 0.0 && t < best_t) {
+                best_t = t;
+                best   = i;
+            }
+        }
+    } else {
+        // Broad phase: only the cells overlapped by the motion's bounding box
+        double cell = grid->cell;
+        int c0 = (int)floor(fmin(x0, x1) / cell);
+        int c1 = (int)floor(fmax(x0, x1) / cell);
+        int r0 = (int)floor(fmin(y0, y1) / cell);
+        int r1 = (int)floor(fmax(y0, y1) / cell);
+        if (c0 < 0) c0 = 0;
+        if (r0 < 0) r0 = 0;
+        if (c1 > grid->cols - 1) c1 = grid->cols - 1;
+        if (r1 > grid->rows - 1) r1 = grid->rows - 1;
+
+        unsigned char seen[SIM_MAX_OBSTACLES];
+        memset(seen, 0, sizeof(seen));
+
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                int cell_idx = r * grid->cols + c;
+                for (int k = grid->cell_start[cell_idx];
+                     k < grid->cell_start[cell_idx + 1]; ++k) {
+                    int i = grid->items[k];
+                    if (i >= num_obstacles || seen[i]) {
+                        continue;
+                    }
+                    seen[i] = 1;
+
+                    const Obstacle *o = &obstacles[i];
+                    if (!o->active) {
+                        continue;
+                    }
+                    double t = sweep_circle(x0, y0, sx, sy, o->x, o->y, o->radius);
+                    if (t >= 0.0 && t < best_t) {
+                        best_t = t;
+                        best   = i;
+                    }
+                }
+            }
+        }
+    }
+
+    if (best < 0) {
+        return -1;
+    }
+
+    const Obstacle *o = &obstacles[best];
+    double px = x0 + best_t * sx - o->x;
+    double py = y0 + best_t * sy - o->y;
+    double len = sqrt(px * px + py * py);
+
+    *out_t  = best_t;
+    *out_nx = (len > 0.0) ? px / len : 0.0;
+    *out_ny = (len > 0.0) ? py / len : 0.0;
+    return best;
+}
+
+int sim_physics_resolve_collision(DroneState            *drone,
+                                  double                 x0,
+                                  double                 y0,
+                                  const SimObstacleGrid *grid,
+                                  const Obstacle        *obstacles,
+                                  int                    num_obstacles,
+                                  const SimParams       *params)
+{
+    if (params->collision_response == SIM_COLLISION_OFF || num_obstacles <= 0) {
+        return -1;
+    }
+
+    double t, nx, ny;
+    int idx = sim_physics_sweep_obstacles(grid, obstacles, num_obstacles,
+                                          x0, y0, drone->x, drone->y,
+                                          &t, &nx, &ny);
+    if (idx < 0) {
+        return -1;
+    }
+
+    // Back to the contact point, nudged out so the next sweep starts outside
+    const double skin = 1e-6;
+    drone->x = x0 + t * (drone->x - x0) + nx * skin;
+    drone->y = y0 + t * (drone->y - y0) + ny * skin;
+
+    double vn = drone->vx * nx + drone->vy * ny;
+    if (vn < 0.0) {
+        double k = 1.0;  // STOP: remove the normal component, keep sliding
+        if (params->collision_response == SIM_COLLISION_BOUNCE) {
+            k = 1.0 + params->restitution;
+        }
+        drone->vx -= k * vn * nx;
+        drone->vy -= k * vn * ny;
+    }
+
+    return idx;
+}
+
+int sim_physics_step_adaptive(DroneState      *drone,
+                              double           fx,
+                              double           fy,
+                              const SimParams *params,
+                              const SimEnv    *env,
+                              double           dt,
+                              int             *out_hit)
+{
+    int    max_steps = (params->max_substeps > 0) ? params->max_substeps : 1;
+    double remaining = dt;
+    int    steps     = 0;
+
+    *out_hit = -1;
+
+    while (remaining > 0.0 && steps < max_steps) {
+        double fx_wall, fy_wall, fx_obs, fy_obs;
+
+        sim_physics_env_repulsion(params, env, drone,
+                                  &fx_wall, &fy_wall, &fx_obs, &fy_obs);
+
+        double fx_rep = fx_wall + fx_obs;
+        double fy_rep = fy_wall + fy_obs;
+
+        double h = remaining;
+
+        if (steps < max_steps - 1) {
+            double speed = sqrt(drone->vx * drone->vx + drone->vy * drone->vy);
+            double k_rep = 0.0;
+            if (speed > 0.0) {
+                k_rep = sqrt(fx_rep * fx_rep + fy_rep * fy_rep) / speed;
+            }
+
+            double k_eff = params->damping + k_rep;
+            if (k_eff > 0.0) {
+                double h_stab = SIM_PHYS_SUBSTEP_SAFETY * params->mass / k_eff;
+                if (h_stab < h) h = h_stab;
+            }
+
+            if (k_rep > 0.0 && speed > 0.0) {
+                double h_move = SIM_PHYS_SUBSTEP_MOVE * params->rho / speed;
+                if (h_move < h) h = h_move;
+            }
+
+            // Spread the time evenly instead of leaving a tiny last step;
+            // clamp as a double, a tiny h would overflow the int
+            double nd = ceil(remaining / h);
+            if (nd > (double)(max_steps - steps)) {
+                nd = (double)(max_steps - steps);
+            }
+            int n = (int)nd;
+            h = remaining / (double)n;
+        }
+
+        double x0 = drone->x;
+        double y0 = drone->y;
+
+        sim_physics_step(drone, fx + fx_rep, fy + fy_rep, params, h);
+
+        int hit = sim_physics_resolve_collision(drone, x0, y0, env->grid,
+                                                env->obstacles, env->num_obstacles,
+                                                params);
+        if (hit >= 0 && *out_hit < 0) {
+            *out_hit = hit;
+        }
+
+        remaining -= h;
+        steps++;
+    }
+
+    return steps;
+}
@@ -0,0 +1,156 @@
+// Profiler zones and Chrome trace output (see sim_prof.h).
+// Only built with SIM_PROFILE.
+
+#define _GNU_SOURCE   // gettid, program_invocation_short_name
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_ipc.h"    // write_full
+#include "sim_prof.h"
+
+typedef struct {
+    const char *name;
+    uint64_t    start_ns;
+    uint64_t    dur_ns;
+} SimProfEvent;
+
+// Per thread: events not written yet, and whether the thread's name
+// was written to the trace already
+static _Thread_local SimProfEvent *t_events   = NULL;
+static _Thread_local int           t_count    = 0;
+static _Thread_local int           t_named    = 0;
+static _Thread_local char          t_name[32] = "";
+
+// Longest line sim_prof_flush() writes per event
+#define SIM_PROF_LINE_MAX 160
+
+static uint64_t sim_prof_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static const char *sim_prof_path(void)
+{
+    const char *path = getenv(SIM_PROF_FILE_ENV);
+    return (path != NULL && path[0] != '\0') ? path : SIM_PROF_DEFAULT_FILE;
+}
+
+int sim_prof_open(void)
+{
+    const char *path = sim_prof_path();
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    static const char head[] = "[\n";
+    ssize_t n = write_full(fd, head, sizeof(head) - 1);
+    close(fd);
+    if (n != (ssize_t)(sizeof(head) - 1)) {
+        return -1;
+    }
+    return setenv(SIM_PROF_FILE_ENV, path, 1);
+}
+
+void sim_prof_thread(const char *name)
+{
+    snprintf(t_name, sizeof(t_name), "%s", name);
+    t_named = 0;
+}
+
+SimProfZone sim_prof_begin(const char *name)
+{
+    SimProfZone z = { name, sim_prof_now_ns() };
+    return z;
+}
+
+void sim_prof_end(SimProfZone *zone)
+{
+    uint64_t end = sim_prof_now_ns();
+
+    if (t_events == NULL) {
+        t_events = malloc(SIM_PROF_RING * sizeof(*t_events));
+        if (t_events == NULL) {
+            return;
+        }
+    }
+
+    SimProfEvent *ev = &t_events[t_count++];
+    ev->name     = zone->name;
+    ev->start_ns = zone->start_ns;
+    ev->dur_ns   = end - zone->start_ns;
+
+    // Full: write it out now, the flush shows up as a zone of its own
+    if (t_count == SIM_PROF_RING) {
+        uint64_t flush_start = sim_prof_now_ns();
+        sim_prof_flush();
+        t_events[0].name     = "sim_prof_flush";
+        t_events[0].start_ns = flush_start;
+        t_events[0].dur_ns   = sim_prof_now_ns() - flush_start;
+        t_count = 1;
+    }
+}
+
+void sim_prof_flush(void)
+{
+    if (t_count == 0 && t_named) {
+        return;
+    }
+
+    size_t cap = (size_t)(t_count + 2) * SIM_PROF_LINE_MAX;
+    char  *buf = malloc(cap);
+    if (buf == NULL) {
+        return;
+    }
+
+    int    pid = (int)getpid();
+    int    tid = (int)gettid();
+    size_t len = 0;
+
+    // Metadata once per thread: process and thread names in the viewer
+    if (!t_named) {
+        len += (size_t)snprintf(buf + len, cap - len,
+                                "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                                "\"args\":{\"name\":\"%s\"}},\n",
+                                pid, program_invocation_short_name);
+        len += (size_t)snprintf(buf + len, cap - len,
+                                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                                "\"args\":{\"name\":\"%s\"}},\n",
+                                pid, tid, t_name[0] != '\0' ? t_name : "thread");
+        t_named = 1;
+    }
+
+    // Trace-event times are microseconds
+    for (int i = 0; i < t_count; ++i) {
+        const SimProfEvent *ev = &t_events[i];
+        len += (size_t)snprintf(buf + len, cap - len,
+                                "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                                "\"ts\":%.3f,\"dur\":%.3f},\n",
+                                ev->name, pid, tid,
+                                (double)ev->start_ns * 1e-3, (double)ev->dur_ns * 1e-3);
+        if (len >= cap) {
+            len = cap - 1;
+            break;
+        }
+    }
+    t_count = 0;
+
+    // One O_APPEND write per flush: chunks of different threads and
+    // processes do not interleave
+    int fd = open(sim_prof_path(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd >= 0) {
+        if (write_full(fd, buf, len) != (ssize_t)len) {
+            perror("sim_prof: write");
+        }
+        close(fd);
+    }
+    free(buf);
+}
@@ -0,0 +1,493 @@
+// Framed little-endian wire protocol (see sim_proto.h).
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim_ipc.h"
+#include "sim_log.h"
+#include "sim_proto.h"
+
+// Payload sizes per type
+#define SIM_PROTO_COMMAND_SIZE      11
+#define SIM_PROTO_STATE_SIZE        16
+#define SIM_PROTO_LIST_HEADER_SIZE  4
+#define SIM_PROTO_SET_HEADER_SIZE   8   // list header + u32 epoch
+#define SIM_PROTO_OBSTACLE_SIZE     22
+#define SIM_PROTO_TARGET_SIZE       26
+#define SIM_PROTO_HITS_HEADER_SIZE  6
+#define SIM_PROTO_HIT_SIZE          4
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void put_f32(uint8_t *p, double v)
+{
+    float    f = (float)v;
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    put_u32(p, u);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static double get_f32(const uint8_t *p)
+{
+    uint32_t u = get_u32(p);
+    float    f;
+    memcpy(&f, &u, sizeof(f));
+    return (double)f;
+}
+
+static uint32_t sim_proto_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u);
+}
+
+void sim_proto_writer_init(SimMsgWriter *w)
+{
+    w->seq = 0;
+    w->len = 0;
+}
+
+void sim_proto_reader_init(SimMsgReader *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+// Reserve a frame of payload_len bytes, write its header, return the payload
+static uint8_t *sim_proto_begin(SimMsgWriter *w, uint8_t type, size_t payload_len)
+{
+    if (w->len + SIM_PROTO_HEADER_SIZE + payload_len > sizeof(w->buf)) {
+        return NULL;
+    }
+
+    uint8_t *h = w->buf + w->len;
+    h[0] = SIM_PROTO_MAGIC;
+    h[1] = SIM_PROTO_VERSION;
+    h[2] = type;
+    h[3] = 0;
+    put_u16(h + 4, (uint16_t)payload_len);
+    put_u16(h + 6, w->seq++);
+    put_u32(h + 8, sim_proto_time_us());
+
+    w->len += SIM_PROTO_HEADER_SIZE + payload_len;
+    return h + SIM_PROTO_HEADER_SIZE;
+}
+
+int sim_proto_put_command(SimMsgWriter *w, const CommandState *c)
+{
+    uint8_t *p = sim_proto_begin(w, SIM_MSG_COMMAND, SIM_PROTO_COMMAND_SIZE);
+    if (p == NULL) {
+        return -1;
+    }
+    put_f32(p + 0, c->fx);
+    put_f32(p + 4, c->fy);
+    p[8] = (uint8_t)((c->brake ? 1 : 0) | (c->reset ? 2 : 0) | (c->quit ? 4 : 0));
+    put_u16(p + 9, (uint16_t)(int16_t)c->last_key);
+    return 0;
+}
+
+int sim_proto_put_drone_state(SimMsgWriter *w, const DroneState *d)
+{
+    uint8_t *p = sim_proto_begin(w, SIM_MSG_DRONE_STATE, SIM_PROTO_STATE_SIZE);
+    if (p == NULL) {
+        return -1;
+    }
+    put_f32(p + 0,  d->x);
+    put_f32(p + 4,  d->y);
+    put_f32(p + 8,  d->vx);
+    put_f32(p + 12, d->vy);
+    return 0;
+}
+
+int sim_proto_put_obstacles(SimMsgWriter *w, const Obstacle *o, int slots)
+{
+    int count = 0;
+    for (int i = 0; i < slots; ++i) {
+        count += (o[i].active != 0);
+    }
+
+    uint8_t *p = sim_proto_begin(w, SIM_MSG_OBSTACLES,
+                                 SIM_PROTO_LIST_HEADER_SIZE +
+                                 (size_t)count * SIM_PROTO_OBSTACLE_SIZE);
+    if (p == NULL) {
+        return -1;
+    }
+    put_u16(p + 0, (uint16_t)slots);
+    put_u16(p + 2, (uint16_t)count);
+    p += SIM_PROTO_LIST_HEADER_SIZE;
+
+    for (int i = 0; i < slots; ++i) {
+        if (!o[i].active) {
+            continue;
+        }
+        put_u16(p + 0,  (uint16_t)i);
+        put_f32(p + 2,  o[i].x);
+        put_f32(p + 6,  o[i].y);
+        put_f32(p + 10, o[i].radius);
+        put_f32(p + 14, o[i].vx);
+        put_f32(p + 18, o[i].vy);
+        p += SIM_PROTO_OBSTACLE_SIZE;
+    }
+    return 0;
+}
+
+// One target list entry; an inactive slot goes out with id 0
+static uint8_t *put_target(uint8_t *p, int slot, const Target *t)
+{
+    put_u16(p + 0,  (uint16_t)slot);
+    put_u32(p + 2,  t->active ? (uint32_t)t->id : 0u);
+    put_f32(p + 6,  t->x);
+    put_f32(p + 10, t->y);
+    put_f32(p + 14, t->radius);
+    put_f32(p + 18, t->vx);
+    put_f32(p + 22, t->vy);
+    return p + SIM_PROTO_TARGET_SIZE;
+}
+
+int sim_proto_put_targets(SimMsgWriter *w, const Target *t, int slots,
+                          uint32_t epoch)
+{
+    int count = 0;
+    for (int i = 0; i < slots; ++i) {
+        count += (t[i].active != 0);
+    }
+
+    uint8_t *p = sim_proto_begin(w, SIM_MSG_TARGETS,
+                                 SIM_PROTO_SET_HEADER_SIZE +
+                                 (size_t)count * SIM_PROTO_TARGET_SIZE);
+    if (p == NULL) {
+        return -1;
+    }
+    put_u16(p + 0, (uint16_t)slots);
+    put_u16(p + 2, (uint16_t)count);
+    put_u32(p + 4, epoch);
+    p += SIM_PROTO_SET_HEADER_SIZE;
+
+    for (int i = 0; i < slots; ++i) {
+        if (!t[i].active) {
+            continue;
+        }
+        p = put_target(p, i, &t[i]);
+    }
+    return 0;
+}
+
+int sim_proto_put_target_changes(SimMsgWriter *w, const Target *t,
+                                 const int *changed, int n, int slots)
+{
+    uint8_t *p = sim_proto_begin(w, SIM_MSG_TARGET_CHANGES,
+                                 SIM_PROTO_LIST_HEADER_SIZE +
+                                 (size_t)n * SIM_PROTO_TARGET_SIZE);
+    if (p == NULL) {
+        return -1;
+    }
+    put_u16(p + 0, (uint16_t)slots);
+    put_u16(p + 2, (uint16_t)n);
+    p += SIM_PROTO_LIST_HEADER_SIZE;
+
+    for (int k = 0; k < n; ++k) {
+        p = put_target(p, changed[k], &t[changed[k]]);
+    }
+    return 0;
+}
+
+int sim_proto_put_target_hits(SimMsgWriter *w, uint32_t epoch,
+                              const int *ids, int n)
+{
+    uint8_t *p = sim_proto_begin(w, SIM_MSG_TARGET_HITS,
+                                 SIM_PROTO_HITS_HEADER_SIZE +
+                                 (size_t)n * SIM_PROTO_HIT_SIZE);
+    if (p == NULL) {
+        return -1;
+    }
+    put_u16(p + 0, (uint16_t)n);
+    put_u32(p + 2, epoch);
+    p += SIM_PROTO_HITS_HEADER_SIZE;
+
+    for (int k = 0; k < n; ++k, p += SIM_PROTO_HIT_SIZE) {
+        put_u32(p, (uint32_t)ids[k]);
+    }
+    return 0;
+}
+
+int sim_proto_flush(int fd, SimMsgWriter *w)
+{
+    if (w->len == 0) {
+        return 0;
+    }
+    ssize_t n = write_full(fd, w->buf, w->len);
+    int ok = (n == (ssize_t)w->len);
+    w->len = 0;
+    return ok ? 0 : -1;
+}
+
+int sim_proto_queue(SimIpcTx *q, SimMsgWriter *w, SimIpcTxPolicy policy)
+{
+    if (w->len == 0) {
+        return 0;
+    }
+    int rc = sim_ipc_tx_push(q, w->buf, w->len, w->buf[2], policy);
+    w->len = 0;
+    return rc;
+}
+
+static int sim_proto_header_valid(const uint8_t *h)
+{
+    return h[0] == SIM_PROTO_MAGIC && h[1] == SIM_PROTO_VERSION &&
+           get_u16(h + 4) <= SIM_PROTO_MAX_PAYLOAD;
+}
+
+static void sim_proto_header_get(const uint8_t *h, SimMsg *m)
+{
+    m->h.type    = h[2];
+    m->h.flags   = h[3];
+    m->h.length  = get_u16(h + 4);
+    m->h.seq     = get_u16(h + 6);
+    m->h.time_us = get_u32(h + 8);
+}
+
+// Sequence / frame accounting for a frame that was read whole
+static void sim_proto_count(SimMsgReader *r, const SimMsg *m)
+{
+    if (r->have_seq && m->h.seq != r->next_seq) {
+        r->gaps += (uint16_t)(m->h.seq - r->next_seq);
+    }
+    r->next_seq = (uint16_t)(m->h.seq + 1);
+    r->have_seq = 1;
+    r->frames++;
+}
+
+size_t sim_proto_decode(const void *buf, size_t len, SimMsgReader *r, SimMsg *m)
+{
+    const uint8_t *h = buf;
+
+    if (len < SIM_PROTO_HEADER_SIZE || !sim_proto_header_valid(h)) {
+        return 0;
+    }
+    sim_proto_header_get(h, m);
+    if (len - SIM_PROTO_HEADER_SIZE < m->h.length) {
+        return 0;
+    }
+
+    memcpy(m->payload, h + SIM_PROTO_HEADER_SIZE, m->h.length);
+    sim_proto_count(r, m);
+    return SIM_PROTO_HEADER_SIZE + m->h.length;
+}
+
+int sim_proto_next(SimIpcRx *rx, SimMsgReader *r, SimMsg *m)
+{
+    size_t skip = 0;
+    while (rx->len - skip >= SIM_PROTO_HEADER_SIZE &&
+           !sim_proto_header_valid(rx->buf + skip)) {
+        skip++;
+    }
+    if (skip > 0) {
+        if (r->resync_bytes == 0) {
+            sim_log_info("proto: invalid frame header in receive buffer, resynchronizing");
+        }
+        r->resync_bytes += skip;
+        sim_ipc_rx_consume(rx, skip);
+    }
+
+    size_t used = sim_proto_decode(rx->buf, rx->len, r, m);
+    if (used == 0) {
+        return 0;
+    }
+    sim_ipc_rx_consume(rx, used);
+    return 1;
+}
+
+int sim_proto_get_command(const SimMsg *m, CommandState *c)
+{
+    if (m->h.type != SIM_MSG_COMMAND || m->h.length != SIM_PROTO_COMMAND_SIZE) {
+        return -1;
+    }
+    const uint8_t *p = m->payload;
+    c->fx       = get_f32(p + 0);
+    c->fy       = get_f32(p + 4);
+    c->brake    = (p[8] & 1) != 0;
+    c->reset    = (p[8] & 2) != 0;
+    c->quit     = (p[8] & 4) != 0;
+    c->last_key = (int16_t)get_u16(p + 9);
+    return 0;
+}
+
+int sim_proto_get_drone_state(const SimMsg *m, DroneState *d)
+{
+    if (m->h.type != SIM_MSG_DRONE_STATE || m->h.length != SIM_PROTO_STATE_SIZE) {
+        return -1;
+    }
+    const uint8_t *p = m->payload;
+    d->x  = get_f32(p + 0);
+    d->y  = get_f32(p + 4);
+    d->vx = get_f32(p + 8);
+    d->vy = get_f32(p + 12);
+    return 0;
+}
+
+// Common checks for the list messages; returns the entry count or -1
+static int sim_proto_list_count(const SimMsg *m, int type, size_t header_size,
+                                size_t entry_size)
+{
+    if (m->h.type != type || m->h.length < header_size) {
+        return -1;
+    }
+    int count = get_u16(m->payload + 2);
+    if ((size_t)m->h.length != header_size + (size_t)count * entry_size) {
+        return -1;
+    }
+    return count;
+}
+
+int sim_proto_get_obstacles(const SimMsg *m, Obstacle *o, int slots)
+{
+    int count = sim_proto_list_count(m, SIM_MSG_OBSTACLES, SIM_PROTO_LIST_HEADER_SIZE,
+                                     SIM_PROTO_OBSTACLE_SIZE);
+    if (count < 0) {
+        return -1;
+    }
+
+    memset(o, 0, (size_t)slots * sizeof(*o));
+
+    int active = 0;
+    const uint8_t *p = m->payload + SIM_PROTO_LIST_HEADER_SIZE;
+    for (int k = 0; k < count; ++k, p += SIM_PROTO_OBSTACLE_SIZE) {
+        int i = get_u16(p);
+        if (i >= slots) {
+            continue;  // sender has a bigger cap than we do
+        }
+        o[i].x      = get_f32(p + 2);
+        o[i].y      = get_f32(p + 6);
+        o[i].radius = get_f32(p + 10);
+        o[i].vx     = get_f32(p + 14);
+        o[i].vy     = get_f32(p + 18);
+        o[i].active = 1;
+        active++;
+    }
+    return active;
+}
+
+int sim_proto_get_targets(const SimMsg *m, Target *t, int slots, uint32_t *epoch)
+{
+    int count = sim_proto_list_count(m, SIM_MSG_TARGETS, SIM_PROTO_SET_HEADER_SIZE,
+                                     SIM_PROTO_TARGET_SIZE);
+    if (count < 0) {
+        return -1;
+    }
+    if (epoch != NULL) {
+        *epoch = get_u32(m->payload + 4);
+    }
+
+    memset(t, 0, (size_t)slots * sizeof(*t));
+
+    int active = 0;
+    const uint8_t *p = m->payload + SIM_PROTO_SET_HEADER_SIZE;
+    for (int k = 0; k < count; ++k, p += SIM_PROTO_TARGET_SIZE) {
+        int i = get_u16(p);
+        if (i >= slots) {
+            continue;
+        }
+        t[i].id     = (int)get_u32(p + 2);
+        t[i].x      = get_f32(p + 6);
+        t[i].y      = get_f32(p + 10);
+        t[i].radius = get_f32(p + 14);
+        t[i].vx     = get_f32(p + 18);
+        t[i].vy     = get_f32(p + 22);
+        t[i].active = 1;
+        active++;
+    }
+    return active;
+}
+
+int sim_proto_get_target_changes(const SimMsg *m, Target *t, int slots, int *changed)
+{
+    int count = sim_proto_list_count(m, SIM_MSG_TARGET_CHANGES, SIM_PROTO_LIST_HEADER_SIZE,
+                                     SIM_PROTO_TARGET_SIZE);
+    if (count < 0) {
+        return -1;
+    }
+
+    int n = 0;
+    const uint8_t *p = m->payload + SIM_PROTO_LIST_HEADER_SIZE;
+    for (int k = 0; k < count; ++k, p += SIM_PROTO_TARGET_SIZE) {
+        int i = get_u16(p);
+        if (i >= slots) {
+            continue;
+        }
+        memset(&t[i], 0, sizeof(t[i]));
+        t[i].id = (int)get_u32(p + 2);
+        if (t[i].id != 0) {
+            t[i].x      = get_f32(p + 6);
+            t[i].y      = get_f32(p + 10);
+            t[i].radius = get_f32(p + 14);
+            t[i].vx     = get_f32(p + 18);
+            t[i].vy     = get_f32(p + 22);
+            t[i].active = 1;
+        }
+
+        // A repeated slot keeps its last entry and is listed once, so
+        // n never exceeds slots
+        int seen = 0;
+        for (int c = 0; c < n && !seen; ++c) {
+            seen = (changed[c] == i);
+        }
+        if (!seen) {
+            changed[n++] = i;
+        }
+    }
+    return n;
+}
+
+int sim_proto_get_target_hits(const SimMsg *m, uint32_t *epoch, int *ids, int max)
+{
+    if (m->h.type != SIM_MSG_TARGET_HITS || m->h.length < SIM_PROTO_HITS_HEADER_SIZE) {
+        return -1;
+    }
+    int count = get_u16(m->payload);
+    if ((size_t)m->h.length != SIM_PROTO_HITS_HEADER_SIZE + (size_t)count * SIM_PROTO_HIT_SIZE) {
+        return -1;
+    }
+    *epoch = get_u32(m->payload + 2);
+
+    int n = 0;
+    const uint8_t *p = m->payload + SIM_PROTO_HITS_HEADER_SIZE;
+    for (int k = 0; k < count && n < max; ++k, p += SIM_PROTO_HIT_SIZE) {
+        ids[n++] = (int)get_u32(p);
+    }
+    return n;
+}
+
+double sim_proto_time_s(const SimMsg *m)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    // One reading for both: the header wraps as u32 microseconds
+    uint32_t now_us = (uint32_t)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u);
+    uint32_t age_us = now_us - m->h.time_us;
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9 - (double)age_us * 1e-6;
+}
@@ -0,0 +1,108 @@
+// xoshiro256** generator seeded with splitmix64 (see sim_rng.h).
+
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_rng.h"
+
+static uint64_t rng_splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rng_rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+void sim_rng_seed(SimRng *rng, uint64_t seed, uint64_t stream)
+{
+    // Mix the stream id in first so nearby ids give unrelated states
+    uint64_t x = stream;
+    x = rng_splitmix64(&x) ^ seed;
+
+    for (int i = 0; i < 4; ++i) {
+        rng->s[i] = rng_splitmix64(&x);
+    }
+    // All-zero state is the one invalid state of xoshiro
+    if ((rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3]) == 0) {
+        rng->s[0] = 1;
+    }
+}
+
+uint64_t sim_rng_entropy(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    uint64_t x = ((uint64_t)ts.tv_sec << 30) ^ (uint64_t)ts.tv_nsec ^
+                 ((uint64_t)getpid() << 48) ^ (uint64_t)(uintptr_t)&ts;
+    return rng_splitmix64(&x);
+}
+
+uint64_t sim_rng_next(SimRng *rng)
+{
+    uint64_t *s = rng->s;
+    const uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+
+    return result;
+}
+
+double sim_rng_uniform(SimRng *rng)
+{
+    return (double)(sim_rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+void sim_rng_uniform_points(SimRng *rng,
+                            double  x0,
+                            double  y0,
+                            double  w,
+                            double  h,
+                            double *xs,
+                            double *ys,
+                            int     n)
+{
+    for (int i = 0; i < n; ++i) {
+        xs[i] = x0 + sim_rng_uniform(rng) * w;
+        ys[i] = y0 + sim_rng_uniform(rng) * h;
+    }
+}
+
+void sim_rng_split(SimRng *rng, SimRng *child)
+{
+    static const uint64_t jump[4] = {
+        0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+        0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull
+    };
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+    *child = *rng;
+
+    for (int i = 0; i < 4; ++i) {
+        for (int b = 0; b < 64; ++b) {
+            if (jump[i] & (1ull << b)) {
+                s0 ^= rng->s[0];
+                s1 ^= rng->s[1];
+                s2 ^= rng->s[2];
+                s3 ^= rng->s[3];
+            }
+            (void)sim_rng_next(rng);
+        }
+    }
+
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+    rng->s[2] = s2;
+    rng->s[3] = s3;
+}
@@ -0,0 +1,193 @@
+// CPU pinning, SCHED_FIFO, mlockall and tick jitter (see sim_rt.h).
+
+#define _GNU_SOURCE   // cpu_set_t, sched_setaffinity, SCHED_RESET_ON_FORK
+
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "sim_log.h"
+#include "sim_params.h"
+#include "sim_role.h"
+#include "sim_rt.h"
+
+static double sim_rt_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int64_t sim_rt_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Period in ns, at least 1 us so a zero / negative period cannot spin
+static int64_t sim_rt_period_ns(double period)
+{
+    int64_t ns = (int64_t)(period * 1e9);
+    return (ns < 1000) ? 1000 : ns;
+}
+
+int sim_rt_apply(int role, const char *name)
+{
+    if (role < 0 || role >= SIM_ROLE_COUNT) {
+        return -1;
+    }
+
+    const SimParams *p  = sim_params_get();
+    int              rc = 0;
+
+    uint64_t mask = p->cpu_mask[role];
+    if (mask != 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c = 0; c < 64; ++c) {
+            if (mask & (UINT64_C(1) << c)) {
+                CPU_SET(c, &set);
+            }
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            sim_log_info("%s: sched_setaffinity(0x%llx): %s", name,
+                         (unsigned long long)mask, strerror(errno));
+            rc = -1;
+        } else {
+            sim_log_info("%s: pinned to CPU mask 0x%llx", name, (unsigned long long)mask);
+        }
+    }
+
+    if (p->rt_priority[role] > 0) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = p->rt_priority[role];
+
+        int policy = SCHED_FIFO;
+#ifdef SCHED_RESET_ON_FORK
+        // Sound effect players forked by the roles stay SCHED_OTHER
+        policy |= SCHED_RESET_ON_FORK;
+#endif
+        if (sched_setscheduler(0, policy, &sp) != 0) {
+            sim_log_info("%s: SCHED_FIFO priority %d: %s (needs CAP_SYS_NICE or RLIMIT_RTPRIO)",
+                         name, sp.sched_priority, strerror(errno));
+            rc = -1;
+        } else {
+            sim_log_info("%s: SCHED_FIFO priority %d", name, sp.sched_priority);
+        }
+    }
+
+    if (p->mlock_all) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            sim_log_info("%s: mlockall: %s (check RLIMIT_MEMLOCK)", name, strerror(errno));
+            rc = -1;
+        } else {
+            sim_log_info("%s: memory locked", name);
+        }
+    }
+
+    return rc;
+}
+
+static void sim_jitter_reset_window(SimJitter *j, double now)
+{
+    j->window_start = now;
+    j->n            = 0;
+    j->sum          = 0.0;
+    j->sum_sq       = 0.0;
+    j->min_dev      = 0.0;
+    j->max_dev      = 0.0;
+    j->late         = 0;
+}
+
+void sim_jitter_init(SimJitter *j, const char *label, double period,
+                     double report_every)
+{
+    j->label        = label;
+    j->period       = period;
+    j->report_every = report_every;
+    j->last         = 0.0;
+    sim_jitter_reset_window(j, sim_rt_now());
+}
+
+void sim_jitter_tick(SimJitter *j)
+{
+    double now = sim_rt_now();
+
+    if (j->last > 0.0) {
+        double dev = (now - j->last) - j->period;
+        if (j->n == 0 || dev < j->min_dev) j->min_dev = dev;
+        if (j->n == 0 || dev > j->max_dev) j->max_dev = dev;
+        j->sum    += dev;
+        j->sum_sq += dev * dev;
+        if (now - j->last > j->period * SIM_JITTER_LATE_FACTOR) {
+            j->late++;
+        }
+        j->n++;
+    }
+    j->last = now;
+
+    if (j->report_every <= 0.0 || now - j->window_start < j->report_every) {
+        return;
+    }
+
+    if (j->n > 0) {
+        double mean = j->sum / (double)j->n;
+        double var  = j->sum_sq / (double)j->n - mean * mean;
+        sim_log_info("%s period %.2f ms, %ld intervals: jitter mean %+.3f ms, "
+                     "sd %.3f ms, min %+.3f ms, max %+.3f ms, %ld late",
+                     j->label, j->period * 1e3, j->n, mean * 1e3,
+                     (var > 0.0 ? sqrt(var) : 0.0) * 1e3,
+                     j->min_dev * 1e3, j->max_dev * 1e3, j->late);
+    }
+    sim_jitter_reset_window(j, now);
+}
+
+void sim_periodic_init(SimPeriodic *t, double period)
+{
+    t->period_ns = sim_rt_period_ns(period);
+    t->next_ns   = sim_rt_now_ns() + t->period_ns;
+    t->ticks     = 0;
+    t->overruns  = 0;
+}
+
+void sim_periodic_set_period(SimPeriodic *t, double period)
+{
+    int64_t ns = sim_rt_period_ns(period);
+    t->next_ns  += ns - t->period_ns;
+    t->period_ns = ns;
+}
+
+struct timespec sim_periodic_deadline(const SimPeriodic *t)
+{
+    struct timespec ts;
+    ts.tv_sec  = (time_t)(t->next_ns / 1000000000LL);
+    ts.tv_nsec = (long)(t->next_ns % 1000000000LL);
+    return ts;
+}
+
+double sim_periodic_remaining(const SimPeriodic *t)
+{
+    int64_t left = t->next_ns - sim_rt_now_ns();
+    return (left > 0) ? (double)left * 1e-9 : 0.0;
+}
+
+int sim_periodic_poll(SimPeriodic *t)
+{
+    int64_t now = sim_rt_now_ns();
+    if (now < t->next_ns) {
+        return 0;
+    }
+
+    // Stay on the grid: skip every deadline that already went by
+    int64_t elapsed = (now - t->next_ns) / t->period_ns + 1;
+    t->next_ns  += elapsed * t->period_ns;
+    t->ticks++;
+    t->overruns += (unsigned long)(elapsed - 1);
+    return (elapsed > INT32_MAX) ? INT32_MAX : (int)elapsed;
+}
@@ -0,0 +1,315 @@
+// Scenario file loader (text or mmap'ed binary) and binary writer.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sim_scenario.h"
+
+#define SIM_SCENARIO_MAX_LINE 256
+
+// Entity plus its position in the file, so sorting by t keeps file order
+typedef struct {
+    SimScenarioEntity e;
+    size_t            seq;
+} SimScenarioItem;
+
+typedef struct {
+    SimScenarioItem *items;
+    size_t           count;
+    size_t           capacity;
+} SimScenarioList;
+
+static int scenario_list_push(SimScenarioList *l, const SimScenarioEntity *e, size_t seq)
+{
+    if (l->count == l->capacity) {
+        size_t cap = l->capacity ? l->capacity * 2 : 64;
+        SimScenarioItem *p = realloc(l->items, cap * sizeof(*p));
+        if (p == NULL) {
+            return -1;
+        }
+        l->items    = p;
+        l->capacity = cap;
+    }
+    l->items[l->count].e   = *e;
+    l->items[l->count].seq = seq;
+    l->count++;
+    return 0;
+}
+
+static int scenario_item_cmp(const void *a, const void *b)
+{
+    const SimScenarioItem *x = a;
+    const SimScenarioItem *y = b;
+
+    if (x->e.t < y->e.t) return -1;
+    if (x->e.t > y->e.t) return 1;
+    return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+// Parse exactly n doubles from the remaining tokens of a line
+static int scenario_parse_doubles(char **save, double *out, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        char *tok = strtok_r(NULL, " \t\r\n", save);
+        char *end = NULL;
+        if (tok == NULL) {
+            return -1;
+        }
+        errno  = 0;
+        out[i] = strtod(tok, &end);
+        if (end == tok || *end != '\0' || errno == ERANGE) {
+            return -1;
+        }
+    }
+
+    // Anything left must be a comment
+    char *rest = strtok_r(NULL, " \t\r\n", save);
+    return (rest == NULL || rest[0] == '#') ? 0 : -1;
+}
+
+static int scenario_load_text(const char *path, SimScenario *sc)
+{
+    char line[SIM_SCENARIO_MAX_LINE];
+    int  line_no = 0;
+    int  errors  = 0;
+    SimScenarioList obs = { NULL, 0, 0 };
+    SimScenarioList tgt = { NULL, 0, 0 };
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+
+        char *save = NULL;
+        char *kw   = strtok_r(line, " \t\r\n", &save);
+        if (kw == NULL || kw[0] == '#') {
+            continue;
+        }
+
+        double v[4];
+        SimScenarioEntity e;
+        int rc = 0;
+
+        if (strcmp(kw, "seed") == 0) {
+            char *tok = strtok_r(NULL, " \t\r\n", &save);
+            char *end = NULL;
+            errno = 0;
+            unsigned long long seed = tok ? strtoull(tok, &end, 0) : 0;
+            if (tok == NULL || end == tok || *end != '\0' || errno == ERANGE) {
+                fprintf(stderr, "%s:%d: invalid seed\n", path, line_no);
+                errors++;
+                continue;
+            }
+            sc->seed     = (uint64_t)seed;
+            sc->has_seed = 1;
+            continue;
+        }
+
+        int is_spawn = (strncmp(kw, "spawn_", 6) == 0);
+        const char *what = is_spawn ? kw + 6 : kw;
+        SimScenarioList *list;
+        if (strcmp(what, "obstacle") == 0) {
+            list = &obs;
+        } else if (strcmp(what, "target") == 0) {
+            list = &tgt;
+        } else {
+            fprintf(stderr, "%s:%d: unknown entry '%s'\n", path, line_no, kw);
+            errors++;
+            continue;
+        }
+
+        if (is_spawn) {
+            rc   = scenario_parse_doubles(&save, v, 4);
+            e.t  = v[0];
+            e.x  = v[1];
+            e.y  = v[2];
+            e.radius = v[3];
+        } else {
+            rc   = scenario_parse_doubles(&save, v, 3);
+            e.t  = 0.0;
+            e.x  = v[0];
+            e.y  = v[1];
+            e.radius = v[2];
+        }
+
+        if (rc != 0 || e.radius <= 0.0 || e.t < 0.0) {
+            fprintf(stderr, "%s:%d: expected '%s %s<x> <y> <radius>' (radius > 0)\n",
+                    path, line_no, kw, is_spawn ? "<t >= 0> " : "");
+            errors++;
+            continue;
+        }
+
+        if (scenario_list_push(list, &e, (size_t)line_no) != 0) {
+            perror("sim_scenario: realloc");
+            errors++;
+            break;
+        }
+    }
+    fclose(fp);
+
+    if (errors == 0) {
+        qsort(obs.items, obs.count, sizeof(SimScenarioItem), scenario_item_cmp);
+        qsort(tgt.items, tgt.count, sizeof(SimScenarioItem), scenario_item_cmp);
+
+        // One block: obstacles then targets, same layout as the binary form
+        size_t total = obs.count + tgt.count;
+        sc->owned = malloc((total ? total : 1) * sizeof(SimScenarioEntity));
+        if (sc->owned == NULL) {
+            perror("sim_scenario: malloc");
+            errors++;
+        } else {
+            for (size_t i = 0; i < obs.count; ++i) {
+                sc->owned[i] = obs.items[i].e;
+            }
+            for (size_t i = 0; i < tgt.count; ++i) {
+                sc->owned[obs.count + i] = tgt.items[i].e;
+            }
+            sc->obstacles     = sc->owned;
+            sc->num_obstacles = (int)obs.count;
+            sc->targets       = sc->owned + obs.count;
+            sc->num_targets   = (int)tgt.count;
+        }
+    }
+
+    free(obs.items);
+    free(tgt.items);
+    return errors == 0 ? 0 : -1;
+}
+
+static int scenario_sorted(const SimScenarioEntity *list, uint32_t n)
+{
+    for (uint32_t i = 1; i < n; ++i) {
+        if (list[i].t < list[i - 1].t) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int scenario_load_binary(const char *path, int fd, SimScenario *sc)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void  *map  = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+
+    const SimScenarioHeader *h = map;
+    uint64_t need = sizeof(*h) +
+                    ((uint64_t)h->num_obstacles + h->num_targets) * sizeof(SimScenarioEntity);
+
+    const SimScenarioEntity *ents = (const SimScenarioEntity *)(h + 1);
+    if (h->version != SIM_SCENARIO_VERSION || need > size ||
+        h->num_obstacles > (uint32_t)INT32_MAX || h->num_targets > (uint32_t)INT32_MAX ||
+        !scenario_sorted(ents, h->num_obstacles) ||
+        !scenario_sorted(ents + h->num_obstacles, h->num_targets)) {
+        fprintf(stderr, "%s: corrupt or incompatible binary scenario\n", path);
+        munmap(map, size);
+        return -1;
+    }
+
+    sc->has_seed      = (h->flags & SIM_SCENARIO_HAS_SEED) != 0;
+    sc->seed          = h->seed;
+    sc->obstacles     = ents;
+    sc->num_obstacles = (int)h->num_obstacles;
+    sc->targets       = ents + h->num_obstacles;
+    sc->num_targets   = (int)h->num_targets;
+    sc->map           = map;
+    sc->map_size      = size;
+    return 0;
+}
+
+int sim_scenario_load(const char *path, SimScenario *sc)
+{
+    memset(sc, 0, sizeof(*sc));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+
+    uint32_t magic = 0;
+    ssize_t  n     = read(fd, &magic, sizeof(magic));
+
+    int rc;
+    if (n == (ssize_t)sizeof(magic) && magic == SIM_SCENARIO_MAGIC) {
+        rc = scenario_load_binary(path, fd, sc);
+    } else {
+        rc = scenario_load_text(path, sc);
+    }
+    close(fd);
+
+    if (rc != 0) {
+        sim_scenario_free(sc);
+    }
+    return rc;
+}
+
+int sim_scenario_write_binary(const SimScenario *sc, const char *path)
+{
+    SimScenarioHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic         = SIM_SCENARIO_MAGIC;
+    h.version       = SIM_SCENARIO_VERSION;
+    h.seed          = sc->seed;
+    h.flags         = sc->has_seed ? SIM_SCENARIO_HAS_SEED : 0u;
+    h.num_obstacles = (uint32_t)sc->num_obstacles;
+    h.num_targets   = (uint32_t)sc->num_targets;
+
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+             fwrite(sc->obstacles, sizeof(SimScenarioEntity),
+                    (size_t)sc->num_obstacles, fp) == (size_t)sc->num_obstacles &&
+             fwrite(sc->targets, sizeof(SimScenarioEntity),
+                    (size_t)sc->num_targets, fp) == (size_t)sc->num_targets;
+
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+int sim_scenario_initial_count(const SimScenarioEntity *list, int n)
+{
+    int i = 0;
+    while (i < n && list[i].t <= 0.0) {
+        ++i;
+    }
+    return i;
+}
+
+void sim_scenario_free(SimScenario *sc)
+{
+    if (sc->map != NULL) {
+        munmap(sc->map, sc->map_size);
+    }
+    free(sc->owned);
+    memset(sc, 0, sizeof(*sc));
+}
@@ -0,0 +1,281 @@
+// Shared-memory world snapshot ring (see sim_snapshot.h).
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_log.h"
+#include "sim_snapshot.h"
+
+#define SIM_SNAPSHOT_MAGIC    0x4E534D53u   // 'SMSN'
+#define SIM_SNAPSHOT_VERSION  2
+
+typedef struct {
+    _Atomic int      pid;        // 0 = free
+    _Atomic uint64_t received;
+    _Atomic uint64_t dropped;
+} SimSnapshotSub;
+
+typedef struct {
+    _Atomic uint64_t mark;       // 2 * seq + 1 while written, 2 * seq + 2 when done
+    SimSnapshot      snap;
+} SimSnapshotSlot;
+
+struct SimSnapshotRing {
+    uint32_t         magic;
+    uint32_t         version;
+    uint32_t         num_slots;
+    uint32_t         slot_size;
+    _Atomic int      open;       // cleared by the publisher on close
+    _Atomic uint64_t head;       // snapshots published so far
+    SimSnapshotSub   subs[SIM_SNAPSHOT_MAX_SUBS];
+    SimSnapshotSlot  slots[];
+};
+
+static size_t sim_snapshot_ring_size(uint32_t slots)
+{
+    return sizeof(SimSnapshotRing) + (size_t)slots * sizeof(SimSnapshotSlot);
+}
+
+static double sim_snapshot_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int sim_snapshot_create(SimSnapshotHandle *h, int slots)
+{
+    memset(h, 0, sizeof(*h));
+    h->sub = -1;
+
+    if (slots <= 0 || slots > SIM_SNAPSHOT_MAX_SLOTS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // A ring left by a crashed run would keep its old subscribers
+    shm_unlink(SIM_SNAPSHOT_SHM);
+
+    int fd = shm_open(SIM_SNAPSHOT_SHM, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+
+    size_t size = sim_snapshot_ring_size((uint32_t)slots);
+    if (ftruncate(fd, (off_t)size) != 0) {
+        int e = errno;
+        close(fd);
+        shm_unlink(SIM_SNAPSHOT_SHM);
+        errno = e;
+        return -1;
+    }
+
+    SimSnapshotRing *r = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r == MAP_FAILED) {
+        int e = errno;
+        shm_unlink(SIM_SNAPSHOT_SHM);
+        errno = e;
+        return -1;
+    }
+
+    // ftruncate zero-filled it: every mark and subscriber slot is free
+    r->num_slots = (uint32_t)slots;
+    r->slot_size = (uint32_t)sizeof(SimSnapshotSlot);
+    r->version   = SIM_SNAPSHOT_VERSION;
+    atomic_store(&r->open, 1);
+    atomic_thread_fence(memory_order_release);
+    r->magic     = SIM_SNAPSHOT_MAGIC;
+
+    h->ring = r;
+    h->size = size;
+    return 0;
+}
+
+void sim_snapshot_publish(SimSnapshotHandle *h, const WorldState *w)
+{
+    SimSnapshotRing *r = h->ring;
+    if (r == NULL) {
+        return;
+    }
+
+    uint64_t         seq  = atomic_load_explicit(&r->head, memory_order_relaxed);
+    SimSnapshotSlot *slot = &r->slots[seq % r->num_slots];
+
+    // Odd mark first, so a reader racing the copy below sees it changed
+    atomic_store_explicit(&slot->mark, 2 * seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->snap.seq   = seq;
+    slot->snap.t     = sim_snapshot_now();
+    slot->snap.world = *w;
+
+    atomic_store_explicit(&slot->mark, 2 * seq + 2, memory_order_release);
+    atomic_store_explicit(&r->head, seq + 1, memory_order_release);
+}
+
+void sim_snapshot_log_subscribers(const SimSnapshotHandle *h, const char *who)
+{
+    SimSnapshotRing *r = h->ring;
+    if (r == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < SIM_SNAPSHOT_MAX_SUBS; ++i) {
+        int pid = atomic_load(&r->subs[i].pid);
+        if (pid != 0) {
+            sim_log_info("%s: snapshot subscriber %d (pid %d): received=%llu dropped=%llu",
+                         who, i, pid,
+                         (unsigned long long)atomic_load(&r->subs[i].received),
+                         (unsigned long long)atomic_load(&r->subs[i].dropped));
+        }
+    }
+    sim_log_info("%s: snapshots published: %llu", who,
+                 (unsigned long long)atomic_load(&r->head));
+}
+
+// Claim a free subscriber slot, or one whose owner no longer exists
+static int sim_snapshot_claim(SimSnapshotRing *r)
+{
+    int self = (int)getpid();
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < SIM_SNAPSHOT_MAX_SUBS; ++i) {
+            int pid = atomic_load(&r->subs[i].pid);
+            int free_slot = (pass == 0) ? (pid == 0)
+                                        : (pid != 0 && kill(pid, 0) != 0 && errno == ESRCH);
+            if (free_slot && atomic_compare_exchange_strong(&r->subs[i].pid, &pid, self)) {
+                atomic_store(&r->subs[i].received, 0);
+                atomic_store(&r->subs[i].dropped, 0);
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+int sim_snapshot_subscribe(SimSnapshotHandle *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->sub = -1;
+
+    int fd = shm_open(SIM_SNAPSHOT_SHM, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SimSnapshotRing)) {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    SimSnapshotRing *r = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r == MAP_FAILED) {
+        return -1;
+    }
+
+    if (r->magic != SIM_SNAPSHOT_MAGIC || r->version != SIM_SNAPSHOT_VERSION ||
+        r->slot_size != sizeof(SimSnapshotSlot) ||
+        sim_snapshot_ring_size(r->num_slots) > size) {
+        munmap(r, size);
+        errno = EPROTO;
+        return -1;
+    }
+
+    int sub = sim_snapshot_claim(r);
+    if (sub < 0) {
+        munmap(r, size);
+        errno = EBUSY;
+        return -1;
+    }
+
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    h->ring = r;
+    h->size = size;
+    h->sub  = sub;
+    h->next = (head > 0) ? head - 1 : 0;
+    return 0;
+}
+
+static void sim_snapshot_drop(SimSnapshotHandle *h, uint64_t n)
+{
+    atomic_fetch_add_explicit(&h->ring->subs[h->sub].dropped, n, memory_order_relaxed);
+}
+
+int sim_snapshot_next(SimSnapshotHandle *h, SimSnapshot *out)
+{
+    SimSnapshotRing *r = h->ring;
+    if (r == NULL || h->sub < 0) {
+        return -1;
+    }
+
+    for (;;) {
+        int      open = atomic_load_explicit(&r->open, memory_order_acquire);
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+
+        if (h->next >= head) {
+            return open ? 0 : -1;
+        }
+
+        // Lapped by the publisher: catch up to the newest snapshot
+        if (head - h->next > r->num_slots) {
+            sim_snapshot_drop(h, head - 1 - h->next);
+            h->next = head - 1;
+        }
+
+        SimSnapshotSlot *slot = &r->slots[h->next % r->num_slots];
+        uint64_t want = 2 * h->next + 2;
+
+        uint64_t m1 = atomic_load_explicit(&slot->mark, memory_order_acquire);
+        if (m1 == want) {
+            *out = slot->snap;
+            atomic_thread_fence(memory_order_acquire);
+            uint64_t m2 = atomic_load_explicit(&slot->mark, memory_order_relaxed);
+            if (m2 == want) {
+                h->next++;
+                atomic_fetch_add_explicit(&r->subs[h->sub].received, 1,
+                                          memory_order_relaxed);
+                return 1;
+            }
+        }
+
+        // Overwritten under us: that snapshot is lost, try the next one
+        sim_snapshot_drop(h, 1);
+        h->next++;
+    }
+}
+
+unsigned long sim_snapshot_dropped(const SimSnapshotHandle *h)
+{
+    if (h->ring == NULL || h->sub < 0) {
+        return 0;
+    }
+    return (unsigned long)atomic_load(&h->ring->subs[h->sub].dropped);
+}
+
+void sim_snapshot_close(SimSnapshotHandle *h)
+{
+    if (h->ring == NULL) {
+        return;
+    }
+
+    if (h->sub >= 0) {
+        atomic_store(&h->ring->subs[h->sub].pid, 0);
+    } else {
+        atomic_store(&h->ring->open, 0);
+        shm_unlink(SIM_SNAPSHOT_SHM);
+    }
+    munmap(h->ring, h->size);
+    h->ring = NULL;
+}
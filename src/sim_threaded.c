@@ -0,0 +1,269 @@
+/*
+    Single-process build of the simulator.
+
+    Runs bb_server, input, drone, obstacles and targets as threads of one
+    process instead of five processes started by master. The role sources
+    are the same (compiled with SIM_SINGLE_PROCESS, see sim_role.h); the
+    pipes between them become sim_ipc_channel()s, so every message is a
+    memcpy into a ring buffer instead of a write()/read() pair through
+    the kernel, and no context switch is needed to hand it over.
+
+    What the multi-process build has and this one does not:
+      - supervision: a crashed role takes the whole process down, a
+        stopped one is not restarted
+      - live config reload (parameters are read once at start)
+      - a separate input window: bb_server owns the terminal, input reads
+        keys from the same terminal (see input.c)
+      - the start menu (it would compete with input for the keyboard)
+
+    Ctrl-C or 'Q' stops the run. stderr goes to bin/log/ while
+    bb_server's ncurses screen is up, unless it is not a terminal.
+*/
+
+#define _GNU_SOURCE   // pthread_timedjoin_np
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_heartbeat.h"
+#include "sim_ipc.h"
+#include "sim_log.h"
+#include "sim_metrics.h"
+#include "sim_params.h"
+#include "sim_prof.h"
+#include "sim_role.h"
+
+#define SIM_THREADED_MAX_HANDLERS  8
+#define SIM_THREADED_STDERR_LOG    "../../bin/log/sim_threaded_stderr.log"
+#define SIM_THREADED_JOIN_POLL_MS  100
+
+enum {
+    CHAN_DRONE_CMD,      // bb_server -> drone (commands + obstacle sets)
+    CHAN_DRONE_STATE,    // drone -> bb_server (drone state)
+    CHAN_INPUT_CMD,      // input -> bb_server (commands)
+    CHAN_OBSTACLES,      // obstacles -> bb_server (obstacle sets)
+    CHAN_TARGETS,        // targets   -> bb_server (target changes)
+    CHAN_TARGET_HITS,    // bb_server -> targets (hit target ids)
+    SIM_THREADED_NUM_CHANNELS
+};
+
+typedef struct {
+    const char *name;
+    int       (*entry)(int argc, char *argv[]);
+    int         argc;
+    char       *argv[8];
+    char        args[7][16];
+    pthread_t   thread;
+    int         started;
+    int         rc;
+} SimThreadedRole;
+
+// Handlers registered by the roles through SIM_ROLE_SIGNAL()
+typedef void (*SimSignalHandler)(int);
+
+static _Atomic(SimSignalHandler) g_handlers[SIM_THREADED_MAX_HANDLERS];
+static _Atomic int               g_handler_sigs[SIM_THREADED_MAX_HANDLERS];
+static atomic_int                g_num_handlers;
+
+void sim_threaded_signal(int sig, void (*handler)(int))
+{
+    int slot = atomic_fetch_add(&g_num_handlers, 1);
+    if (slot >= SIM_THREADED_MAX_HANDLERS) {
+        fprintf(stderr, "sim_threaded: too many signal handlers, dropping one\n");
+        return;
+    }
+    atomic_store(&g_handler_sigs[slot], sig);
+    atomic_store(&g_handlers[slot], handler);
+}
+
+// Process-wide handler: fan out to every role. SIGTERM counts as SIGINT.
+static void sim_threaded_dispatch(int sig)
+{
+    int want = (sig == SIGTERM) ? SIGINT : sig;
+    int n    = atomic_load(&g_num_handlers);
+    if (n > SIM_THREADED_MAX_HANDLERS) {
+        n = SIM_THREADED_MAX_HANDLERS;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        SimSignalHandler h = atomic_load(&g_handlers[i]);
+        if (h != NULL && atomic_load(&g_handler_sigs[i]) == want) {
+            h(want);
+        }
+    }
+}
+
+static void *sim_threaded_run(void *arg)
+{
+    SimThreadedRole *r = arg;
+    r->rc = r->entry(r->argc, r->argv);
+    return NULL;
+}
+
+// argv[0] = role name, argv[1..] = fds, same layout as the executables
+static void sim_threaded_set_args(SimThreadedRole *r, const int *fds, int n)
+{
+    r->argv[0] = (char *)r->name;
+    for (int i = 0; i < n; ++i) {
+        snprintf(r->args[i], sizeof(r->args[i]), "%d", fds[i]);
+        r->argv[i + 1] = r->args[i];
+    }
+    r->argv[n + 1] = NULL;
+    r->argc        = n + 1;
+}
+
+// Join r, re-sending SIGINT until it returns so blocking calls see EINTR
+static void sim_threaded_stop(SimThreadedRole *r)
+{
+    if (!r->started) {
+        return;
+    }
+
+    for (;;) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += SIM_THREADED_JOIN_POLL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec  += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int rc = pthread_timedjoin_np(r->thread, NULL, &deadline);
+        if (rc != ETIMEDOUT) {
+            break;
+        }
+        pthread_kill(r->thread, SIGINT);
+    }
+    r->started = 0;
+}
+
+int main(void)
+{
+    sim_log_init("sim_threaded");
+
+    if (sim_params_load(NULL) != 0) {
+        fprintf(stderr,
+                "sim_threaded: warning: could not fully load '%s', built-in defaults fill the gaps\n",
+                sim_params_resolve_path(NULL));
+    }
+
+    // Fixes the run seed (rng_seed 0 = entropy) exactly like master does
+    int params_fd = sim_params_publish();
+    if (params_fd < 0) {
+        perror("sim_threaded: sim_params_publish");
+    }
+
+    // Map the heartbeat block before any role thread beats into it
+    int heartbeat_fd = sim_heartbeat_create();
+    if (heartbeat_fd < 0) {
+        perror("sim_threaded: sim_heartbeat_create");
+    }
+
+    // Same for the metrics block: roles find it through SIM_METRICS_FD
+    if (sim_metrics_create() < 0) {
+        perror("sim_threaded: sim_metrics_create");
+    }
+    if (SIM_PROF_OPEN() != 0) {
+        perror("sim_threaded: sim_prof_open");
+    }
+
+    int ch[SIM_THREADED_NUM_CHANNELS][2];
+    for (int i = 0; i < SIM_THREADED_NUM_CHANNELS; ++i) {
+        if (sim_ipc_channel(ch[i]) != 0) {
+            perror("sim_threaded: sim_ipc_channel");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // No SA_RESTART: select() / poll() / sleeps in the roles must see EINTR
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sim_threaded_dispatch;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // bb_server's ncurses screen owns the terminal from here on
+    if (isatty(STDERR_FILENO)) {
+        int fd = open(SIM_THREADED_STDERR_LOG, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+            setvbuf(stderr, NULL, _IOLBF, 0);
+        }
+    }
+
+    SimThreadedRole roles[SIM_ROLE_COUNT];
+    memset(roles, 0, sizeof(roles));
+
+    roles[SIM_ROLE_BB_SERVER].name  = "bb_server";
+    roles[SIM_ROLE_BB_SERVER].entry = sim_bb_server_main;
+    const int bb_fds[] = {
+        ch[CHAN_DRONE_STATE][0], ch[CHAN_DRONE_CMD][1],
+        ch[CHAN_INPUT_CMD][0],   ch[CHAN_OBSTACLES][0],
+        ch[CHAN_TARGETS][0],     ch[CHAN_TARGET_HITS][1]
+    };
+    sim_threaded_set_args(&roles[SIM_ROLE_BB_SERVER], bb_fds, 6);
+
+    roles[SIM_ROLE_INPUT].name  = "input";
+    roles[SIM_ROLE_INPUT].entry = sim_input_main;
+    sim_threaded_set_args(&roles[SIM_ROLE_INPUT], &ch[CHAN_INPUT_CMD][1], 1);
+
+    roles[SIM_ROLE_DRONE].name  = "drone";
+    roles[SIM_ROLE_DRONE].entry = sim_drone_main;
+    const int drone_fds[] = {
+        ch[CHAN_DRONE_CMD][0], ch[CHAN_DRONE_STATE][1]
+    };
+    sim_threaded_set_args(&roles[SIM_ROLE_DRONE], drone_fds, 2);
+
+    roles[SIM_ROLE_OBSTACLES].name  = "obstacles";
+    roles[SIM_ROLE_OBSTACLES].entry = sim_obstacles_main;
+    sim_threaded_set_args(&roles[SIM_ROLE_OBSTACLES], &ch[CHAN_OBSTACLES][1], 1);
+
+    roles[SIM_ROLE_TARGETS].name  = "targets";
+    roles[SIM_ROLE_TARGETS].entry = sim_targets_main;
+    const int targets_fds[] = {
+        ch[CHAN_TARGETS][1], ch[CHAN_TARGET_HITS][0]
+    };
+    sim_threaded_set_args(&roles[SIM_ROLE_TARGETS], targets_fds, 2);
+
+    sim_log_info("sim_threaded: starting roles (rng_seed=%llu)",
+                 (unsigned long long)sim_params_get()->rng_seed);
+
+    // Same start order as master: UI first, then the workers
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        int rc = pthread_create(&roles[r].thread, NULL, sim_threaded_run, &roles[r]);
+        if (rc != 0) {
+            fprintf(stderr, "sim_threaded: %s: %s\n", roles[r].name, strerror(rc));
+            sim_threaded_dispatch(SIGINT);
+            break;
+        }
+        roles[r].started = 1;
+    }
+
+    // The run ends when bb_server does (quit key, Ctrl-C, lost producer)
+    if (roles[SIM_ROLE_BB_SERVER].started) {
+        pthread_join(roles[SIM_ROLE_BB_SERVER].thread, NULL);
+        roles[SIM_ROLE_BB_SERVER].started = 0;
+    }
+    sim_log_info("sim_threaded: bb_server exited (%d), stopping the rest",
+                 roles[SIM_ROLE_BB_SERVER].rc);
+
+    sim_threaded_dispatch(SIGINT);
+    for (int r = 0; r < SIM_ROLE_COUNT; ++r) {
+        sim_threaded_stop(&roles[r]);
+    }
+
+    sim_log_info("sim_threaded: all roles stopped");
+    sim_log_close();
+    return roles[SIM_ROLE_BB_SERVER].rc;
+}
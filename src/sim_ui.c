@@ -14,6 +14,9 @@
 // Single map window, below the header, centered horizontally
 static WINDOW *map_win = NULL;
 
+// Metrics overlay, top-right corner of the map (created on first use)
+static WINDOW *metrics_win = NULL;
+
 // Track last screen size to avoid unnecessary resizes
 static int last_screen_h = 0;
 static int last_screen_w = 0;
@@ -173,6 +176,7 @@ static void show_instructions_internal(void)
         "q w e / a s d / z x c = direction of force",
         "s or SPACE = brake (zero force)",
         "r = reset drone position",
+        "m = show / hide the metrics panel",
         "Q = quit simulation",
         "",
         "This window shows the map, obstacles, and targets.",
@@ -214,6 +218,10 @@ void ui_init(void)
 // For defs check sim_ui.h 
 void ui_shutdown(void)
 {
+    if (metrics_win) {
+        delwin(metrics_win);
+        metrics_win = NULL;
+    }
     if (map_win) {
         delwin(map_win);
         map_win = NULL;
@@ -307,8 +315,8 @@ void ui_draw(const WorldState *world)
         wattroff(map_win, COLOR_PAIR(2));
     }
 
-    // Draw targets as '+'
-    for (int i = 0; i < world->num_targets; ++i) {
+    // Draw targets as '+' (num_targets counts them; a hit leaves a hole)
+    for (int i = 0; i < SIM_MAX_TARGETS; ++i) {
         if (!world->targets[i].active)
             continue;
 
@@ -337,3 +345,63 @@ void ui_draw(const WorldState *world)
     refresh();
     wrefresh(map_win);
 }
+
+void ui_draw_metrics(const SimMetricsRates *rates)
+{
+    if (!rates || !map_win) return;
+
+    // Roles that run a timed loop, then one row per channel
+    static const int roles[] = { SIM_ROLE_BB_SERVER, SIM_ROLE_DRONE };
+    const int n_roles = (int)(sizeof(roles) / sizeof(roles[0]));
+
+    int ph = 2 + 1 + n_roles + 1 + 1 + SIM_METRIC_CHAN_COUNT + 1;
+    int pw = 62;
+
+    int my, mx, mh, mw;
+    getbegyx(map_win, my, mx);
+    getmaxyx(map_win, mh, mw);
+
+    // Too small a map: no panel
+    if (mh < ph + 2 || mw < pw + 2) return;
+
+    int py = my + 1;
+    int px = mx + mw - pw - 1;
+
+    if (metrics_win == NULL) {
+        metrics_win = newwin(ph, pw, py, px);
+    } else {
+        wresize(metrics_win, ph, pw);
+        mvwin(metrics_win, py, px);
+    }
+
+    werase(metrics_win);
+    box(metrics_win, 0, 0);
+
+    wattron(metrics_win, A_BOLD | COLOR_PAIR(3));
+    mvwprintw(metrics_win, 0, 2, " METRICS (m to hide) ");
+    wattroff(metrics_win, A_BOLD | COLOR_PAIR(3));
+
+    int y = 1;
+    mvwprintw(metrics_win, y++, 2, "%-10s %8s %7s %7s %6s %6s %6s",
+              "role", "ticks/s", "avg ms", "max ms", "drop", "coal", "queue");
+    for (int i = 0; i < n_roles; ++i) {
+        int r = roles[i];
+        mvwprintw(metrics_win, y++, 2, "%-10s %8.1f %7.3f %7.3f %6llu %6llu %6llu",
+                  sim_metrics_role_name(r), rates->ticks_per_s[r],
+                  rates->tick_avg_ms[r], rates->tick_max_ms[r],
+                  (unsigned long long)rates->dropped[r],
+                  (unsigned long long)rates->coalesced[r],
+                  (unsigned long long)rates->queue_bytes[r]);
+    }
+    mvwprintw(metrics_win, y++, 2, "frames/s %6.1f",
+              rates->frames_per_s[SIM_ROLE_BB_SERVER]);
+
+    y++;
+    mvwprintw(metrics_win, y++, 2, "%-14s %8s", "channel", "msgs/s");
+    for (int c = 0; c < SIM_METRIC_CHAN_COUNT; ++c) {
+        mvwprintw(metrics_win, y++, 2, "%-14s %8.1f",
+                  sim_metrics_chan_name(c), rates->chan_per_s[c]);
+    }
+
+    wrefresh(metrics_win);
+}
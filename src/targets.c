@@ -1,8 +1,11 @@
 // Targets process.
-// Generates targets over time and sends them periodically to bb_server
-// via an anonymous pipe. bb_server stores them in WorldState and uses them
-// for drawing / scoring / repulsion in Phase 3.
+// Owns the target set: generates targets over time, respawns the ones
+// bb_server reports as hit, and sends bb_server only the slots that
+// changed. bb_server stores them in WorldState for drawing / scoring.
+// Moving targets (target_speed) go out as trajectories from their spawn
+// time, and bb_server moves them itself, so only spawns are ever sent.
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -13,6 +16,14 @@
 #include "sim_ipc.h"
 #include "sim_params.h"
 #include "sim_log.h"
+#include "sim_heartbeat.h"
+#include "sim_rng.h"
+#include "sim_scenario.h"
+#include "sim_role.h"
+#include "sim_rt.h"
+#include "sim_proto.h"
+#include "sim_physics.h"
+#include "sim_metrics.h"
 #include "sim_const.h"  
 
 // Flag set by the SIGINT handler to request a clean shutdown
@@ -24,38 +35,91 @@ static void handle_sigint(int sig)
     running = 0;
 }
 
-// keep target generation in one place
-static void generate_random_target(Target *t, const SimParams *params, double radius, int id)
+// keep target generation in one place:
+// n targets at uniform positions (one batch draw), ids first_id, first_id + 1, ...
+// then (moving targets only) velocities uniform in [-speed, speed) per axis
+static void generate_random_targets(Target *t, int n, const SimParams *params,
+                                    double radius, int first_id, SimRng *rng)
 {
     double margin = radius;  
+    double xs[SIM_MAX_TARGETS];
+    double ys[SIM_MAX_TARGETS];
+    double vxs[SIM_MAX_TARGETS] = { 0.0 };
+    double vys[SIM_MAX_TARGETS] = { 0.0 };
 
     double x_range = (double)params->world_width  - 2.0 * margin;
     double y_range = (double)params->world_height - 2.0 * margin;
     if (x_range < 0.0) x_range = 0.0;
     if (y_range < 0.0) y_range = 0.0;
 
-    double rx = (double)rand() / (double)RAND_MAX;
-    double ry = (double)rand() / (double)RAND_MAX;
+    sim_rng_uniform_points(rng, margin, margin, x_range, y_range, xs, ys, n);
 
-    t->x      = margin + rx * x_range;
-    t->y      = margin + ry * y_range;
-    t->radius = radius;
+    double speed = params->target_speed;
+    if (speed > 0.0) {
+        sim_rng_uniform_points(rng, -speed, -speed, 2.0 * speed, 2.0 * speed, vxs, vys, n);
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    for (int i = 0; i < n; ++i) {
+        t[i].x            = xs[i];
+        t[i].y            = ys[i];
+        t[i].vx           = vxs[i];
+        t[i].vy           = vys[i];
+        t[i].radius       = radius;
+        t[i].id           = first_id + i;
+        t[i].active       = 1;
+        t[i].time_created = now;
+    }
+}
+
+// Spawn interval (seconds), default if unset / invalid
+static double spawn_interval(double interval)
+{
+    return (interval > 0.0) ? interval : SIM_DEFAULT_TARGET_SPAWN_INTERVAL;
+}
+
+// Place a scenario entity (position / radius given by the file)
+static void place_target(Target *t, const SimScenarioEntity *e, int id)
+{
+    t->x      = e->x;
+    t->y      = e->y;
+    t->vx     = 0.0;
+    t->vy     = 0.0;
+    t->radius = e->radius;
     t->id     = id;
     t->active = 1;
     clock_gettime(CLOCK_REALTIME, &t->time_created);
 }
 
-int main(int argc, char *argv[])
+// Absolute CLOCK_MONOTONIC time start + t seconds (scheduled spawns)
+static struct timespec schedule_deadline(const struct timespec *start, double t)
+{
+    struct timespec ts = *start;
+    time_t whole = (time_t)t;
+
+    ts.tv_sec  += whole;
+    ts.tv_nsec += (long)((t - (double)whole) * 1e9);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec  += 1;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+SIM_ROLE_MAIN(targets)
 {
     sim_log_init("targets");
-    signal(SIGINT, handle_sigint);
+    SIM_ROLE_SIGNAL(SIGINT, handle_sigint);
 
-    if (argc < 2) {
-        sim_log_info("targets: usage error: expected fd_targets_out argument");
+    if (argc < 3) {
+        sim_log_info("targets: usage error: expected fd_targets_out fd_target_hits_in arguments");
         return EXIT_FAILURE;
     }
 
     int fd_tgt_out = atoi(argv[SIM_ARG_TGT_OUT]);
+    int fd_hits_in = atoi(argv[SIM_ARG_TGT_HITS_IN]);
 
     // Load runtime parameters for targets 
     if (sim_params_load(NULL) != 0) {
@@ -90,33 +154,80 @@ int main(int argc, char *argv[])
                  max_targets,
                  params->target_spawn_interval);
 
+    // CPU set / SCHED_FIFO / mlockall from [realtime]
+    sim_rt_apply(SIM_ROLE_TARGETS, "targets");
+
     // If we have no capacity at all, just exit quietly
     if (max_targets == 0) {
         sim_log_info("targets: max_targets <= 0, nothing to do");
-        close(fd_tgt_out);
+        sim_ipc_close(fd_tgt_out);
+        sim_ipc_close(fd_hits_in);
         sim_log_info("targets: exiting (no capacity)");
         return EXIT_SUCCESS;
     }
 
     Target targets[SIM_MAX_TARGETS];
 
-    // Seed RNG with time and PID to avoid identical maps across runs
-    srand((unsigned)time(NULL) ^ (unsigned)getpid());
+    // Optional scenario: fixed layout, spawn schedule and seed
+    SimScenario scenario;
+    int         use_scenario = 0;
+    if (params->scenario_path[0] != '\0') {
+        if (sim_scenario_load(params->scenario_path, &scenario) == 0) {
+            use_scenario = 1;
+        } else {
+            sim_log_info("targets: could not load scenario '%s', using random layout",
+                         params->scenario_path);
+        }
+    }
+    const SimScenarioEntity *schedule     = use_scenario ? scenario.targets : NULL;
+    int                      num_schedule = use_scenario ? scenario.num_targets : 0;
+    int                      next_event   = sim_scenario_initial_count(schedule, num_schedule);
+    int                      num_initial  = next_event;
+
+    // Own stream of the run seed (scenario seed wins over rng_seed)
+    uint64_t seed = params->rng_seed;
+    if (use_scenario && scenario.has_seed) {
+        seed = scenario.seed;
+    } else if (seed == 0) {
+        seed = sim_rng_entropy();  // no master block: not reproducible
+    }
+    SimRng rng;
+    sim_rng_seed(&rng, seed, SIM_RNG_STREAM_TARGETS);
 
     // Simple static targets: random positions in the world, fixed radius
     const double radius = 1.0;
 
     int next_id = 1; // monotonically increasing id for new targets
 
+    // Our epoch: master's restart count of this role (0 for the first
+    // instance or without master). Hits bb_server reports late against a
+    // previous instance's set (queued, or tested before ours arrived)
+    // carry that set's epoch and are ignored.
+    uint32_t epoch = (uint32_t)sim_metrics_get(SIM_ROLE_TARGETS, SIM_METRIC_RESTARTS);
+
     // Initialize the active targets
-    for (int i = 0; i < active_count; ++i) {
-        generate_random_target(&targets[i], params, radius, next_id++);
+    if (num_initial > 0) {
+        // Scenario layout replaces the random initial set
+        if (num_initial > max_targets) {
+            sim_log_info("targets: scenario has %d initial targets, cap is %d",
+                         num_initial, max_targets);
+            num_initial = max_targets;
+        }
+        active_count = num_initial;
+        for (int i = 0; i < active_count; ++i) {
+            place_target(&targets[i], &schedule[i], next_id++);
+        }
+    } else {
+        generate_random_targets(targets, active_count, params, radius, next_id, &rng);
+        next_id += active_count;
     }
 
     // Mark unused slots as inactive
     for (int i = active_count; i < max_targets; ++i) {
         targets[i].x      = 0.0;
         targets[i].y      = 0.0;
+        targets[i].vx     = 0.0;
+        targets[i].vy     = 0.0;
         targets[i].radius = 0.0;
         targets[i].id     = 0;
         targets[i].active = 0;
@@ -124,69 +235,183 @@ int main(int argc, char *argv[])
         targets[i].time_created.tv_nsec = 0;
     }
 
-    ssize_t expected = (ssize_t)(max_targets * (int)sizeof(Target));
+    // Hit ids arrive by target id: slot lookup through the index
+    static SimTargetIndex tindex;
+    sim_physics_tindex_init(&tindex, params, SIM_PHYS_HIT_RADIUS);
+    for (int i = 0; i < max_targets; ++i) {
+        sim_physics_tindex_set(&tindex, targets, i);
+    }
+
+    static SimIpcRx  rx_hits;
+    static SimMsg    msg;
+    SimMsgReader     rd_hits;
+    int              hits_open = 1;
+    sim_ipc_set_nonblock(fd_hits_in);
+    sim_proto_reader_init(&rd_hits);
+
+    // Whole set once (bb_server replaces its copy), then changes only
+    static SimMsgWriter out;
+    sim_proto_writer_init(&out);
 
     // Send initial snapshot to bb_server
-    ssize_t w = write_full(fd_tgt_out, targets,
-                           (size_t)(max_targets * (int)sizeof(Target)));
-    if (w != expected) {
-        sim_log_info("targets: write_full(fd_tgt_out) failed, returned %zd (expected %zd)",
-                     w, expected);
-        close(fd_tgt_out);
+    sim_proto_put_targets(&out, targets, max_targets, epoch);
+    if (sim_proto_flush(fd_tgt_out, &out) != 0) {
+        sim_log_info("targets: sim_proto_flush(fd_tgt_out) failed");
+        sim_ipc_close(fd_tgt_out);
+        sim_ipc_close(fd_hits_in);
         sim_log_info("targets: exiting (initial write failed)");
         return EXIT_FAILURE;
     }
-    sim_log_info("targets: sent initial %d/%d targets to bb_server",
-                 active_count, max_targets);
+    sim_log_info("targets: sent initial %d/%d targets to bb_server (epoch %u)",
+                 active_count, max_targets, (unsigned)epoch);
 
-    // Precompute sleep interval as timespec
-    double interval = params->target_spawn_interval;
-    if (interval <= 0.0) {
-        interval = SIM_DEFAULT_TARGET_SPAWN_INTERVAL;
-    }
+    // Scheduled spawns are timed from here
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
-    struct timespec sleep_ts;
-    sleep_ts.tv_sec  = (time_t)interval;
-    sleep_ts.tv_nsec = (long)((interval - (double)sleep_ts.tv_sec) * 1e9);
-    if (sleep_ts.tv_nsec < 0) {
-        sleep_ts.tv_nsec = 0;
-    }
+    // Seconds between random spawns (recomputed on config reload)
+    double interval = spawn_interval(params->target_spawn_interval);
+
+    // Random spawns on an absolute grid: time spent generating and
+    // sending does not push later spawns back
+    SimPeriodic spawn;
+    int         spawn_armed = 0;
 
     int oldest_index = 0; 
 
-    // Main spawn/update loop: keep sending updated target sets
+    unsigned long hits_taken = 0;
+    unsigned long hits_stale = 0;
+
+    // Main loop: spawns on schedule, respawns on hits, changes out
     while (running) {
-        nanosleep(&sleep_ts, NULL);
+        // Scheduled spawn at its own time, then periodic random spawns
+        // (sleeps in short slices so master keeps seeing heartbeats)
+        int scheduled = (next_event < num_schedule);
+        struct timespec deadline;
+        if (scheduled) {
+            deadline = schedule_deadline(&start, schedule[next_event].t);
+        } else {
+            if (!spawn_armed) {
+                // Random spawns start one interval after the schedule ends
+                sim_periodic_init(&spawn, interval);
+                spawn_armed = 1;
+            }
+            deadline = sim_periodic_deadline(&spawn);
+        }
+        // A hit report cuts the wait short
+        int woke;
+        if (hits_open) {
+            woke = sim_heartbeat_wait_fd(SIM_ROLE_TARGETS, fd_hits_in, &deadline);
+        } else {
+            woke = sim_heartbeat_sleep_until(SIM_ROLE_TARGETS, &deadline);
+        }
+        if (woke < 0) {
+            continue;  // EINTR: re-check running, sleep again
+        }
+
+        // Pick up a config edit published by master
+        if (sim_params_refresh()) {
+            interval = spawn_interval(params->target_spawn_interval);
+            if (spawn_armed) {
+                sim_periodic_set_period(&spawn, interval);
+            }
+            sim_log_info("targets: params generation %lu, spawn interval %.2f s",
+                         sim_params_generation(), params->target_spawn_interval);
+        }
 
         if (!running) {
             break;
         }
 
-        int idx;
-
-        if (active_count < max_targets) {
-            idx = active_count;
-            active_count++;
+        int changed[SIM_MAX_TARGETS];
+        int num_changed = 0;
+
+        if (woke > 0) {
+            // Hit targets: same slot, new target (new id, so a late
+            // second report of the old id finds nothing)
+            ssize_t r = sim_ipc_rx_fill(fd_hits_in, &rx_hits);
+
+            if (r > 0) {
+                sim_metrics_chan_bytes(SIM_METRIC_CHAN_TARGET_HITS, (uint64_t)r);
+            }
+            while (r > 0 && sim_proto_next(&rx_hits, &rd_hits, &msg)) {
+                int      ids[SIM_MAX_TARGETS];
+                uint32_t hit_epoch;
+                int n = sim_proto_get_target_hits(&msg, &hit_epoch, ids, SIM_MAX_TARGETS);
+                if (n < 0) {
+                    continue;
+                }
+                sim_metrics_chan_add(SIM_METRIC_CHAN_TARGET_HITS, 1);
+                if (hit_epoch != epoch) {
+                    hits_stale += (unsigned long)n;
+                    continue;
+                }
+
+                for (int k = 0; k < n && num_changed < SIM_MAX_TARGETS; ++k) {
+                    int idx = sim_physics_tindex_find(&tindex, ids[k]);
+                    if (idx < 0) {
+                        hits_stale++;
+                        continue;
+                    }
+                    generate_random_targets(&targets[idx], 1, params, radius, next_id++, &rng);
+                    sim_physics_tindex_set(&tindex, targets, idx);
+                    changed[num_changed++] = idx;
+                    hits_taken++;
+
+                    sim_log_info("targets: hit id=%d at idx=%d, respawned as id=%d",
+                                 ids[k], idx, targets[idx].id);
+                }
+            }
+            if (r == 0) {
+                sim_log_info("targets: hits pipe EOF, no more respawns");
+                hits_open = 0;
+            } else if (r < 0 && errno != EAGAIN) {
+                perror("targets: sim_ipc_rx_fill(hits)");
+                hits_open = 0;
+            }
         } else {
-            idx = oldest_index;
-            oldest_index = (oldest_index + 1) % max_targets;
+            if (!scheduled) {
+                sim_periodic_poll(&spawn);
+            }
+
+            int idx;
+
+            if (active_count < max_targets) {
+                idx = active_count;
+                active_count++;
+            } else {
+                idx = oldest_index;
+                oldest_index = (oldest_index + 1) % max_targets;
+            }
+
+            if (scheduled) {
+                place_target(&targets[idx], &schedule[next_event++], next_id++);
+            } else {
+                generate_random_targets(&targets[idx], 1, params, radius, next_id++, &rng);
+            }
+            sim_physics_tindex_set(&tindex, targets, idx);
+            changed[num_changed++] = idx;
+
+            sim_log_info("targets: updated target at idx=%d (active=%d/%d, id=%d)",
+                         idx, active_count, max_targets, targets[idx].id);
         }
 
-        generate_random_target(&targets[idx], params, radius, next_id++);
-
-        w = write_full(fd_tgt_out, targets,
-                       (size_t)(max_targets * (int)sizeof(Target)));
-        if (w != expected) {
-            sim_log_info("targets: write_full(fd_tgt_out) failed in loop, returned %zd (expected %zd)",
-                         w, expected);
+        if (num_changed == 0) {
+            continue;
+        }
+        sim_proto_put_target_changes(&out, targets, changed, num_changed, max_targets);
+        if (sim_proto_flush(fd_tgt_out, &out) != 0) {
+            sim_log_info("targets: sim_proto_flush(fd_tgt_out) failed in loop");
             break; 
         }
-
-        sim_log_info("targets: updated target at idx=%d (active=%d/%d, id=%d)",
-                     idx, active_count, max_targets, targets[idx].id);
     }
 
-    close(fd_tgt_out);
+    if (use_scenario) {
+        sim_scenario_free(&scenario);
+    }
+    sim_ipc_close(fd_tgt_out);
+    sim_ipc_close(fd_hits_in);
+    sim_log_info("targets: hits respawned=%lu stale=%lu", hits_taken, hits_stale);
     sim_log_info("targets: exiting (signal or pipe error)");
     return EXIT_SUCCESS;
 }